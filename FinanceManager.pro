@@ -1,38 +1,14 @@
-QT       += core gui sql charts
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    aboutdialog.cpp \
-    addrecorddialog.cpp \
-    categorydialog.cpp \
-    databasemanager.cpp \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    aboutdialog.h \
-    addrecorddialog.h \
-    categorydialog.h \
-    databasemanager.h \
-    mainwindow.h
-
-FORMS += \
-    aboutdialog.ui \
-    addrecorddialog.ui \
-    categorydialog.ui \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
-
-RESOURCES += \
-    img.qrc
+# 主程序、基准测试、压测数据生成工具与不依赖界面的命令行报表 (fmreport)
+# 基准测试单独运行：make -C benchmarks check，或直接运行 benchmarks/ledgerbenchmark (参数见 benchmarks.pro)
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    app \
+    benchmarks \
+    datagen \
+    report
+
+app.file = FinanceManagerApp.pro
+benchmarks.subdir = benchmarks
+datagen.subdir = tools/datagen
+report.subdir = tools/report
@@ -0,0 +1,49 @@
+QT       += core gui sql charts concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+TARGET = FinanceManager
+
+# 账本核心 (与基准测试共用)
+include(core.pri)
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    aboutdialog.cpp \
+    addrecorddialog.cpp \
+    categorydialog.cpp \
+    chartupdater.cpp \
+    filterscheduler.cpp \
+    main.cpp \
+    mainwindow.cpp \
+    recordtablemodel.cpp \
+    uistallmonitor.cpp
+
+HEADERS += \
+    aboutdialog.h \
+    addrecorddialog.h \
+    categorydialog.h \
+    chartupdater.h \
+    filterscheduler.h \
+    mainwindow.h \
+    recordtablemodel.h \
+    uistallmonitor.h
+
+FORMS += \
+    aboutdialog.ui \
+    addrecorddialog.ui \
+    categorydialog.ui \
+    mainwindow.ui
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
+
+RESOURCES += \
+    img.qrc
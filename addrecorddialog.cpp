@@ -1,6 +1,7 @@
 #include "addrecorddialog.h"
 #include "ui_addrecorddialog.h"
 #include "databasemanager.h"
+#include "money.h"
 #include <QMessageBox>
 
 AddRecordDialog::AddRecordDialog(QWidget *parent)
@@ -22,6 +23,20 @@ AddRecordDialog::AddRecordDialog(QWidget *parent)
     // 触发一次分类加载（默认加载支出的分类）
     loadCategories(0);
 
+    // 重复：常用周期直接选，其他的选“自定义”再填间隔与单位；默认不截止
+    ui->combo_Repeat->addItem("不重复", -1);
+    ui->combo_Repeat->addItem("每天", RecurringRule::Day);
+    ui->combo_Repeat->addItem("每周", RecurringRule::Week);
+    ui->combo_Repeat->addItem("每月", RecurringRule::Month);
+    ui->combo_Repeat->addItem("自定义", -2);
+    ui->combo_Unit->addItem("天", RecurringRule::Day);
+    ui->combo_Unit->addItem("周", RecurringRule::Week);
+    ui->combo_Unit->addItem("月", RecurringRule::Month);
+    ui->combo_Unit->setCurrentIndex(2);
+    ui->dateEdit_RepeatEnd->setDate(QDate::currentDate().addYears(1));
+    connect(ui->combo_Repeat, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &AddRecordDialog::updateRepeatControls);
+    connect(ui->checkBox_RepeatEnd, &QCheckBox::toggled, this, &AddRecordDialog::updateRepeatControls);
+    updateRepeatControls();
 }
 
 AddRecordDialog::~AddRecordDialog()
@@ -33,16 +48,22 @@ void AddRecordDialog::loadCategories(int type)
 {
     ui->combo_Category->clear();
 
-    // 从数据库获取分类
-    QSqlQuery query = DatabaseManager::instance().getCategories(type);
-    while (query.next()) {
-        QString name = query.value("name").toString();
-        int id = query.value("id").toInt();
+    // 从分类缓存获取分类
+    for (const CategoryInfo &category : DatabaseManager::instance().categories().categories(type)) {
         // ItemData 存储 ID
-        ui->combo_Category->addItem(name, id);
+        ui->combo_Category->addItem(category.name, category.id);
     }
 }
 
+void AddRecordDialog::updateRepeatControls()
+{
+    const int repeat = ui->combo_Repeat->currentData().toInt();
+    ui->spin_Every->setEnabled(repeat == -2);
+    ui->combo_Unit->setEnabled(repeat == -2);
+    ui->checkBox_RepeatEnd->setEnabled(repeat != -1);
+    ui->dateEdit_RepeatEnd->setEnabled(repeat != -1 && ui->checkBox_RepeatEnd->isChecked());
+}
+
 void AddRecordDialog::on_combo_Type_currentIndexChanged(int index)
 {
     // 获取当前选中的类型 (0或1)
@@ -53,10 +74,29 @@ void AddRecordDialog::on_combo_Type_currentIndexChanged(int index)
 AddRecordDialog::RecordData AddRecordDialog::getRecordData() const
 {
     RecordData data;
-    data.amount = ui->lineEdit_Amount->text().toDouble();
+    // 按十进制文本精确换算成分，不经过浮点
+    if (!Money::parse(ui->lineEdit_Amount->text(), &data.cents) || data.cents < 0) {
+        data.cents = -1;
+    }
     data.dateTime = ui->dateTimeEdit->dateTime();
     data.note = ui->textEdit_Note->toPlainText();
     // 获取选中的分类ID
     data.categoryId = ui->combo_Category->currentData().toInt();
     return data;
 }
+
+bool AddRecordDialog::getRepeat(RecurringRule *rule) const
+{
+    const int repeat = ui->combo_Repeat->currentData().toInt();
+    if (repeat == -1) return false;
+
+    if (repeat == -2) {
+        rule->unit = RecurringRule::Unit(ui->combo_Unit->currentData().toInt());
+        rule->every = ui->spin_Every->value();
+    } else {
+        rule->unit = RecurringRule::Unit(repeat);
+        rule->every = 1;
+    }
+    rule->endDate = ui->checkBox_RepeatEnd->isChecked() ? ui->dateEdit_RepeatEnd->date() : QDate();
+    return true;
+}
@@ -3,6 +3,7 @@
 
 #include <QDialog>
 #include <QDateTime>
+#include "recurringscheduler.h"
 
 namespace Ui {
 class AddRecordDialog;
@@ -18,16 +19,19 @@ public:
 
     // 定义结构体方便传递数据
     struct RecordData {
-        double amount;
+        qint64 cents;      // 金额 (分)，无法解析时为 -1
         QDateTime dateTime;
         QString note;
         int categoryId;
     };
     RecordData getRecordData() const;
+    // 选了重复时返回 true 并填好 rule 的周期与截止日期 (金额、时间、备注、分类取自 getRecordData())
+    bool getRepeat(RecurringRule *rule) const;
 
 private:
     Ui::AddRecordDialog *ui;
     void loadCategories(int type); // 辅助函数
+    void updateRepeatControls();   // 按是否重复、是否自定义周期启用相应控件
 
 private slots:
     // 类型改变时触发（如从支出变收入）
@@ -0,0 +1,101 @@
+#include "aggregationservice.h"
+#include "databasemanager.h"
+#include "columnarsnapshot.h"
+#include "ledgerqueries.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+
+AggregateSnapshot::AggregateSnapshot(QVector<CategoryTotal> categories)
+    : m_categories(std::move(categories))
+{
+    std::sort(m_categories.begin(), m_categories.end(),
+              [](const CategoryTotal &a, const CategoryTotal &b) { return a.cents > b.cents; });
+
+    for (const CategoryTotal &c : m_categories) {
+        if (c.type == 1) {
+            m_totalIncome += c.cents;
+        } else {
+            m_totalExpense += c.cents;
+        }
+        m_recordCount += c.count;
+    }
+}
+
+AggregateSnapshotPtr AggregationService::compute(const RecordFilter &filter)
+{
+    // 没有备注搜索时直接由按天汇总缓存回答，不访问 SQLite
+    RollupCache &rollup = DatabaseManager::instance().rollup();
+    if (rollup.isReady() && RollupCache::canAnswer(filter)) {
+        return rollup.snapshot(filter);
+    }
+
+    // 缓存还没建好 (或命令行报表不建缓存) 时，快照可以代替 SQL 做整段扫描
+    const ColumnarSnapshot *columns = DatabaseManager::instance().columnarSnapshot();
+    if (columns && RollupCache::canAnswer(filter)) {
+        return computeColumnar(filter, *columns);
+    }
+
+    return computeSql(filter, QSqlDatabase::database());
+}
+
+AggregateSnapshotPtr AggregationService::computeSql(const RecordFilter &filter, const QSqlDatabase &db)
+{
+    QVector<CategoryTotal> categories;
+
+    // 按分类分组，一条语句拿到全部需要的数字，收支合计在内存里再累加
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (query.exec(LedgerQueries::categoryTotals(filter))) {
+        while (query.next()) {
+            CategoryTotal total;
+            total.id = query.value(0).toInt();
+            total.name = query.value(1).toString();
+            total.type = query.value(2).toInt();
+            total.cents = query.value(3).toLongLong();
+            total.count = query.value(4).toInt();
+            categories.append(total);
+        }
+    } else {
+        qDebug() << "Aggregate error:" << query.lastError().text();
+    }
+
+    return AggregateSnapshotPtr(new AggregateSnapshot(std::move(categories)));
+}
+
+AggregateSnapshotPtr AggregationService::computeColumnar(const RecordFilter &filter, const ColumnarSnapshot &columns)
+{
+    qint64 first = 0;
+    qint64 last = columns.rowCount();
+    if (filter.startDate.isValid() || filter.endDate.isValid()) {
+        columns.rowsInRange(filter.startDate.isValid() ? filter.startSecs() : std::numeric_limits<qint64>::min(),
+                            filter.endDate.isValid() ? filter.endSecs() : std::numeric_limits<qint64>::max(),
+                            &first, &last);
+    }
+
+    QVector<qint64> cents;
+    QVector<qint64> counts;
+    columns.sumByCategory(first, last, &cents, &counts);
+
+    // 与 SQL 的 JOIN 一致：分类已不存在的记录不计入
+    const CategoryCache &cache = DatabaseManager::instance().categories();
+    QVector<CategoryTotal> categories;
+    for (int cid = 0; cid < counts.size(); ++cid) {
+        if (counts[cid] == 0) continue;
+        if (filter.categoryId != -1 && cid != filter.categoryId) continue;
+        const CategoryInfo *info = cache.find(cid);
+        if (!info || (filter.type != -1 && info->type != filter.type)) continue;
+
+        CategoryTotal total;
+        total.id = cid;
+        total.name = info->name;
+        total.type = info->type;
+        total.cents = cents[cid];
+        total.count = int(counts[cid]);
+        categories.append(total);
+    }
+
+    return AggregateSnapshotPtr(new AggregateSnapshot(std::move(categories)));
+}
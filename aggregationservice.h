@@ -0,0 +1,63 @@
+#ifndef AGGREGATIONSERVICE_H
+#define AGGREGATIONSERVICE_H
+
+#include <QString>
+#include <QVector>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include "recordfilter.h"
+
+class ColumnarSnapshot;
+
+// 单个分类的汇总结果
+struct CategoryTotal
+{
+    int id = -1;
+    QString name;
+    int type = 0;       // 0支出, 1收入
+    qint64 cents = 0;   // 金额合计 (分)
+    int count = 0;      // 记录条数
+};
+
+// 一次筛选的汇总快照
+// 构造后只读：柱状图、饼图、概览都从同一份快照取数，保证三者口径一致
+class AggregateSnapshot
+{
+public:
+    AggregateSnapshot() = default;
+    explicit AggregateSnapshot(QVector<CategoryTotal> categories);
+
+    // 金额均为分 (整数，与求和顺序无关，逐分精确)
+    qint64 totalIncomeCents() const { return m_totalIncome; }
+    qint64 totalExpenseCents() const { return m_totalExpense; }
+    qint64 balanceCents() const { return m_totalIncome - m_totalExpense; }
+    int recordCount() const { return m_recordCount; }
+
+    // 各分类合计，按金额从大到小排列
+    const QVector<CategoryTotal> &categories() const { return m_categories; }
+
+private:
+    QVector<CategoryTotal> m_categories;
+    qint64 m_totalIncome = 0;
+    qint64 m_totalExpense = 0;
+    int m_recordCount = 0;
+};
+
+using AggregateSnapshotPtr = QSharedPointer<const AggregateSnapshot>;
+
+// 汇总服务：一次扫描得到收入合计、支出合计、分类合计与记录数
+class AggregationService
+{
+public:
+    // 优先由按天汇总缓存回答，其次是与数据库一致的列式快照，否则在界面线程的连接上查询
+    static AggregateSnapshotPtr compute(const RecordFilter &filter);
+
+    // 顺序扫描列式快照：日期范围二分定位，区间内按分类ID累加 (不支持备注搜索，见 RollupCache::canAnswer)
+    // 分类名称与类型取自分类缓存，只在界面线程上调用
+    static AggregateSnapshotPtr computeColumnar(const RecordFilter &filter, const ColumnarSnapshot &columns);
+
+    // 只用 SQL 汇总，可在任意线程上用该线程自己的连接调用 (缓存不是线程安全的，这里不碰)
+    static AggregateSnapshotPtr computeSql(const RecordFilter &filter, const QSqlDatabase &db);
+};
+
+#endif // AGGREGATIONSERVICE_H
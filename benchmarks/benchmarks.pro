@@ -0,0 +1,17 @@
+# 账本性能基准 (QtTest QBENCHMARK，无界面)
+# 运行：make check，或直接运行 ledgerbenchmark；规模、缓存目录等由环境变量控制，见 ledgerbenchmark.cpp
+# 机器可读的结果：ledgerbenchmark -o results.csv,csv (或 xml / junitxml)
+QT += testlib sql concurrent
+QT -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = ledgerbenchmark
+
+# 与主程序共用账本核心
+include(../core.pri)
+include(../synthetic.pri)
+
+SOURCES += \
+    ledgerbenchmark.cpp
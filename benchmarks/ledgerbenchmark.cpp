@@ -0,0 +1,1002 @@
+// 账本性能基准
+// 在可复现的合成账本上测量：冷启动、单条记账、各存储参数下的写入、筛选查询、图表/概览汇总、
+// 单元格编辑 (直接写入 / 延迟写入队列)、删除分类 (保留账单)、批量删除/改分类/平移日期、CSV 导入/导出、
+// 列式快照 (建立、同步、扫描汇总)、按月多年报表 (顺序 / 多核并行)、预算计数 (随机写入后与 SQL 比对)、
+// 重复账单的补生成 (三年未打开，再跑一次不应重复)
+//
+// 环境变量：
+//   FM_BENCH_SIZES  账本规模，逗号分隔，默认 "10k,1M,10M"
+//   FM_BENCH_DIR    合成账本的缓存目录，默认为系统临时目录下的 financemanager-bench
+//                   (首次运行需要生成，之后直接复用；也可以用 tools/datagen 单独生成)
+//   FM_BENCH_SEED   生成种子，默认 SyntheticLedger::DefaultSeed
+//
+// 结果用 QtTest 自带的输出格式保存，便于在提交之间比较，例如：
+//   ledgerbenchmark -o results.csv,csv -o -,txt
+//   ledgerbenchmark -o results.xml,xml
+// 每行结果的名称为 "规模/场景"，不同提交的同名结果可以直接对比
+// 请使用发布构建：调试构建打开数据库时会额外做执行计划与汇总缓存的自检
+//
+// 另有不计时的正确性检查，任何一项不满足即失败：
+//   queryPlans        应用发出的每条查询都命中索引 (不退化为全表扫描)
+//   rollupMatchesSql  重建的按天汇总缓存在随机筛选条件下与 SQL 逐分类一致 (SQL / 列式快照两种重建)
+
+#include <QtTest>
+#include <QDir>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include "databasemanager.h"
+#include "ledgerqueries.h"
+#include "budgettracker.h"
+#include "recurringscheduler.h"
+#include "parallelaggregator.h"
+#include "aggregationservice.h"
+#include "columnarsnapshot.h"
+#include "trendengine.h"
+#include "recordexporter.h"
+#include "recordimporter.h"
+#include "storageprofile.h"
+#include "syntheticledger.h"
+#include <functional>
+
+class LedgerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void queryPlans_data();
+    void queryPlans();
+    void rollupMatchesSql_data();
+    void rollupMatchesSql();
+
+    void coldStartup_data();
+    void coldStartup();
+    void insertRecord_data();
+    void insertRecord();
+    void storageProfiles_data();
+    void storageProfiles();
+    void filterQueries_data();
+    void filterQueries();
+    void aggregates_data();
+    void aggregates();
+    void columnarScan_data();
+    void columnarScan();
+    void monthlyReport_data();
+    void monthlyReport();
+    void cellEdits_data();
+    void cellEdits();
+    void removeCategoryKeepRecords_data();
+    void removeCategoryKeepRecords();
+    void batchEdit_data();
+    void batchEdit();
+    void budgetCounters_data();
+    void budgetCounters();
+    void recurringCatchUp_data();
+    void recurringCatchUp();
+    void importCsv_data();
+    void importCsv();
+    void exportCsv_data();
+    void exportCsv();
+
+private:
+    class ScopedMutation;
+
+    // 命名的筛选条件，日期相对于合成数据的最后一天
+    static QList<QPair<QString, RecordFilter>> namedFilters();
+
+    void addSizeRows();
+    void addSizeColumn();
+    bool useLedger(qint64 rows, bool columnar = false); // 切换 DatabaseManager 到对应规模的账本 (是否启用列式快照)
+    QString ledgerPath(qint64 rows) const { return m_paths.value(rows); }
+
+    QList<qint64> m_sizes;
+    QHash<qint64, QString> m_paths;
+    qint64 m_openRows = -1;
+    bool m_openColumnar = false;
+    quint32 m_seed = SyntheticLedger::DefaultSeed;
+    QString m_cacheDir;
+    QTemporaryDir m_outputDir;
+};
+
+// 会改动共享账本的测试开头建一个守卫，每做一处改动之前登记对应的还原步骤；
+// 测试结束时 (包括 QVERIFY 失败中途返回) 先写入尚未写入的表格编辑，再按登记的逆序还原，最后关闭账本，
+// 下一项测试重新打开，汇总缓存等按还原后的数据重建
+class LedgerBenchmark::ScopedMutation
+{
+public:
+    // reopen 为假时只执行还原步骤 (账本内容没有改动，例如只写了输出文件)
+    explicit ScopedMutation(LedgerBenchmark *bench, bool reopen = true) : m_bench(bench), m_reopen(reopen) {}
+    ~ScopedMutation()
+    {
+        DatabaseManager &manager = DatabaseManager::instance();
+        if (m_reopen) manager.edits().flush();
+        for (const auto &step : m_steps) step();
+        if (m_reopen) {
+            manager.closeDatabase();
+            m_bench->m_openRows = -1;
+        }
+    }
+
+    void onRestore(std::function<void()> step) { m_steps.prepend(std::move(step)); }
+
+    // 还原用的 SQL (values 按顺序绑定到 ?)；失败时只警告，后面的步骤照常执行
+    void onRestore(const QString &sql, const QVariantList &values = QVariantList())
+    {
+        onRestore([sql, values]() {
+            QSqlQuery query;
+            query.prepare(sql);
+            for (int i = 0; i < values.size(); ++i) query.bindValue(i, values[i]);
+            if (!query.exec()) {
+                qWarning().noquote() << "restore failed:" << sql << query.lastError().text();
+            }
+        });
+    }
+
+private:
+    LedgerBenchmark *m_bench;
+    bool m_reopen;
+    QList<std::function<void()>> m_steps;
+};
+
+QList<QPair<QString, RecordFilter>> LedgerBenchmark::namedFilters()
+{
+    QDate last = QDateTime::fromSecsSinceEpoch(SyntheticLedger::lastTimestamp()).date();
+
+    RecordFilter month;
+    month.startDate = last.addMonths(-1);
+    month.endDate = last;
+
+    RecordFilter year = month;
+    year.startDate = last.addYears(-1);
+
+    RecordFilter all;
+
+    RecordFilter expenseYear = year;
+    expenseYear.type = 0;
+
+    RecordFilter noteYear = year;
+    noteYear.noteText = "午饭";
+
+    return {
+        {"month", month},
+        {"year", year},
+        {"all", all},
+        {"expenseYear", expenseYear},
+        {"noteYear", noteYear}
+    };
+}
+
+void LedgerBenchmark::initTestCase()
+{
+    QString sizes = qEnvironmentVariable("FM_BENCH_SIZES", "10k,1M,10M");
+    for (const QString &text : sizes.split(',', Qt::SkipEmptyParts)) {
+        qint64 rows = SyntheticLedger::parseSize(text);
+        if (rows < 0) QFAIL(qPrintable("invalid FM_BENCH_SIZES entry: " + text));
+        m_sizes << rows;
+    }
+
+    QString dir = qEnvironmentVariable("FM_BENCH_DIR", QDir::temp().filePath("financemanager-bench"));
+    bool seedOk = false;
+    quint32 seed = qEnvironmentVariable("FM_BENCH_SEED").toUInt(&seedOk);
+    if (!seedOk) seed = SyntheticLedger::DefaultSeed;
+    m_seed = seed;
+    m_cacheDir = dir;
+
+    // 先把所有规模的账本准备好，生成时间不计入任何一项
+    for (qint64 rows : m_sizes) {
+        QString path = SyntheticLedger::ensure(dir, rows, seed);
+        QVERIFY2(!path.isEmpty(), "cannot prepare synthetic ledger");
+        m_paths.insert(rows, path);
+    }
+    QVERIFY(m_outputDir.isValid());
+}
+
+void LedgerBenchmark::cleanupTestCase()
+{
+    DatabaseManager::instance().closeDatabase();
+    m_openRows = -1;
+}
+
+void LedgerBenchmark::addSizeColumn()
+{
+    QTest::addColumn<qint64>("rows");
+}
+
+void LedgerBenchmark::addSizeRows()
+{
+    addSizeColumn();
+    for (qint64 rows : m_sizes) {
+        QTest::newRow(qPrintable(SyntheticLedger::sizeLabel(rows))) << rows;
+    }
+}
+
+bool LedgerBenchmark::useLedger(qint64 rows, bool columnar)
+{
+    if (m_openRows == rows && m_openColumnar == columnar) return true;
+
+    DatabaseManager &manager = DatabaseManager::instance();
+    manager.closeDatabase();
+    m_openRows = -1;
+    manager.setColumnarSnapshotEnabled(columnar);
+    if (!manager.openDatabase(ledgerPath(rows))) return false;
+    m_openRows = rows;
+    m_openColumnar = columnar;
+    return true;
+}
+
+// 执行计划：LedgerQueries 列出的每条查询 (各种筛选组合、排序、分页) 都必须走索引
+void LedgerBenchmark::queryPlans_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::queryPlans()
+{
+    QFETCH(qint64, rows);
+    QVERIFY(useLedger(rows));
+
+    const QStringList scans = DatabaseManager::instance().findFullScans(LedgerQueries::planCheckQueries());
+    QVERIFY2(scans.isEmpty(), qPrintable("queries fall back to a full scan:\n" + scans.join("\n")));
+}
+
+// 按天汇总缓存：在合成账本上重新建一份，随机抽 200 组筛选条件 (日期范围、收支、分类) 与 SQL 比对金额与条数
+void LedgerBenchmark::rollupMatchesSql_data()
+{
+    addSizeColumn();
+    QTest::addColumn<bool>("columnar");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        QTest::newRow(qPrintable(size + "/sql")) << rows << false;
+        QTest::newRow(qPrintable(size + "/columnar")) << rows << true;
+    }
+}
+
+void LedgerBenchmark::rollupMatchesSql()
+{
+    QFETCH(qint64, rows);
+    QFETCH(bool, columnar);
+    QVERIFY(useLedger(rows, columnar));
+
+    RollupCache rollup;
+    if (columnar) {
+        const ColumnarSnapshot *columns = DatabaseManager::instance().columnarSnapshot();
+        QVERIFY(columns);
+        QVERIFY(rollup.rebuild(*columns));
+    } else {
+        QVERIFY(rollup.rebuild());
+    }
+
+    const QStringList mismatches = rollup.verifyAgainstSql(200, m_seed);
+    QVERIFY2(mismatches.isEmpty(), qPrintable(mismatches.join("\n")));
+}
+
+// 冷启动：打开数据库、检查迁移、读入分类、重建按天汇总缓存
+// (操作系统的文件缓存是热的，测的是程序自身的启动开销)
+void LedgerBenchmark::coldStartup_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::coldStartup()
+{
+    QFETCH(qint64, rows);
+    DatabaseManager &manager = DatabaseManager::instance();
+    manager.closeDatabase();
+    m_openRows = -1;
+
+    QBENCHMARK {
+        manager.closeDatabase();
+        QVERIFY(manager.openDatabase(ledgerPath(rows)));
+    }
+    m_openRows = rows;
+    m_openColumnar = manager.columnarSnapshotEnabled();
+}
+
+// 单条记账 (自动提交，含汇总缓存的增量更新)；测完删除新增的记录，账本保持原样
+void LedgerBenchmark::insertRecord_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::insertRecord()
+{
+    QFETCH(qint64, rows);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+
+    QSqlQuery query;
+    QVERIFY(query.exec("SELECT COALESCE(MAX(id), 0) FROM record") && query.next());
+    qint64 maxId = query.value(0).toLongLong();
+    int cid = manager.categories().categories(0).first().id;
+    QDateTime when = QDateTime::fromSecsSinceEpoch(SyntheticLedger::lastTimestamp());
+
+    QBENCHMARK {
+        QVERIFY(manager.insertRecord(1234, when, "基准测试", cid));
+    }
+
+    QList<qint64> inserted;
+    query.prepare("SELECT id FROM record WHERE id > ?");
+    query.addBindValue(maxId);
+    QVERIFY(query.exec());
+    while (query.next()) inserted << query.value(0).toLongLong();
+    QVERIFY(manager.deleteRecords(inserted));
+}
+
+// 各存储参数 (safe / balanced / fast) 下的单条记账与单元格编辑 (均为自动提交)
+// 以及在该参数下打开账本的耗时；测完还原数据，并以默认参数重新打开
+void LedgerBenchmark::storageProfiles_data()
+{
+    addSizeColumn();
+    QTest::addColumn<int>("level");
+    QTest::addColumn<QString>("operation");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (StorageProfile::Level level : {StorageProfile::Safe, StorageProfile::Balanced, StorageProfile::Fast}) {
+            for (const QString &operation : {QString("open"), QString("insert"), QString("edit")}) {
+                QTest::newRow(qPrintable(QString("%1/%2/%3").arg(size, StorageProfile::name(level), operation)))
+                    << rows << int(level) << operation;
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::storageProfiles()
+{
+    QFETCH(qint64, rows);
+    QFETCH(int, level);
+    QFETCH(QString, operation);
+    DatabaseManager &manager = DatabaseManager::instance();
+    const StorageProfile defaultProfile = manager.storageProfile();
+
+    manager.closeDatabase();
+    m_openRows = -1;
+    manager.setStorageProfile(StorageProfile::forLevel(StorageProfile::Level(level)));
+
+    if (operation == "open") {
+        QBENCHMARK {
+            manager.closeDatabase();
+            QVERIFY(manager.openDatabase(ledgerPath(rows)));
+        }
+    } else {
+        QVERIFY(manager.openDatabase(ledgerPath(rows)));
+        QSqlQuery query;
+        QVERIFY(query.exec("SELECT MAX(id) FROM record") && query.next());
+        qint64 lastId = query.value(0).toLongLong();
+
+        if (operation == "insert") {
+            int cid = manager.categories().categories(0).first().id;
+            QDateTime when = QDateTime::fromSecsSinceEpoch(SyntheticLedger::lastTimestamp());
+            QBENCHMARK {
+                QVERIFY(manager.insertRecord(1234, when, "基准测试", cid));
+            }
+            QVERIFY(query.exec(QString("DELETE FROM record WHERE id > %1").arg(lastId)));
+        } else {
+            QVERIFY(query.exec(QString("SELECT note FROM record WHERE id = %1").arg(lastId)) && query.next());
+            QString note = query.value(0).toString();
+            int round = 0;
+            QBENCHMARK {
+                QVERIFY(manager.updateRecordField(lastId, "note", QString("基准测试 %1").arg(++round)));
+            }
+            QVERIFY(manager.updateRecordField(lastId, "note", note));
+        }
+    }
+
+    // 后续测试以默认参数重新打开 (日志模式随之切回)
+    manager.closeDatabase();
+    manager.setStorageProfile(defaultProfile);
+}
+
+// 明细表格与统计发出的 SQL：记录数、首屏窗口、按分类汇总、趋势
+void LedgerBenchmark::filterQueries_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("sql");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (const auto &named : namedFilters()) {
+            const RecordFilter &filter = named.second;
+            const QList<QPair<QString, QString>> queries = {
+                {"recordCount", LedgerQueries::recordCount(filter)},
+                {"firstPage", LedgerQueries::recordWindow(filter, {"timestamp", "id"}, true, false, 256, 0)},
+                {"categoryTotals", LedgerQueries::categoryTotals(filter)},
+                {"dailyTotals", LedgerQueries::dailyTotals(filter)}
+            };
+            for (const auto &query : queries) {
+                QTest::newRow(qPrintable(QString("%1/%2/%3").arg(size, named.first, query.first)))
+                    << rows << query.second;
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::filterQueries()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, sql);
+    QVERIFY(useLedger(rows));
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    QBENCHMARK {
+        QVERIFY2(query.exec(sql), qPrintable(query.lastError().text()));
+        while (query.next()) {}
+    }
+}
+
+// 图表与概览的汇总：按天汇总缓存 / 纯 SQL 两条路径
+void LedgerBenchmark::aggregates_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("filterName");
+    QTest::addColumn<QString>("path");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (const auto &named : namedFilters()) {
+            QStringList paths = {"snapshotSql", "trendSql"};
+            if (RollupCache::canAnswer(named.second)) {
+                paths.prepend("trendRollup");
+                paths.prepend("snapshotRollup");
+            }
+            for (const QString &path : paths) {
+                QTest::newRow(qPrintable(QString("%1/%2/%3").arg(size, named.first, path)))
+                    << rows << named.first << path;
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::aggregates()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, filterName);
+    QFETCH(QString, path);
+    QVERIFY(useLedger(rows));
+
+    RecordFilter filter;
+    for (const auto &named : namedFilters()) {
+        if (named.first == filterName) filter = named.second;
+    }
+    const RollupCache &rollup = DatabaseManager::instance().rollup();
+    QSqlDatabase db = QSqlDatabase::database();
+
+    if (path == "snapshotRollup") {
+        QBENCHMARK { QVERIFY(rollup.snapshot(filter)); }
+    } else if (path == "trendRollup") {
+        QBENCHMARK { QVERIFY(TrendEngine::computeRollup(rollup, filter, TrendGranularity::Auto)); }
+    } else if (path == "snapshotSql") {
+        QBENCHMARK { QVERIFY(AggregationService::computeSql(filter, db)); }
+    } else {
+        QBENCHMARK { QVERIFY(TrendEngine::computeSql(filter, TrendGranularity::Auto, db)); }
+    }
+}
+
+// 列式快照：全量建立、无变化时的同步，以及同一筛选条件下 SQL 分组查询与顺序扫描快照的汇总对比
+// 快照写在临时目录，不影响缓存的账本
+void LedgerBenchmark::columnarScan_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("filterName");
+    QTest::addColumn<QString>("path");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        QTest::newRow(qPrintable(size + "/build")) << rows << QString() << QString("build");
+        QTest::newRow(qPrintable(size + "/sync")) << rows << QString() << QString("sync");
+        for (const auto &named : namedFilters()) {
+            if (!RollupCache::canAnswer(named.second)) continue;
+            for (const QString &path : {QString("sql"), QString("columnar")}) {
+                QTest::newRow(qPrintable(QString("%1/%2/%3").arg(size, named.first, path)))
+                    << rows << named.first << path;
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::columnarScan()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, filterName);
+    QFETCH(QString, path);
+    QVERIFY(useLedger(rows));
+
+    RecordFilter filter;
+    for (const auto &named : namedFilters()) {
+        if (named.first == filterName) filter = named.second;
+    }
+    QSqlDatabase db = QSqlDatabase::database();
+    const QString file = m_outputDir.filePath(SyntheticLedger::sizeLabel(rows) + ".columns");
+    ColumnarSnapshot columns;
+
+    if (path == "build") {
+        QBENCHMARK {
+            columns.close();
+            QFile::remove(file);
+            QVERIFY(columns.sync(db, file));
+        }
+        QCOMPARE(columns.rowCount(), rows);
+        return;
+    }
+
+    QVERIFY(columns.sync(db, file));
+    if (path == "sync") {
+        QBENCHMARK { QVERIFY(columns.sync(db, file)); }
+    } else if (path == "sql") {
+        QBENCHMARK { QVERIFY(AggregationService::computeSql(filter, db)); }
+    } else {
+        // 两条路径的结果必须逐分一致
+        AggregateSnapshotPtr expected = AggregationService::computeSql(filter, db);
+        AggregateSnapshotPtr actual = AggregationService::computeColumnar(filter, columns);
+        QCOMPARE(actual->totalIncomeCents(), expected->totalIncomeCents());
+        QCOMPARE(actual->totalExpenseCents(), expected->totalExpenseCents());
+        QCOMPARE(actual->recordCount(), expected->recordCount());
+        QBENCHMARK { QVERIFY(AggregationService::computeColumnar(filter, columns)); }
+    }
+}
+
+// 按月、按分类的多年报表：SQL (每个分区一个只读连接) 与列式快照两种数据源，各自比较顺序执行与多核并行
+// 并行结果必须与顺序执行完全一致；列式快照的几行会启用快照重新打开账本
+void LedgerBenchmark::monthlyReport_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("filterName");
+    QTest::addColumn<bool>("columnar");
+    QTest::addColumn<int>("partitions");
+
+    QList<int> partitionCounts = {1};
+    if (QThreadPool::globalInstance()->maxThreadCount() > 1) {
+        partitionCounts << QThreadPool::globalInstance()->maxThreadCount();
+    }
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (bool columnar : {false, true}) {
+            for (const auto &named : namedFilters()) {
+                if (named.first == "month") continue; // 只有一两个月，没有可并行的
+                if (columnar && !RollupCache::canAnswer(named.second)) continue;
+                for (int partitions : partitionCounts) {
+                    QTest::newRow(qPrintable(QString("%1/%2/%3/%4").arg(size, named.first,
+                                                                         columnar ? "columnar" : "sql",
+                                                                         partitions == 1 ? "sequential" : "parallel")))
+                        << rows << named.first << columnar << partitions;
+                }
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::monthlyReport()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, filterName);
+    QFETCH(bool, columnar);
+    QFETCH(int, partitions);
+    QVERIFY(useLedger(rows, columnar));
+
+    RecordFilter filter;
+    for (const auto &named : namedFilters()) {
+        if (named.first == filterName) filter = named.second;
+    }
+    const auto source = columnar ? ParallelAggregator::Source::Columnar : ParallelAggregator::Source::Sql;
+
+    MonthlyReportPtr sequential = ParallelAggregator::compute(filter, 1, source);
+    QVERIFY(sequential);
+    if (partitions > 1) {
+        MonthlyReportPtr parallel = ParallelAggregator::compute(filter, partitions, source);
+        QVERIFY(parallel);
+        QVERIFY(*parallel == *sequential);
+    }
+    QBENCHMARK { QVERIFY(ParallelAggregator::compute(filter, partitions, source)); }
+}
+
+// 连续编辑 100 个单元格：每次直接写入 (各自提交) 与经过延迟写入队列 (写日志，最后一个事务写入) 对比
+// 改的是备注，测完还原
+void LedgerBenchmark::cellEdits_data()
+{
+    addSizeColumn();
+    QTest::addColumn<bool>("queued");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        QTest::newRow(qPrintable(size + "/direct")) << rows << false;
+        QTest::newRow(qPrintable(size + "/queued")) << rows << true;
+    }
+}
+
+void LedgerBenchmark::cellEdits()
+{
+    QFETCH(qint64, rows);
+    QFETCH(bool, queued);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+
+    const int edits = 100;
+    QSqlQuery query;
+    QVERIFY(query.exec(QString("SELECT id, note FROM record ORDER BY id DESC LIMIT %1").arg(edits)));
+    QList<QPair<qint64, QString>> original;
+    while (query.next()) original << qMakePair(query.value(0).toLongLong(), query.value(1).toString());
+    QCOMPARE(original.size(), edits);
+
+    ScopedMutation mutation(this);
+    for (const auto &record : original) {
+        mutation.onRestore("UPDATE record SET note = ? WHERE id = ?", {record.second, record.first});
+    }
+
+    int round = 0;
+    QBENCHMARK {
+        ++round;
+        for (const auto &record : original) {
+            QString note = QString("基准测试 %1").arg(round);
+            if (queued) {
+                QVERIFY(manager.edits().enqueue(record.first, "note", note));
+            } else {
+                QVERIFY(manager.updateRecordField(record.first, "note", note));
+            }
+        }
+        QVERIFY(manager.edits().flush());
+    }
+}
+
+// 删除分类并保留账单：把约 1% 的支出记录放进一个临时分类，测量删除 (账单转入“未分类”)
+// 测完按原分类还原并重新打开账本，后续测试看到的数据不变
+void LedgerBenchmark::removeCategoryKeepRecords_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::removeCategoryKeepRecords()
+{
+    QFETCH(qint64, rows);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+
+    QSqlQuery query;
+    QVERIFY(query.exec("SELECT MAX(id) FROM category") && query.next());
+    int maxCategoryId = query.value(0).toInt();
+
+    // 还原：记录回到原分类，删掉本测试新建的分类 (含可能新建的“未分类”)；缓存随重新打开恢复
+    ScopedMutation mutation(this);
+    mutation.onRestore(QString("DELETE FROM category WHERE id > %1").arg(maxCategoryId));
+
+    QVERIFY(manager.addCategory("基准测试分类", 0));
+    QVERIFY(query.exec("SELECT MAX(id) FROM category") && query.next());
+    int tempId = query.value(0).toInt();
+
+    QVERIFY(query.exec("DROP TABLE IF EXISTS temp.bench_moved"));
+    QVERIFY(query.exec("CREATE TEMP TABLE bench_moved AS SELECT id, cid FROM record "
+                       "WHERE id % 100 = 0 AND cid IN (SELECT id FROM category WHERE type = 0)"));
+    mutation.onRestore("DROP TABLE temp.bench_moved");
+    mutation.onRestore("UPDATE record SET cid = (SELECT m.cid FROM temp.bench_moved m WHERE m.id = record.id) "
+                       "WHERE id IN (SELECT id FROM temp.bench_moved)");
+    QVERIFY(query.exec(QString("UPDATE record SET cid = %1 WHERE id IN (SELECT id FROM temp.bench_moved)").arg(tempId)));
+
+    QBENCHMARK_ONCE {
+        QVERIFY(manager.removeCategory(tempId, 0, true));
+    }
+}
+
+// 对整个筛选结果的批量操作 (一条语句、一个事务，含汇总缓存的增量更新)；测完还原数据并重新打开
+void LedgerBenchmark::batchEdit_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("filterName");
+    QTest::addColumn<QString>("operation");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (const QString &name : {QString("month"), QString("year")}) {
+            for (const QString &operation : {QString("delete"), QString("recategorize"), QString("shiftDate")}) {
+                QTest::newRow(qPrintable(QString("%1/%2/%3").arg(size, name, operation))) << rows << name << operation;
+            }
+        }
+    }
+}
+
+void LedgerBenchmark::batchEdit()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, filterName);
+    QFETCH(QString, operation);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+
+    RecordFilter filter;
+    for (const auto &named : namedFilters()) {
+        if (named.first == filterName) filter = named.second;
+    }
+    const RecordSelection selection = RecordSelection::byFilter(filter);
+
+    QSqlQuery query;
+    QVERIFY(query.exec("DROP TABLE IF EXISTS temp.bench_batch"));
+    QVERIFY(query.exec("CREATE TEMP TABLE bench_batch AS SELECT * FROM record WHERE " + filter.toRecordSql()));
+
+    // 还原：按原 ID 写回原来的内容 (全文索引由触发器同步)
+    ScopedMutation mutation(this);
+    mutation.onRestore("DROP TABLE temp.bench_batch");
+    mutation.onRestore("INSERT INTO record SELECT * FROM temp.bench_batch");
+    mutation.onRestore("DELETE FROM record WHERE id IN (SELECT id FROM temp.bench_batch)");
+
+    int affected = 0;
+    QBENCHMARK_ONCE {
+        if (operation == "delete") {
+            QVERIFY(manager.deleteRecords(selection, &affected));
+        } else if (operation == "recategorize") {
+            QVERIFY(manager.recategorizeRecords(selection, manager.categories().categories(0).first().id, &affected));
+        } else {
+            QVERIFY(manager.shiftRecords(selection, 86400, &affected));
+        }
+    }
+    QVERIFY(affected > 0);
+}
+
+// 预算计数：一串随机写操作 (记账、改金额/时间/分类、删除、批量改分类/平移日期、删除分类保留账单)，
+// 每一步之后与 SQL 重新统计的本月花费逐分比对；再对比读取计数与用 SQL 重新统计一次的耗时
+// 操作的都是本测试新记的账单 (备注为标记)，测完删除，并删掉新建的分类与设置的预算
+void LedgerBenchmark::budgetCounters_data()
+{
+    addSizeColumn();
+    QTest::addColumn<bool>("recompute");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        QTest::newRow(qPrintable(size + "/counter")) << rows << false;
+        QTest::newRow(qPrintable(size + "/recompute")) << rows << true;
+    }
+}
+
+void LedgerBenchmark::budgetCounters()
+{
+    QFETCH(qint64, rows);
+    QFETCH(bool, recompute);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+    BudgetTracker &budgets = manager.budgets();
+
+    QSqlQuery query;
+    QVERIFY(query.exec("SELECT MAX(id) FROM category") && query.next());
+    const int maxCategoryId = query.value(0).toInt();
+    const QString marker = "预算基准";
+
+    // 还原：删掉标记的账单、新建的分类 (含可能新建的“未分类”) 与全部预算
+    ScopedMutation mutation(this);
+    mutation.onRestore("DELETE FROM budget");
+    mutation.onRestore(QString("DELETE FROM category WHERE id > %1").arg(maxCategoryId));
+    mutation.onRestore("DELETE FROM record WHERE note = ?", {marker});
+
+    QVector<CategoryInfo> expense = manager.categories().categories(0);
+    QVERIFY(expense.size() >= 2);
+    for (const CategoryInfo &info : expense) {
+        QVERIFY(manager.setBudget(info.id, 100000));
+    }
+
+    auto markedIds = [&marker]() {
+        QList<qint64> ids;
+        QSqlQuery marked;
+        marked.prepare("SELECT id FROM record WHERE note = :note");
+        marked.bindValue(":note", marker);
+        if (marked.exec()) {
+            while (marked.next()) ids << marked.value(0).toLongLong();
+        }
+        return ids;
+    };
+
+    if (!recompute) {
+        const QDate today = QDate::currentDate();
+        const QDateTime monthStart(QDate(today.year(), today.month(), 1), QTime(0, 0));
+        const int span = int(qMax<qint64>(1, monthStart.secsTo(QDateTime::currentDateTime())));
+        QRandomGenerator random(SyntheticLedger::DefaultSeed);
+        auto randomCategory = [&]() { return expense[random.bounded(int(expense.size()))].id; };
+
+        for (int step = 0; step < 300; ++step) {
+            const QList<qint64> ids = markedIds();
+            const int operation = ids.isEmpty() ? 0 : random.bounded(8);
+            const qint64 id = ids.isEmpty() ? -1 : ids[random.bounded(int(ids.size()))];
+            const QList<qint64> sample = ids.mid(random.bounded(int(qMax<qsizetype>(1, ids.size()))), 5);
+
+            switch (operation) {
+            case 0:
+                QVERIFY(manager.insertRecord(random.bounded(1, 50000), monthStart.addSecs(random.bounded(span)),
+                                             marker, randomCategory()));
+                break;
+            case 1:
+                QVERIFY(manager.updateRecordField(id, "amount_cents", qint64(random.bounded(1, 50000))));
+                break;
+            case 2: {
+                // 三分之一移到上个月，检验记录离开本月
+                QDateTime time = random.bounded(3) == 0 ? monthStart.addDays(-random.bounded(1, 28))
+                                                        : monthStart.addSecs(random.bounded(span));
+                QVERIFY(manager.updateRecordField(id, "timestamp", time.toSecsSinceEpoch()));
+                break;
+            }
+            case 3:
+                QVERIFY(manager.edits().enqueue(id, "cid", randomCategory()));
+                QVERIFY(manager.edits().flush());
+                break;
+            case 4:
+                QVERIFY(manager.deleteRecords(QList<qint64>{id}));
+                break;
+            case 5:
+                QVERIFY(manager.recategorizeRecords(RecordSelection::byIds(sample), randomCategory()));
+                break;
+            case 6:
+                QVERIFY(manager.shiftRecords(RecordSelection::byIds(sample), qint64(random.bounded(-3, 4)) * 86400));
+                break;
+            default: {
+                QVERIFY(manager.addCategory(QString("预算基准分类 %1").arg(step), 0));
+                QVERIFY(query.exec("SELECT MAX(id) FROM category") && query.next());
+                const int tempId = query.value(0).toInt();
+                QVERIFY(manager.setBudget(tempId, 5000));
+                for (int i = 0; i < 3; ++i) {
+                    QVERIFY(manager.insertRecord(random.bounded(1, 5000), monthStart.addSecs(random.bounded(span)),
+                                                 marker, tempId));
+                }
+                QVERIFY(manager.removeCategory(tempId, 0, true));
+                break;
+            }
+            }
+
+            const QStringList mismatches = budgets.verifyAgainstSql();
+            QVERIFY2(mismatches.isEmpty(), qPrintable(QString("step %1, operation %2: %3")
+                                                          .arg(step).arg(operation).arg(mismatches.join("; "))));
+        }
+
+        QBENCHMARK { QVERIFY(budgets.total().budgetCents > 0); }
+    } else {
+        QBENCHMARK { QVERIFY(budgets.verifyAgainstSql().isEmpty()); }
+    }
+}
+
+// 重复账单补生成：60 条规则 (每天/每周/每月各 20 条) 从三年前开始、一直没有生成过，
+// 测量一个事务补齐全部到期账单；之后立即再跑一次，不应再生成任何账单
+// 测完删除生成的账单与规则，并重新打开账本 (补生成在独立连接上写入，没有计入缓存)
+void LedgerBenchmark::recurringCatchUp_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::recurringCatchUp()
+{
+    QFETCH(qint64, rows);
+    QVERIFY(useLedger(rows));
+    DatabaseManager &manager = DatabaseManager::instance();
+
+    const QString marker = "重复基准";
+    const QDateTime now = QDateTime::currentDateTime();
+    const QVector<CategoryInfo> categories = manager.categories().categories();
+    QVERIFY(!categories.isEmpty());
+
+    // 还原：删除生成的账单与规则 (补生成在独立连接上写入，没有计入缓存，随重新打开恢复)
+    ScopedMutation mutation(this);
+    mutation.onRestore("DELETE FROM recurring_rule WHERE note = ?", {marker});
+    mutation.onRestore("DELETE FROM record WHERE note = ?", {marker});
+
+    qint64 expected = 0;
+    for (int i = 0; i < 60; ++i) {
+        RecurringRule rule;
+        rule.cents = 1000 + i;
+        rule.cid = categories[i % categories.size()].id;
+        rule.note = marker;
+        rule.start = now.addYears(-3).addSecs(i * 3600);
+        rule.unit = RecurringRule::Unit(i % 3);
+        QVERIFY(manager.addRecurringRule(rule));
+        // 到 now 为止到期的次数
+        while (rule.occurrence(rule.generated) <= now) ++rule.generated;
+        expected += rule.generated;
+    }
+
+    RecurringScheduler scheduler;
+    RecurringScheduler::Result result;
+    QBENCHMARK_ONCE {
+        result = scheduler.run(ledgerPath(rows), now);
+    }
+    QVERIFY2(result.error.isEmpty(), qPrintable(result.error));
+    QCOMPARE(result.generated, expected);
+
+    QSqlQuery query;
+    query.prepare("SELECT count(*) FROM record WHERE note = :note");
+    query.bindValue(":note", marker);
+    QVERIFY(query.exec() && query.next());
+    QCOMPARE(query.value(0).toLongLong(), expected);
+
+    // 幂等：进度已随账单提交，再跑一次什么也不生成
+    RecurringScheduler::Result again = scheduler.run(ledgerPath(rows), now);
+    QVERIFY2(again.error.isEmpty(), qPrintable(again.error));
+    QCOMPARE(again.generated, qint64(0));
+    QVERIFY(again.nextDue.isValid() && again.nextDue > now);
+}
+
+// CSV 批量导入：与合成账本内容相同的 CSV (即 tools/datagen --csv 的输出，首次运行时生成并缓存)
+// 经 RecordImporter 导入一个空账本 (同步执行，与后台导入的代码路径相同)；目标至少每秒 10 万行
+void LedgerBenchmark::importCsv_data()
+{
+    addSizeRows();
+}
+
+void LedgerBenchmark::importCsv()
+{
+    QFETCH(qint64, rows);
+    DatabaseManager &manager = DatabaseManager::instance();
+    const QString target = m_outputDir.filePath("import.db");
+
+    // 导入的是临时账本：关闭后删掉它 (守卫最后还会关闭一次，下一项测试重新打开共享账本)
+    ScopedMutation mutation(this);
+    mutation.onRestore([target]() {
+        DatabaseManager::instance().closeDatabase();
+        for (const QString &suffix : {QString(), QString("-wal"), QString("-shm")}) {
+            QFile::remove(target + suffix);
+        }
+    });
+    manager.closeDatabase();
+    m_openRows = -1;
+
+    const QString csvPath = SyntheticLedger::ensureCsv(m_cacheDir, rows, m_seed);
+    QVERIFY2(!csvPath.isEmpty(), "cannot prepare synthetic csv");
+
+    // 空账本：走正常的打开流程建好表结构与默认分类
+    QVERIFY(manager.openDatabase(target, DatabaseManager::OpenMode::Headless));
+
+    RecordImporter importer;
+    RecordImporter::Result result;
+    QBENCHMARK_ONCE {
+        result = importer.run(csvPath, target);
+    }
+    QVERIFY2(result.error.isEmpty(), qPrintable(result.error));
+    QCOMPARE(result.imported, rows);
+    QCOMPARE(result.skipped, qint64(0));
+
+    const qint64 rowsPerSecond = result.imported * 1000 / qMax<qint64>(1, result.elapsedMs);
+    qInfo().noquote() << QString("%1: imported %2 rows in %3 ms, %4 rows/s")
+                             .arg(SyntheticLedger::sizeLabel(rows)).arg(result.imported)
+                             .arg(result.elapsedMs).arg(rowsPerSecond);
+    if (rowsPerSecond < 100000) {
+        qWarning().noquote() << "import throughput below the 100k rows/s target";
+    }
+}
+
+// CSV 导出 (同步执行，与后台导出的代码路径相同)
+void LedgerBenchmark::exportCsv_data()
+{
+    addSizeColumn();
+    QTest::addColumn<QString>("filterName");
+
+    for (qint64 rows : m_sizes) {
+        QString size = SyntheticLedger::sizeLabel(rows);
+        for (const QString &name : {QString("month"), QString("year"), QString("all")}) {
+            QTest::newRow(qPrintable(QString("%1/%2").arg(size, name))) << rows << name;
+        }
+    }
+}
+
+void LedgerBenchmark::exportCsv()
+{
+    QFETCH(qint64, rows);
+    QFETCH(QString, filterName);
+    QVERIFY(useLedger(rows));
+
+    RecordFilter filter;
+    for (const auto &named : namedFilters()) {
+        if (named.first == filterName) filter = named.second;
+    }
+    QString csvPath = m_outputDir.filePath("export.csv");
+
+    // 只读账本，不必重新打开；失败时也删掉输出文件
+    ScopedMutation mutation(this, false);
+    mutation.onRestore([csvPath]() { QFile::remove(csvPath); });
+
+    QBENCHMARK {
+        RecordExporter exporter;
+        RecordExporter::Result result = exporter.run(filter, csvPath, ledgerPath(rows));
+        QVERIFY2(result.error.isEmpty(), qPrintable(result.error));
+    }
+}
+
+QTEST_GUILESS_MAIN(LedgerBenchmark)
+
+#include "ledgerbenchmark.moc"
@@ -0,0 +1,224 @@
+#include "budgettracker.h"
+#include "ledgerqueries.h"
+#include "money.h"
+#include <QDateTime>
+#include <QSet>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+
+BudgetTracker::BudgetTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool BudgetTracker::reload(const QSqlDatabase &db)
+{
+    clear();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT cid, amount_cents, alert_percent FROM budget")) {
+        qDebug() << "Budget error:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        Budget budget;
+        budget.cents = query.value(1).toLongLong();
+        budget.alertPercent = query.value(2).toInt();
+        m_budgets.insert(query.value(0).toInt(), budget);
+    }
+
+    const QDate today = QDate::currentDate();
+    m_month = QDate(today.year(), today.month(), 1);
+    m_monthStart = QDateTime(m_month, QTime(0, 0)).toSecsSinceEpoch();
+    m_monthEnd = QDateTime(m_month.addMonths(1), QTime(0, 0)).toSecsSinceEpoch();
+    m_firstDay = int(m_month.toJulianDay());
+    m_lastDay = int(m_month.addMonths(1).toJulianDay()) - 1;
+    if (!loadSpent(db, &m_spent)) {
+        m_month = QDate();
+        return false;
+    }
+    emit changed();
+    return true;
+}
+
+void BudgetTracker::clear()
+{
+    m_budgets.clear();
+    m_spent.clear();
+    m_before.clear();
+    m_month = QDate();
+    m_monthStart = 0;
+    m_monthEnd = 0;
+    m_firstDay = 0;
+    m_lastDay = -1;
+}
+
+bool BudgetTracker::loadSpent(const QSqlDatabase &db, QHash<int, qint64> *spent) const
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(LedgerQueries::categorySums(m_monthStart, m_monthEnd - 1))) {
+        qDebug() << "Budget error:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        spent->insert(query.value(0).toInt(), query.value(1).toLongLong());
+    }
+    return true;
+}
+
+void BudgetTracker::apply(qint64 timestamp, int cid, qint64 cents)
+{
+    if (timestamp >= m_monthStart && timestamp < m_monthEnd) {
+        add(cid, cents);
+    }
+}
+
+void BudgetTracker::addDailyTotal(int day, int cid, qint64 cents)
+{
+    if (day >= m_firstDay && day <= m_lastDay) {
+        add(cid, cents);
+    }
+}
+
+void BudgetTracker::add(int cid, qint64 cents)
+{
+    if (cents == 0 || !m_month.isValid()) return;
+
+    qint64 &spent = m_spent[cid];
+    if (!m_before.contains(cid)) {
+        m_before.insert(cid, spent);
+    }
+    spent += cents;
+}
+
+void BudgetTracker::settle()
+{
+    if (m_before.isEmpty()) return;
+
+    // 与这次写入之前比：编辑是先减旧金额再加新金额，中间状态不算越过
+    for (auto before = m_before.cbegin(); before != m_before.cend(); ++before) {
+        auto budget = m_budgets.constFind(before.key());
+        if (budget == m_budgets.constEnd()) continue;
+        const qint64 spent = m_spent.value(before.key());
+        const int thresholds[] = {budget->alertPercent, 100};
+        for (int i = 0; i < 2; ++i) {
+            const int percent = thresholds[i];
+            if (percent <= 0 || percent > 100 || (i == 0 && percent == 100)) continue;
+            const qint64 threshold = budget->cents * percent;
+            if (before.value() * 100 < threshold && spent * 100 >= threshold) {
+                emit thresholdCrossed(before.key(), percent, spent, budget->cents);
+            }
+        }
+    }
+    m_before.clear();
+    emit changed();
+}
+
+void BudgetTracker::moveCategory(int fromId, int toId)
+{
+    m_before.remove(fromId);
+    add(toId, m_spent.take(fromId));
+    if (m_budgets.remove(fromId) > 0) emit changed();
+}
+
+void BudgetTracker::removeCategory(int id)
+{
+    m_spent.remove(id);
+    m_before.remove(id);
+    if (m_budgets.remove(id) > 0) emit changed();
+}
+
+void BudgetTracker::setBudget(int cid, qint64 cents, int alertPercent)
+{
+    if (cents <= 0) {
+        m_budgets.remove(cid);
+    } else {
+        Budget budget;
+        budget.cents = cents;
+        budget.alertPercent = alertPercent;
+        m_budgets.insert(cid, budget);
+    }
+    emit changed();
+}
+
+void BudgetTracker::ensureCurrentMonth()
+{
+    const QDate today = QDate::currentDate();
+    if (m_month.isValid() && (today.year() != m_month.year() || today.month() != m_month.month())) {
+        // 跨月：上个月的计数作废，按新月份重新读入 (这期间落在新月份的写入都在数据库里)
+        reload();
+    }
+}
+
+BudgetTracker::Status BudgetTracker::statusOf(int cid, qint64 budgetCents, qint64 spentCents, int alertPercent) const
+{
+    Status status;
+    status.cid = cid;
+    status.budgetCents = budgetCents;
+    status.spentCents = spentCents;
+    status.alertPercent = alertPercent;
+
+    // 按已过天数 (含今天) 线性推算到月底
+    const QDate today = QDate::currentDate();
+    const int elapsed = qMax(1, today.day());
+    status.projectedCents = spentCents * today.daysInMonth() / elapsed;
+    return status;
+}
+
+QVector<BudgetTracker::Status> BudgetTracker::statuses()
+{
+    ensureCurrentMonth();
+    QList<int> ids = m_budgets.keys();
+    std::sort(ids.begin(), ids.end());
+
+    QVector<Status> result;
+    result.reserve(ids.size());
+    for (int cid : ids) {
+        const Budget &budget = m_budgets[cid];
+        result.append(statusOf(cid, budget.cents, m_spent.value(cid), budget.alertPercent));
+    }
+    return result;
+}
+
+BudgetTracker::Status BudgetTracker::total()
+{
+    ensureCurrentMonth();
+    qint64 budgetCents = 0;
+    qint64 spentCents = 0;
+    for (auto it = m_budgets.cbegin(); it != m_budgets.cend(); ++it) {
+        budgetCents += it->cents;
+        spentCents += m_spent.value(it.key());
+    }
+    return statusOf(-1, budgetCents, spentCents, DefaultAlertPercent);
+}
+
+QStringList BudgetTracker::verifyAgainstSql(const QSqlDatabase &db) const
+{
+    QStringList mismatches;
+    if (!m_month.isValid()) return mismatches;
+
+    QHash<int, qint64> expected;
+    if (!loadSpent(db, &expected)) {
+        mismatches << "query failed";
+        return mismatches;
+    }
+
+    // 计数里花费为 0 的分类与 SQL 里没有的分类视为一致
+    QSet<int> ids;
+    for (auto it = expected.cbegin(); it != expected.cend(); ++it) ids.insert(it.key());
+    for (auto it = m_spent.cbegin(); it != m_spent.cend(); ++it) ids.insert(it.key());
+    for (int cid : ids) {
+        const qint64 counted = m_spent.value(cid);
+        const qint64 actual = expected.value(cid);
+        if (counted != actual) {
+            mismatches << QString("%1 cid %2: counter %3, sql %4")
+                              .arg(m_month.toString("yyyy-MM")).arg(cid)
+                              .arg(Money::toString(counted), Money::toString(actual));
+        }
+    }
+    return mismatches;
+}
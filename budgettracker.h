@@ -0,0 +1,88 @@
+#ifndef BUDGETTRACKER_H
+#define BUDGETTRACKER_H
+
+#include <QDate>
+#include <QHash>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVector>
+#include "rollupcache.h"
+
+// 支出分类的月预算与本月花费的实时计数
+// 预算存在 budget 表里 (见 v7 迁移)；本月各分类的花费在打开数据库时用一条走时间索引的分组查询读入，
+// 之后由 DatabaseManager 在每次写入提交后按记录的增减调整 (插入、编辑、删除、批量操作、
+// 删除分类时并入“未分类”、导入)，每次调整只是一次哈希查找，读数不需要重新汇总
+// 花费越过提醒比例或预算本身的那一刻发出 thresholdCrossed；跨月后第一次读数时重新读入新月份
+class BudgetTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DefaultAlertPercent = 80;
+
+    // 一个分类 (或全部有预算分类合计) 的本月情况，金额均为分
+    struct Status {
+        int cid = -1;                 // 合计时为 -1
+        qint64 budgetCents = 0;
+        qint64 spentCents = 0;
+        qint64 projectedCents = 0;    // 按本月已过天数的花费速度推算到月底
+        int alertPercent = DefaultAlertPercent;
+
+        qint64 remainingCents() const { return budgetCents - spentCents; }
+    };
+
+    explicit BudgetTracker(QObject *parent = nullptr);
+
+    // 读入全部预算与本月花费 (db 默认为界面线程的连接)
+    bool reload(const QSqlDatabase &db = QSqlDatabase::database());
+    void clear();
+
+    // 由 DatabaseManager 在写入提交后调用，只有落在本月的变化才计入；
+    // 一次写入的全部调整做完后调用 settle()：越过阈值的发出提醒，再发出 changed()
+    void addEntry(const RollupCache::Entry &entry) { apply(entry.timestamp, entry.cid, entry.cents); }
+    void removeEntry(const RollupCache::Entry &entry) { apply(entry.timestamp, entry.cid, -entry.cents); }
+    void addDailyTotal(int day, int cid, qint64 cents); // day 为本地日期的儒略日
+    void moveCategory(int fromId, int toId);             // 删除分类并保留账单
+    void removeCategory(int id);                         // 删除分类 (预算随之删除)
+    void setBudget(int cid, qint64 cents, int alertPercent); // cents 不大于 0 时取消预算
+    void settle();
+
+    bool hasBudgets() const { return !m_budgets.isEmpty(); }
+    qint64 budget(int cid) const { return m_budgets.value(cid).cents; }
+
+    // 有预算的分类 (ID 升序) / 它们的合计
+    QVector<Status> statuses();
+    Status total();
+
+    // 重新用 SQL 统计本月各分类的花费，与计数逐分比对；返回不一致的描述，全部一致时返回空列表
+    QStringList verifyAgainstSql(const QSqlDatabase &db = QSqlDatabase::database()) const;
+
+signals:
+    void changed();
+    // 花费从低于到不低于 percent% 预算 (percent 为提醒比例或 100)
+    void thresholdCrossed(int cid, int percent, qint64 spentCents, qint64 budgetCents);
+
+private:
+    struct Budget {
+        qint64 cents = 0;
+        int alertPercent = DefaultAlertPercent;
+    };
+
+    void apply(qint64 timestamp, int cid, qint64 cents);
+    void add(int cid, qint64 cents);
+    bool loadSpent(const QSqlDatabase &db, QHash<int, qint64> *spent) const;
+    void ensureCurrentMonth();
+    Status statusOf(int cid, qint64 budgetCents, qint64 spentCents, int alertPercent) const;
+
+    QHash<int, Budget> m_budgets;
+    QHash<int, qint64> m_spent;   // 本月各分类的花费 (含没有预算的分类，设预算时无需再查)
+    QHash<int, qint64> m_before;  // 本次写入改动过的分类在写入前的花费，settle() 时比较
+    QDate m_month;                // 计数所属的月份 (1 号)，无效表示未加载
+    qint64 m_monthStart = 0;      // 本月的时间戳范围 [m_monthStart, m_monthEnd)
+    qint64 m_monthEnd = 0;
+    int m_firstDay = 0;           // 本月的儒略日范围 [m_firstDay, m_lastDay]
+    int m_lastDay = -1;
+};
+
+#endif // BUDGETTRACKER_H
@@ -0,0 +1,101 @@
+#include "categorycache.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// 图表配色：相邻 ID 颜色区分明显
+const quint32 kPalette[] = {
+    0xFF4E79A7, 0xFFF28E2B, 0xFFE15759, 0xFF76B7B2, 0xFF59A14F,
+    0xFFEDC948, 0xFFB07AA1, 0xFFFF9DA7, 0xFF9C755F, 0xFFBAB0AC
+};
+
+} // namespace
+
+CategoryCache::CategoryCache(QObject *parent)
+    : QObject(parent)
+{
+}
+
+quint32 CategoryCache::colorFor(int id)
+{
+    int size = int(std::size(kPalette));
+    return kPalette[((id % size) + size) % size];
+}
+
+bool CategoryCache::reload(const QSqlDatabase &db)
+{
+    m_byId.clear();
+    m_order.clear();
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name, type FROM category ORDER BY id")) {
+        qDebug() << "Category load error:" << query.lastError().text();
+        emit changed();
+        return false;
+    }
+    while (query.next()) {
+        CategoryInfo info;
+        info.id = query.value(0).toInt();
+        info.name = query.value(1).toString();
+        info.type = query.value(2).toInt();
+        info.color = colorFor(info.id);
+        m_byId.insert(info.id, info);
+        m_order.append(info.id);
+    }
+
+    emit changed();
+    return true;
+}
+
+const CategoryInfo *CategoryCache::find(int id) const
+{
+    auto it = m_byId.constFind(id);
+    return it != m_byId.constEnd() ? &it.value() : nullptr;
+}
+
+QString CategoryCache::name(int id) const
+{
+    const CategoryInfo *info = find(id);
+    return info ? info->name : QString();
+}
+
+QVector<CategoryInfo> CategoryCache::categories(int type) const
+{
+    QVector<CategoryInfo> result;
+    result.reserve(m_order.size());
+    for (int id : m_order) {
+        const CategoryInfo &info = m_byId[id];
+        if (type == -1 || info.type == type) {
+            result.append(info);
+        }
+    }
+    return result;
+}
+
+void CategoryCache::add(int id, const QString &name, int type)
+{
+    if (m_byId.contains(id)) return;
+
+    CategoryInfo info;
+    info.id = id;
+    info.name = name;
+    info.type = type;
+    info.color = colorFor(id);
+    m_byId.insert(id, info);
+
+    // 新分类的 ID 通常最大，直接追加；否则插到有序位置
+    m_order.insert(std::upper_bound(m_order.begin(), m_order.end(), id), id);
+    emit changed();
+}
+
+void CategoryCache::remove(int id)
+{
+    if (!m_byId.remove(id)) return;
+    m_order.removeOne(id);
+    emit changed();
+}
@@ -0,0 +1,53 @@
+#ifndef CATEGORYCACHE_H
+#define CATEGORYCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QSqlDatabase>
+
+// 分类信息 (ID -> 名称、类型、颜色)
+struct CategoryInfo
+{
+    int id = -1;
+    QString name;
+    int type = 0;        // 0支出, 1收入
+    quint32 color = 0;   // 图表配色 (0xAARRGGBB)，按 ID 固定分配
+};
+
+// 分类元数据的内存缓存 (界面线程使用)
+// 打开数据库时整表读入一次，之后由 DatabaseManager 在增删分类时同步更新并发出 changed()；
+// 表格绘制、下拉框、分类管理都从这里取数，不再访问数据库，也不按名称查找
+class CategoryCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CategoryCache(QObject *parent = nullptr);
+
+    // 从数据库重新读入全部分类
+    bool reload(const QSqlDatabase &db = QSqlDatabase::database());
+
+    // 按 ID 查找，不存在时返回 nullptr (绘制路径上使用：一次整数哈希查找)
+    const CategoryInfo *find(int id) const;
+    QString name(int id) const;
+
+    // 按 ID 顺序列出某一类型的分类，type 为 -1 时列出全部
+    QVector<CategoryInfo> categories(int type = -1) const;
+
+    // 由 DatabaseManager 在数据库写入成功后调用
+    void add(int id, const QString &name, int type);
+    void remove(int id);
+
+    static quint32 colorFor(int id);
+
+signals:
+    void changed();
+
+private:
+    QHash<int, CategoryInfo> m_byId;
+    QVector<int> m_order; // ID 升序，保持与数据库中的顺序一致
+};
+
+#endif // CATEGORYCACHE_H
@@ -1,6 +1,7 @@
 #include "categorydialog.h"
 #include "ui_categorydialog.h"
 #include "databasemanager.h"
+#include "money.h"
 #include <QInputDialog>
 #include <QMessageBox>
 
@@ -91,26 +92,56 @@ void CategoryDialog::on_btnDelete_clicked()
     }
 }
 
+void CategoryDialog::on_btnBudget_clicked()
+{
+    int type;
+    QListWidget *list = getCurrentList(type);
+    QListWidgetItem *item = list->currentItem();
+    if (type != 0) {
+        QMessageBox::warning(this, "提示", "预算只能设置给支出分类");
+        return;
+    }
+    if (!item) {
+        QMessageBox::warning(this, "提示", "请先选择一个分类");
+        return;
+    }
+
+    int id = item->data(Qt::UserRole).toInt();
+    qint64 current = DatabaseManager::instance().budgets().budget(id);
+
+    bool ok;
+    QString text = QInputDialog::getText(this, "设置月预算",
+                                         QString("“%1”每月预算 (留空或 0 表示取消):").arg(item->text()),
+                                         QLineEdit::Normal, current > 0 ? Money::toString(current) : QString(), &ok);
+    if (!ok) return;
+
+    qint64 cents = 0;
+    if (!text.trimmed().isEmpty() && !Money::parse(text, &cents)) {
+        QMessageBox::warning(this, "失败", "金额格式不正确。");
+        return;
+    }
+    if (DatabaseManager::instance().setBudget(id, cents)) {
+        loadAllCategories(); // 刷新预算提示
+    } else {
+        QMessageBox::critical(this, "错误", "设置预算失败");
+    }
+}
+
 void CategoryDialog::loadAllCategories()
 {
     ui->listExpense->clear();
     ui->listIncome->clear();
 
-    // 加载支出 (type=0)
-    QSqlQuery query0 = DatabaseManager::instance().getCategories(0);
-    while (query0.next()) {
-        QListWidgetItem *item = new QListWidgetItem(query0.value("name").toString());
+    // 从分类缓存加载，支出 (type=0) 与收入 (type=1) 分别放入两个列表
+    for (const CategoryInfo &category : DatabaseManager::instance().categories().categories()) {
+        QListWidgetItem *item = new QListWidgetItem(category.name);
         // 把 ID 存在 Item 的 UserRole 里，删除时要用
-        item->setData(Qt::UserRole, query0.value("id").toInt());
-        ui->listExpense->addItem(item);
-    }
-
-    // 加载收入 (type=1)
-    QSqlQuery query1 = DatabaseManager::instance().getCategories(1);
-    while (query1.next()) {
-        QListWidgetItem *item = new QListWidgetItem(query1.value("name").toString());
-        item->setData(Qt::UserRole, query1.value("id").toInt());
-        ui->listIncome->addItem(item);
+        item->setData(Qt::UserRole, category.id);
+        qint64 budget = DatabaseManager::instance().budgets().budget(category.id);
+        if (budget > 0) {
+            item->setToolTip("月预算 " + Money::toString(budget));
+        }
+        (category.type == 1 ? ui->listIncome : ui->listExpense)->addItem(item);
     }
 }
 
@@ -21,6 +21,8 @@ private slots:
 
     void on_btnDelete_clicked();
 
+    void on_btnBudget_clicked();
+
 private:
     Ui::CategoryDialog *ui;
 
@@ -0,0 +1,268 @@
+#include "chartupdater.h"
+#include "categorycache.h"
+#include "money.h"
+#include "uistallmonitor.h"
+#include <QDebug>
+#include <QSet>
+
+ChartUpdater::ChartUpdater(QChart *pieChart, QChart *trendChart, QObject *parent)
+    : QObject(parent)
+    , m_pieChart(pieChart)
+    , m_trendChart(trendChart)
+{
+    // 饼图
+    m_pieSeries = new QPieSeries();
+    m_pieChart->addSeries(m_pieSeries);
+    // 对于隐藏了标签的小切片，用户可以通过右侧图例看颜色对应
+    m_pieChart->legend()->setVisible(true);
+    m_pieChart->legend()->setAlignment(Qt::AlignRight);
+
+    // 趋势图：柱状图一套
+    m_barSeries = new QBarSeries();
+    m_incomeBars = new QBarSet("收入");
+    m_expenseBars = new QBarSet("支出");
+    m_incomeBars->setColor(QColor(60, 179, 113)); // MediumSeaGreen
+    m_expenseBars->setColor(QColor(220, 20, 60)); // Crimson
+    m_barSeries->append(m_incomeBars);
+    m_barSeries->append(m_expenseBars);
+    m_trendChart->addSeries(m_barSeries);
+
+    // 折线图一套
+    m_incomeLine = new QLineSeries();
+    m_expenseLine = new QLineSeries();
+    m_incomeLine->setName("收入");
+    m_expenseLine->setName("支出");
+    m_incomeLine->setColor(m_incomeBars->color());
+    m_expenseLine->setColor(m_expenseBars->color());
+    m_trendChart->addSeries(m_incomeLine);
+    m_trendChart->addSeries(m_expenseLine);
+
+    // 坐标轴：横轴各自一条，纵轴共用
+    m_barAxis = new QBarCategoryAxis();
+    m_dateAxis = new QDateTimeAxis();
+    m_valueAxis = new QValueAxis();
+    m_valueAxis->setLabelFormat("%.0f"); // 不显示小数
+    m_trendChart->addAxis(m_barAxis, Qt::AlignBottom);
+    m_trendChart->addAxis(m_dateAxis, Qt::AlignBottom);
+    m_trendChart->addAxis(m_valueAxis, Qt::AlignLeft);
+
+    m_barSeries->attachAxis(m_barAxis);
+    m_barSeries->attachAxis(m_valueAxis);
+    for (QLineSeries *line : {m_incomeLine, m_expenseLine}) {
+        line->attachAxis(m_dateAxis);
+        line->attachAxis(m_valueAxis);
+    }
+    showTrendMode(true);
+}
+
+ChartUpdater::~ChartUpdater()
+{
+    if (UiStallMonitor::isEnabled()) {
+        qDebug().noquote() << report();
+    }
+}
+
+void ChartUpdater::FrameStats::record(qint64 us, bool animate)
+{
+    ++updates;
+    if (animate) ++animated;
+    totalUs += us;
+    maxUs = qMax(maxUs, us);
+    sinceLast.start();
+}
+
+QString ChartUpdater::report() const
+{
+    auto describe = [](const FrameStats &stats) {
+        double avgMs = stats.updates > 0 ? stats.totalUs / 1000.0 / stats.updates : 0;
+        return QString("%1 updates, avg %2 ms, max %3 ms, %4 animated")
+            .arg(stats.updates)
+            .arg(avgMs, 0, 'f', 2)
+            .arg(stats.maxUs / 1000.0, 0, 'f', 2)
+            .arg(stats.animated);
+    };
+    return QString("Chart updates: pie %1; trend %2").arg(describe(m_pieStats), describe(m_trendStats));
+}
+
+bool ChartUpdater::shouldAnimate(const FrameStats &stats, int itemCount) const
+{
+    if (itemCount > MaxAnimatedItems) return false;
+    // 连续刷新 (例如按住日期微调) 时动画还没播完就被下一次打断，只剩开销
+    return !stats.sinceLast.isValid() || stats.sinceLast.elapsed() >= RapidUpdateMs;
+}
+
+QPieSlice *ChartUpdater::createSlice(int categoryId)
+{
+    QPieSlice *slice = new QPieSlice();
+    // 颜色按分类固定，切片增减时其余切片不会变色
+    slice->setColor(QColor::fromRgba(CategoryCache::colorFor(categoryId)));
+    slice->setLabelPosition(QPieSlice::LabelOutside); // 标签放外面
+
+    // 鼠标悬停 (Hover)：突出显示并强制展示标签，移出复原 (大于3%才显示)
+    // 每个切片只连接一次，占比在触发时再取
+    connect(slice, &QPieSlice::hovered, this, [slice](bool state) {
+        slice->setExploded(state);
+        slice->setLabelVisible(state || slice->percentage() >= 0.03);
+    });
+    return slice;
+}
+
+void ChartUpdater::updatePie(const AggregateSnapshot &snapshot)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 目标切片：快照里已按金额从大到小排好
+    QVector<const CategoryTotal*> wanted;
+    QSet<int> wantedIds;
+    for (const CategoryTotal &category : snapshot.categories()) {
+        if (category.cents > 0) {
+            wanted.append(&category);
+            wantedIds.insert(category.id);
+        }
+    }
+
+    bool animate = shouldAnimate(m_pieStats, wanted.size());
+    m_pieChart->setAnimationOptions(animate ? QChart::SeriesAnimations : QChart::NoAnimation);
+
+    // 去掉不再出现的分类
+    for (auto it = m_slices.begin(); it != m_slices.end();) {
+        if (!wantedIds.contains(it.key())) {
+            m_pieSeries->remove(it.value()); // remove() 会释放切片
+            it = m_slices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // 按目标顺序改值：新分类插入到位，位置不对的切片挪过去
+    for (int i = 0; i < wanted.size(); ++i) {
+        const CategoryTotal &category = *wanted[i];
+        QPieSlice *slice = m_slices.value(category.id);
+        if (!slice) {
+            slice = createSlice(category.id);
+            m_slices.insert(category.id, slice);
+            m_pieSeries->insert(i, slice);
+        } else if (m_pieSeries->slices().at(i) != slice) {
+            m_pieSeries->take(slice);
+            m_pieSeries->insert(i, slice);
+        }
+        slice->setValue(Money::toYuan(category.cents));
+    }
+
+    // 全部数值更新后占比才确定，再统一改标签
+    for (const CategoryTotal *category : wanted) {
+        QPieSlice *slice = m_slices.value(category->id);
+        double percent = slice->percentage(); // 0.0 ~ 1.0
+        slice->setLabel(QString("%1: %2%").arg(category->name, QString::number(percent * 100, 'f', 1)));
+        // 只有占比大于 3% 的才默认显示标签，防止重叠
+        slice->setLabelVisible(slice->isExploded() || percent >= 0.03);
+    }
+
+    m_pieStats.record(timer.nsecsElapsed() / 1000, animate);
+}
+
+void ChartUpdater::updateTrend(const TrendSeries &series)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int count = series.buckets().size();
+    bool bars = count <= MaxTrendBars;
+    // 折线图的点多，动画的开销远大于绘制本身
+    bool animate = bars && shouldAnimate(m_trendStats, count);
+    m_trendChart->setAnimationOptions(animate ? QChart::SeriesAnimations : QChart::NoAnimation);
+
+    // 让Y轴稍微高一点，避免柱子顶到头
+    double maxVal = series.maxCents() / 100.0;
+    m_valueAxis->setRange(0, maxVal == 0 ? 100 : maxVal * 1.2);
+
+    showTrendMode(bars);
+    if (bars) {
+        updateBars(series);
+    } else {
+        updateLines(series);
+    }
+
+    m_trendStats.record(timer.nsecsElapsed() / 1000, animate);
+}
+
+void ChartUpdater::showTrendMode(bool bars)
+{
+    m_barSeries->setVisible(bars);
+    m_barAxis->setVisible(bars);
+    m_incomeLine->setVisible(!bars);
+    m_expenseLine->setVisible(!bars);
+    m_dateAxis->setVisible(!bars);
+}
+
+void ChartUpdater::updateBars(const TrendSeries &series)
+{
+    const QVector<TrendBucket> &buckets = series.buckets();
+    QStringList categories;
+    QList<qreal> income;
+    QList<qreal> expense;
+    for (int i = 0; i < buckets.size(); ++i) {
+        categories << series.label(i);
+        income << buckets[i].incomeCents / 100.0;
+        expense << buckets[i].expenseCents / 100.0;
+    }
+
+    // 时间段数量不变时逐个改值 (柱子从旧值过渡到新值)，否则整组替换
+    if (m_incomeBars->count() == buckets.size()) {
+        for (int i = 0; i < buckets.size(); ++i) {
+            m_incomeBars->replace(i, income[i]);
+            m_expenseBars->replace(i, expense[i]);
+        }
+    } else {
+        if (m_incomeBars->count() > 0) {
+            m_incomeBars->remove(0, m_incomeBars->count());
+            m_expenseBars->remove(0, m_expenseBars->count());
+        }
+        m_incomeBars->append(income);
+        m_expenseBars->append(expense);
+    }
+
+    if (m_barAxis->categories() != categories) {
+        m_barAxis->setCategories(categories);
+    }
+    // 柱子少时才在柱子上显示数字，多了会互相遮挡
+    m_barSeries->setLabelsVisible(buckets.size() <= 6);
+}
+
+void ChartUpdater::updateLines(const TrendSeries &series)
+{
+    const QVector<TrendBucket> &buckets = series.buckets();
+    QVector<QPointF> incomePoints;
+    QVector<QPointF> expensePoints;
+    incomePoints.reserve(buckets.size());
+    expensePoints.reserve(buckets.size());
+    for (const TrendBucket &bucket : buckets) {
+        double x = QDateTime(bucket.start, QTime(0, 0)).toMSecsSinceEpoch();
+        incomePoints.append(QPointF(x, bucket.incomeCents / 100.0));
+        expensePoints.append(QPointF(x, bucket.expenseCents / 100.0));
+    }
+
+    // 点数超过绘图区宽度 (像素) 时降采样，多出的点画出来也分辨不出
+    int plotWidth = int(m_trendChart->plotArea().width());
+    int threshold = qMax(plotWidth > 0 ? plotWidth : int(m_trendChart->size().width()), 100);
+
+    // replace() 一次性换入全部点，只触发一次重绘
+    m_incomeLine->replace(TrendEngine::downsampleLttb(incomePoints, threshold));
+    m_expenseLine->replace(TrendEngine::downsampleLttb(expensePoints, threshold));
+
+    switch (series.granularity()) {
+    case TrendGranularity::Year:
+        m_dateAxis->setFormat("yyyy");
+        break;
+    case TrendGranularity::Month:
+        m_dateAxis->setFormat("yyyy-MM");
+        break;
+    default:
+        m_dateAxis->setFormat("yyyy-MM-dd");
+        break;
+    }
+    m_dateAxis->setTickCount(qMin(int(buckets.size()), 8));
+    m_dateAxis->setRange(QDateTime(buckets.first().start, QTime(0, 0)),
+                         QDateTime(buckets.last().start, QTime(0, 0)));
+}
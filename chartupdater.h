@@ -0,0 +1,73 @@
+#ifndef CHARTUPDATER_H
+#define CHARTUPDATER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QtCharts>
+#include "aggregationservice.h"
+#include "trendengine.h"
+
+// 图表的增量刷新
+// 饼图、趋势图的系列与坐标轴只创建一次，之后每次刷新只把新数据与当前内容比对：
+// 饼图按分类ID复用切片 (改值、改标签、调整顺序)，趋势图原地替换柱子/折线的数值；
+// 数据量大或刷新过于频繁 (连续调整筛选) 时关闭动画，避免动画叠加占满 CPU
+// 每次刷新的耗时记入统计，与 UiStallMonitor 同一开关，退出时输出汇总
+class ChartUpdater : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int RapidUpdateMs = 300;   // 距上次刷新不到这个时间视为连续刷新
+    static const int MaxAnimatedItems = 24; // 切片/柱组超过这个数不做动画
+    static const int MaxTrendBars = 36;     // 时间段不超过这个数画柱状图，更多时画折线图
+
+    ChartUpdater(QChart *pieChart, QChart *trendChart, QObject *parent = nullptr);
+    ~ChartUpdater() override;
+
+    void updatePie(const AggregateSnapshot &snapshot);
+    void updateTrend(const TrendSeries &series);
+
+    QString report() const;
+
+private:
+    // 一类图表的刷新耗时统计
+    struct FrameStats {
+        int updates = 0;
+        int animated = 0;
+        qint64 totalUs = 0;
+        qint64 maxUs = 0;
+        QElapsedTimer sinceLast; // 上一次刷新以来
+
+        void record(qint64 us, bool animate);
+    };
+
+    bool shouldAnimate(const FrameStats &stats, int itemCount) const;
+    QPieSlice *createSlice(int categoryId);
+    void updateBars(const TrendSeries &series);
+    void updateLines(const TrendSeries &series);
+    void showTrendMode(bool bars);
+
+    QChart *m_pieChart;
+    QChart *m_trendChart;
+
+    // 饼图：一个常驻系列，切片按分类ID复用
+    QPieSeries *m_pieSeries;
+    QHash<int, QPieSlice*> m_slices;
+
+    // 趋势图：柱状图与折线图各一套，按时间段数量切换显示，共用纵轴
+    QBarSeries *m_barSeries;
+    QBarSet *m_incomeBars;
+    QBarSet *m_expenseBars;
+    QBarCategoryAxis *m_barAxis;
+    QLineSeries *m_incomeLine;
+    QLineSeries *m_expenseLine;
+    QDateTimeAxis *m_dateAxis;
+    QValueAxis *m_valueAxis;
+
+    FrameStats m_pieStats;
+    FrameStats m_trendStats;
+};
+
+#endif // CHARTUPDATER_H
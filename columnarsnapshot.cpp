@@ -0,0 +1,500 @@
+#include "columnarsnapshot.h"
+#include "recordfilter.h"
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QSet>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+const char kMagic[8] = {'F', 'M', 'C', 'O', 'L', 'S', '1', '\0'};
+const quint32 kFormatVersion = 1;
+const quint32 kByteOrderMark = 0x01020304; // 按本机字节序写入，读出来不一致说明文件来自另一种架构
+
+qint64 align8(qint64 bytes)
+{
+    return (bytes + 7) & ~qint64(7);
+}
+
+} // namespace
+
+// 文件头，之后依次是各列 (每列起点按 8 字节对齐)，位置只由行数与堆大小决定
+struct ColumnarSnapshot::Header {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    qint64 ledgerId;
+    qint64 changeSeq;
+    qint64 rowCount;
+    qint64 heapBytes;
+    qint32 maxCategoryId;
+    qint32 reserved32;
+    qint64 reserved[2];
+};
+
+namespace {
+
+struct Layout {
+    qint64 ids;
+    qint64 timestamps;
+    qint64 cents;
+    qint64 cids;
+    qint64 noteOffsets; // rowCount + 1 个，第 i 条备注为 [offset[i], offset[i+1])
+    qint64 heap;
+    qint64 total;
+
+    Layout(qint64 header, qint64 rows, qint64 heapBytes)
+    {
+        ids = align8(header);
+        timestamps = ids + rows * qint64(sizeof(qint64));
+        cents = timestamps + rows * qint64(sizeof(qint64));
+        cids = cents + rows * qint64(sizeof(qint64));
+        noteOffsets = align8(cids + rows * qint64(sizeof(qint32)));
+        heap = align8(noteOffsets + (rows + 1) * qint64(sizeof(quint32)));
+        total = heap + heapBytes;
+    }
+};
+
+} // namespace
+
+// 写出之前在内存里拼好的各列
+struct ColumnarSnapshot::Columns {
+    qint64 ledgerId = 0;
+    qint64 changeSeq = 0;
+    QVector<qint64> ids;
+    QVector<qint64> timestamps;
+    QVector<qint64> cents;
+    QVector<qint32> cids;
+    QVector<quint32> noteOffsets = {0};
+    QByteArray heap;
+    qint32 maxCategoryId = 0;
+
+    void reserve(qsizetype rows)
+    {
+        ids.reserve(rows);
+        timestamps.reserve(rows);
+        cents.reserve(rows);
+        cids.reserve(rows);
+        noteOffsets.reserve(rows + 1);
+    }
+
+    // 备注偏移是 32 位的，字符串堆超过 4 GiB 或分类ID无效时返回 false (不建快照)
+    bool append(qint64 id, qint64 timestamp, qint64 amount, qint32 cid, const char *note, qsizetype length)
+    {
+        if (cid < 0 || quint64(heap.size()) + quint64(length) > std::numeric_limits<quint32>::max()) {
+            return false;
+        }
+        ids.append(id);
+        timestamps.append(timestamp);
+        cents.append(amount);
+        cids.append(cid);
+        heap.append(note, length);
+        noteOffsets.append(quint32(heap.size()));
+        maxCategoryId = qMax(maxCategoryId, cid);
+        return true;
+    }
+};
+
+bool ColumnarSnapshot::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    if (m_file.size() < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+    m_base = m_file.map(0, m_file.size());
+    if (!m_base) {
+        qDebug() << "Columnar snapshot map error:" << m_file.errorString();
+        close();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(m_base);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kFormatVersion
+        || header->byteOrder != kByteOrderMark || header->rowCount < 0 || header->heapBytes < 0
+        || header->maxCategoryId < 0) {
+        close();
+        return false;
+    }
+    Layout layout(sizeof(Header), header->rowCount, header->heapBytes);
+    if (layout.total != m_file.size()) {
+        close(); // 写了一半或被截断
+        return false;
+    }
+
+    m_header = header;
+    m_ids = reinterpret_cast<const qint64 *>(m_base + layout.ids);
+    m_timestamps = reinterpret_cast<const qint64 *>(m_base + layout.timestamps);
+    m_cents = reinterpret_cast<const qint64 *>(m_base + layout.cents);
+    m_cids = reinterpret_cast<const qint32 *>(m_base + layout.cids);
+    m_noteOffsets = reinterpret_cast<const quint32 *>(m_base + layout.noteOffsets);
+    m_heap = reinterpret_cast<const char *>(m_base + layout.heap);
+    return true;
+}
+
+void ColumnarSnapshot::close()
+{
+    if (m_base) {
+        m_file.unmap(m_base);
+    }
+    m_file.close();
+    m_base = nullptr;
+    m_header = nullptr;
+    m_ids = nullptr;
+    m_timestamps = nullptr;
+    m_cents = nullptr;
+    m_cids = nullptr;
+    m_noteOffsets = nullptr;
+    m_heap = nullptr;
+}
+
+qint64 ColumnarSnapshot::ledgerId() const
+{
+    return m_header ? m_header->ledgerId : 0;
+}
+
+qint64 ColumnarSnapshot::changeSeq() const
+{
+    return m_header ? m_header->changeSeq : 0;
+}
+
+qint64 ColumnarSnapshot::rowCount() const
+{
+    return m_header ? m_header->rowCount : 0;
+}
+
+int ColumnarSnapshot::maxCategoryId() const
+{
+    return m_header ? m_header->maxCategoryId : 0;
+}
+
+QByteArray ColumnarSnapshot::noteUtf8(qint64 row) const
+{
+    quint32 begin = m_noteOffsets[row];
+    return QByteArray::fromRawData(m_heap + begin, m_noteOffsets[row + 1] - begin);
+}
+
+QString ColumnarSnapshot::note(qint64 row) const
+{
+    quint32 begin = m_noteOffsets[row];
+    return QString::fromUtf8(m_heap + begin, m_noteOffsets[row + 1] - begin);
+}
+
+void ColumnarSnapshot::rowsInRange(qint64 fromSecs, qint64 toSecs, qint64 *first, qint64 *last) const
+{
+    const qint64 *begin = m_timestamps;
+    const qint64 *end = m_timestamps + rowCount();
+    *first = std::lower_bound(begin, end, fromSecs) - begin;
+    *last = qMax(*first, qint64(std::upper_bound(begin, end, toSecs) - begin));
+}
+
+void ColumnarSnapshot::sumByCategory(qint64 first, qint64 last, QVector<qint64> *cents, QVector<qint64> *counts) const
+{
+    cents->fill(0, maxCategoryId() + 1);
+    counts->fill(0, maxCategoryId() + 1);
+    qint64 *sums = cents->data();
+    qint64 *tallies = counts->data();
+
+    // 两列顺序读、按分类ID散列累加，循环里没有分支
+    for (qint64 i = first; i < last; ++i) {
+        const qint32 cid = m_cids[i];
+        sums[cid] += m_cents[i];
+        tallies[cid] += 1;
+    }
+}
+
+bool ColumnarSnapshot::sync(const QSqlDatabase &db, const QString &path, Stats *stats)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (stats) *stats = Stats();
+
+    // 读事务：日志序号与记录内容来自同一时刻，期间的写入留给下一次
+    QSqlDatabase connection = db;
+    connection.transaction();
+
+    QSqlQuery query(connection);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT value FROM ledger_meta WHERE key = 'ledger_id'") || !query.next()) {
+        qDebug() << "Columnar snapshot: no ledger id" << query.lastError().text();
+        connection.rollback();
+        return false;
+    }
+    const qint64 ledgerId = query.value(0).toLongLong();
+    qint64 latestSeq = 0;
+    if (query.exec("SELECT seq FROM sqlite_sequence WHERE name = 'change_log'") && query.next()) {
+        latestSeq = query.value(0).toLongLong();
+    }
+    query.finish();
+
+    // 同一个数据库、且不比日志新 (数据库被换成旧备份时快照会比日志新)
+    bool usable = open(path) && this->ledgerId() == ledgerId && changeSeq() <= latestSeq;
+    if (usable && changeSeq() == latestSeq) {
+        connection.commit();
+        if (stats) stats->elapsedMs = timer.elapsed();
+        return true;
+    }
+
+    Columns columns;
+    qint64 changed = 0;
+    bool merged = usable && merge(connection, changeSeq(), &columns, &changed);
+    if (!merged) {
+        columns = Columns();
+        if (!build(connection, &columns)) {
+            connection.rollback();
+            close();
+            return false;
+        }
+    }
+    connection.commit();
+    columns.ledgerId = ledgerId;
+    columns.changeSeq = latestSeq;
+
+    // 先解除旧文件的映射 (Windows 上映射中的文件不能被替换)
+    close();
+    if (!write(path, columns) || !open(path)) {
+        return false;
+    }
+
+    if (stats) {
+        stats->rebuilt = !merged;
+        stats->changed = changed;
+        stats->elapsedMs = timer.elapsed();
+    }
+    return true;
+}
+
+bool ColumnarSnapshot::build(const QSqlDatabase &db, Columns *columns) const
+{
+    // 按存储顺序 (ID) 整表顺序读，比沿时间索引逐行回表快；
+    // 账单大体按时间录入，读完基本有序，不是时再在内存里排一次
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, timestamp, amount_cents, cid, note FROM record")) {
+        qDebug() << "Columnar snapshot build error:" << query.lastError().text();
+        return false;
+    }
+
+    Columns raw;
+    bool ordered = true;
+    while (query.next()) {
+        const qint64 id = query.value(0).toLongLong();
+        const qint64 timestamp = query.value(1).toLongLong();
+        const QByteArray note = query.value(4).toString().toUtf8();
+        if (!raw.ids.isEmpty()) {
+            const qint64 prevTs = raw.timestamps.last();
+            ordered = ordered && (prevTs < timestamp || (prevTs == timestamp && raw.ids.last() < id));
+        }
+        if (!raw.append(id, timestamp, query.value(2).toLongLong(), query.value(3).toInt(), note.constData(), note.size())) {
+            qDebug() << "Columnar snapshot: ledger too large or invalid category";
+            return false;
+        }
+    }
+
+    if (ordered) {
+        *columns = std::move(raw);
+        return true;
+    }
+
+    QVector<qsizetype> order(raw.ids.size());
+    std::iota(order.begin(), order.end(), qsizetype(0));
+    std::sort(order.begin(), order.end(), [&raw](qsizetype a, qsizetype b) {
+        if (raw.timestamps[a] != raw.timestamps[b]) return raw.timestamps[a] < raw.timestamps[b];
+        return raw.ids[a] < raw.ids[b];
+    });
+
+    columns->reserve(order.size());
+    for (qsizetype i : order) {
+        const quint32 begin = raw.noteOffsets[i];
+        columns->append(raw.ids[i], raw.timestamps[i], raw.cents[i], raw.cids[i],
+                        raw.heap.constData() + begin, raw.noteOffsets[i + 1] - begin);
+    }
+    return true;
+}
+
+bool ColumnarSnapshot::merge(const QSqlDatabase &db, qint64 fromSeq, Columns *columns, qint64 *changed) const
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    // 日志必须从 fromSeq 之后连续：前面一段被清理过 (比如另一个进程的快照更新) 就不知道哪些记录变了
+    if (!query.exec(QString("SELECT MIN(seq) FROM change_log WHERE seq > %1").arg(fromSeq)) || !query.next()
+        || query.value(0).isNull() || query.value(0).toLongLong() != fromSeq + 1) {
+        return false;
+    }
+
+    QList<qint64> ids;
+    QSet<qint64> changedIds;
+    if (!query.exec(QString("SELECT DISTINCT record_id FROM change_log WHERE seq > %1").arg(fromSeq))) {
+        return false;
+    }
+    while (query.next()) {
+        qint64 id = query.value(0).toLongLong();
+        ids.append(id);
+        changedIds.insert(id);
+    }
+
+    // 变化的记录太多时，整表顺序读比逐条定位更快
+    if (ids.size() > qMax<qint64>(rowCount() / 4, 1000)) {
+        return false;
+    }
+    *changed = ids.size();
+
+    // 变化记录的当前内容 (已删除的查不到)，与旧快照一样按 (时间, ID) 排序
+    struct Fresh {
+        qint64 id;
+        qint64 timestamp;
+        qint64 cents;
+        qint32 cid;
+        QByteArray note;
+    };
+    QVector<Fresh> fresh;
+    if (!query.exec("SELECT id, timestamp, amount_cents, cid, note FROM record WHERE "
+                    + RecordSelection::byIds(ids).toRecordSql() + " ORDER BY timestamp, id")) {
+        qDebug() << "Columnar snapshot merge error:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        fresh.append({query.value(0).toLongLong(), query.value(1).toLongLong(), query.value(2).toLongLong(),
+                      query.value(3).toInt(), query.value(4).toString().toUtf8()});
+    }
+
+    // 两路归并：旧快照里跳过变化过的记录，变化记录的新内容按顺序插入
+    const qint64 rows = rowCount();
+    columns->reserve(rows + fresh.size());
+    qint64 i = 0;
+    qsizetype j = 0;
+    while (i < rows || j < fresh.size()) {
+        if (i < rows && changedIds.contains(m_ids[i])) {
+            ++i;
+            continue;
+        }
+        bool takeOld = j >= fresh.size()
+                       || (i < rows && (m_timestamps[i] < fresh[j].timestamp
+                                        || (m_timestamps[i] == fresh[j].timestamp && m_ids[i] < fresh[j].id)));
+        bool ok;
+        if (takeOld) {
+            const quint32 begin = m_noteOffsets[i];
+            ok = columns->append(m_ids[i], m_timestamps[i], m_cents[i], m_cids[i],
+                                 m_heap + begin, m_noteOffsets[i + 1] - begin);
+            ++i;
+        } else {
+            const Fresh &row = fresh[j];
+            ok = columns->append(row.id, row.timestamp, row.cents, row.cid, row.note.constData(), row.note.size());
+            ++j;
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool ColumnarSnapshot::write(const QString &path, const Columns &columns)
+{
+    // 先写临时文件再改名，中途失败不会留下半个快照
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Columnar snapshot write error:" << file.errorString();
+        return false;
+    }
+
+    const qint64 rows = columns.ids.size();
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.byteOrder = kByteOrderMark;
+    header.ledgerId = columns.ledgerId;
+    header.changeSeq = columns.changeSeq;
+    header.rowCount = rows;
+    header.heapBytes = columns.heap.size();
+    header.maxCategoryId = columns.maxCategoryId;
+
+    Layout layout(sizeof(Header), rows, columns.heap.size());
+    bool ok = true;
+    auto put = [&file, &ok](qint64 offset, const void *data, qint64 bytes) {
+        if (!ok) return;
+        if (file.pos() < offset) {
+            QByteArray padding(offset - file.pos(), '\0');
+            ok = file.write(padding) == padding.size();
+        }
+        ok = ok && file.write(static_cast<const char *>(data), bytes) == bytes;
+    };
+    put(0, &header, sizeof(header));
+    put(layout.ids, columns.ids.constData(), rows * qint64(sizeof(qint64)));
+    put(layout.timestamps, columns.timestamps.constData(), rows * qint64(sizeof(qint64)));
+    put(layout.cents, columns.cents.constData(), rows * qint64(sizeof(qint64)));
+    put(layout.cids, columns.cids.constData(), rows * qint64(sizeof(qint32)));
+    put(layout.noteOffsets, columns.noteOffsets.constData(), (rows + 1) * qint64(sizeof(quint32)));
+    put(layout.heap, columns.heap.constData(), columns.heap.size());
+
+    if (!ok || !file.commit()) { // 未提交的临时文件由 QSaveFile 丢弃
+        qDebug() << "Columnar snapshot write error:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ColumnarSnapshot::setChangeLogEnabled(const QSqlDatabase &db, bool enabled)
+{
+    static const QStringList triggers = {"change_log_ai", "change_log_ad", "change_log_au"};
+
+    QSqlDatabase connection = db;
+    QSqlQuery query(connection);
+    if (!query.exec("SELECT count(*) FROM sqlite_master WHERE type = 'trigger' AND name IN "
+                    "('change_log_ai', 'change_log_ad', 'change_log_au')") || !query.next()) {
+        qDebug() << "Change log error:" << query.lastError().text();
+        return false;
+    }
+    const int existing = query.value(0).toInt();
+    query.finish();
+    if (enabled ? existing == triggers.size() : existing == 0) return true;
+
+    QStringList statements;
+    if (enabled) {
+        statements << "CREATE TRIGGER IF NOT EXISTS change_log_ai AFTER INSERT ON record BEGIN "
+                      "INSERT INTO change_log(record_id) VALUES (new.id); END"
+                   << "CREATE TRIGGER IF NOT EXISTS change_log_ad AFTER DELETE ON record BEGIN "
+                      "INSERT INTO change_log(record_id) VALUES (old.id); END"
+                   // ID 本身被改掉时，旧 ID 也算变化 (快照里要删掉它)
+                   << "CREATE TRIGGER IF NOT EXISTS change_log_au AFTER UPDATE ON record BEGIN "
+                      "INSERT INTO change_log(record_id) VALUES (new.id); "
+                      "INSERT INTO change_log(record_id) SELECT old.id WHERE old.id <> new.id; END"
+                   << "UPDATE ledger_meta SET value = abs(random()) WHERE key = 'ledger_id'";
+    } else {
+        for (const QString &trigger : triggers) {
+            statements << "DROP TRIGGER IF EXISTS " + trigger;
+        }
+        statements << "DELETE FROM change_log";
+    }
+
+    connection.transaction();
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "Change log error:" << sql << query.lastError().text();
+            connection.rollback();
+            return false;
+        }
+    }
+    return connection.commit();
+}
+
+bool ColumnarSnapshot::pruneLog(const QSqlDatabase &db, qint64 upToSeq)
+{
+    QSqlQuery query(db);
+    bool ok = upToSeq < 0 ? query.exec("DELETE FROM change_log")
+                          : query.exec(QString("DELETE FROM change_log WHERE seq <= %1").arg(upToSeq));
+    if (!ok) {
+        qDebug() << "Change log prune error:" << query.lastError().text();
+    }
+    return ok;
+}
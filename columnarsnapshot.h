@@ -0,0 +1,85 @@
+#ifndef COLUMNARSNAPSHOT_H
+#define COLUMNARSNAPSHOT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+// 列式快照 (可选，finance.db-columns)
+// 全部记录按 (时间, ID) 排好，每一列是一段连续的定长数组：ID、时间戳、金额 (分)、分类ID、备注偏移，
+// 备注统一放在末尾的字符串堆 (UTF-8)；文件直接内存映射，统计时顺序扫描数组，不经过 SQL 驱动，不解析、不拷贝
+// 快照只读：数据库的每次增删改由触发器记进 change_log (见 setChangeLogEnabled)，sync() 只重读日志里出现的记录，
+// 与旧快照合并后整体写出新文件，因此不会与 SQLite 不一致；日志不连续或变化太多时全量重建
+// 文件按本机字节序存放，只是数据库的派生缓存，删掉随时可以重建
+class ColumnarSnapshot
+{
+public:
+    struct Stats {
+        bool rebuilt = false;   // 全量重建 (否则为增量合并或无变化)
+        qint64 changed = 0;     // 增量合并时重读的记录数
+        qint64 elapsedMs = 0;
+    };
+
+    ColumnarSnapshot() = default;
+    ~ColumnarSnapshot() { close(); }
+    ColumnarSnapshot(const ColumnarSnapshot &) = delete;
+    ColumnarSnapshot &operator=(const ColumnarSnapshot &) = delete;
+
+    // 打开 path 处的快照并按 db 的变更日志补到最新 (读操作在一个读事务里，db 可以是只读连接)
+    // 快照不存在、来自别的数据库或已无法增量更新时全量重建；成功后快照保持映射
+    bool sync(const QSqlDatabase &db, const QString &path, Stats *stats = nullptr);
+
+    // 只映射已有的快照文件，不检查是否最新
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+
+    qint64 ledgerId() const;  // 所属数据库 (ledger_meta 里的账本 ID)
+    qint64 changeSeq() const; // 已包含到的变更日志序号
+    qint64 rowCount() const;
+    int maxCategoryId() const;
+
+    // 各列 (下标为行号，按时间升序、同一时间按 ID 升序)
+    const qint64 *ids() const { return m_ids; }
+    const qint64 *timestamps() const { return m_timestamps; }
+    const qint64 *cents() const { return m_cents; }
+    const qint32 *categoryIds() const { return m_cids; }
+    QByteArray noteUtf8(qint64 row) const; // 指向映射内存，不拷贝
+    QString note(qint64 row) const;
+
+    // 时间戳落在 [fromSecs, toSecs] 的行：[*first, *last) (二分查找)
+    void rowsInRange(qint64 fromSecs, qint64 toSecs, qint64 *first, qint64 *last) const;
+
+    // 按分类合计 [first, last) 行：下标为分类ID，数组长度为 maxCategoryId() + 1
+    void sumByCategory(qint64 first, qint64 last, QVector<qint64> *cents, QVector<qint64> *counts) const;
+
+    // 删除已被快照吸收的变更日志 (需要可写连接)；upToSeq 为 -1 时清空
+    static bool pruneLog(const QSqlDatabase &db, qint64 upToSeq);
+
+    // 记录变更日志的触发器只在启用快照时存在，不启用的账本每次写入不必多写一行日志 (需要可写连接)
+    // 启用时若触发器原本不在 (期间的写入没有记日志)，同时换一个账本 ID，已有的快照随之作废、全量重建；
+    // 停用时删掉触发器并清空日志
+    static bool setChangeLogEnabled(const QSqlDatabase &db, bool enabled);
+
+private:
+    struct Columns;
+    struct Header;
+
+    bool build(const QSqlDatabase &db, Columns *columns) const;
+    bool merge(const QSqlDatabase &db, qint64 fromSeq, Columns *columns, qint64 *changed) const;
+    static bool write(const QString &path, const Columns &columns);
+
+    QFile m_file;
+    uchar *m_base = nullptr;
+    const Header *m_header = nullptr;
+    const qint64 *m_ids = nullptr;
+    const qint64 *m_timestamps = nullptr;
+    const qint64 *m_cents = nullptr;
+    const qint32 *m_cids = nullptr;
+    const quint32 *m_noteOffsets = nullptr;
+    const char *m_heap = nullptr;
+};
+
+#endif // COLUMNARSNAPSHOT_H
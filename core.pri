@@ -0,0 +1,61 @@
+# 账本核心：数据库、筛选、汇总、导入导出
+# 不依赖界面，主程序与基准测试共用同一份源码
+
+QT += core sql concurrent
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# 可选：直接链接 SQLite，用于中断被新筛选取代的查询 (sqlite3_interrupt)
+# 只在 Qt 使用系统 SQLite (system_sqlite) 时启用，运行时还会确认版本一致
+packagesExist(sqlite3) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += sqlite3
+    DEFINES += FM_HAVE_SQLITE_API
+}
+
+SOURCES += \
+    $$PWD/aggregationservice.cpp \
+    $$PWD/budgettracker.cpp \
+    $$PWD/categorycache.cpp \
+    $$PWD/columnarsnapshot.cpp \
+    $$PWD/csvformat.cpp \
+    $$PWD/databasemanager.cpp \
+    $$PWD/editqueue.cpp \
+    $$PWD/headlessreport.cpp \
+    $$PWD/ledgerqueries.cpp \
+    $$PWD/money.cpp \
+    $$PWD/parallelaggregator.cpp \
+    $$PWD/recordexporter.cpp \
+    $$PWD/recordfilter.cpp \
+    $$PWD/recordimporter.cpp \
+    $$PWD/recurringscheduler.cpp \
+    $$PWD/rollupcache.cpp \
+    $$PWD/startupprofiler.cpp \
+    $$PWD/statementcache.cpp \
+    $$PWD/storageprofile.cpp \
+    $$PWD/trendengine.cpp
+
+HEADERS += \
+    $$PWD/aggregationservice.h \
+    $$PWD/budgettracker.h \
+    $$PWD/categorycache.h \
+    $$PWD/columnarsnapshot.h \
+    $$PWD/csvformat.h \
+    $$PWD/databasemanager.h \
+    $$PWD/editqueue.h \
+    $$PWD/headlessreport.h \
+    $$PWD/ledgerqueries.h \
+    $$PWD/money.h \
+    $$PWD/parallelaggregator.h \
+    $$PWD/recordexporter.h \
+    $$PWD/recordfilter.h \
+    $$PWD/recordimporter.h \
+    $$PWD/recurringscheduler.h \
+    $$PWD/rollupcache.h \
+    $$PWD/startupprofiler.h \
+    $$PWD/statementcache.h \
+    $$PWD/storageprofile.h \
+    $$PWD/trendengine.h
@@ -0,0 +1,163 @@
+#include "csvformat.h"
+#include <QDateTime>
+
+namespace {
+
+// 从 p 开始解析一条记录，返回下一条记录的起始位置
+const char *parseRecord(const char *p, const char *end, QStringList &fields)
+{
+    fields.clear();
+    QByteArray field;
+    bool inQuotes = false;
+    bool quoted = false;
+
+    while (p < end) {
+        char ch = *p;
+        if (inQuotes) {
+            if (ch == '"') {
+                if (p + 1 < end && p[1] == '"') {
+                    field += '"'; // "" 转义
+                    p += 2;
+                    continue;
+                }
+                inQuotes = false;
+            } else {
+                field += ch;
+            }
+            ++p;
+            continue;
+        }
+
+        if (ch == '"' && field.isEmpty() && !quoted) {
+            inQuotes = true;
+            quoted = true;
+        } else if (ch == ',') {
+            fields << QString::fromUtf8(field);
+            field.clear();
+            quoted = false;
+        } else if (ch == '\n' || ch == '\r') {
+            // CRLF 视为一个换行
+            if (ch == '\r' && p + 1 < end && p[1] == '\n') ++p;
+            ++p;
+            fields << QString::fromUtf8(field);
+            return p;
+        } else {
+            field += ch;
+        }
+        ++p;
+    }
+
+    fields << QString::fromUtf8(field);
+    return p;
+}
+
+bool isBlank(const QStringList &fields)
+{
+    return fields.size() == 1 && fields.first().isEmpty();
+}
+
+} // namespace
+
+QList<QPair<qint64, qint64>> CsvFormat::splitChunks(const char *data, qint64 size, qint64 chunkSize)
+{
+    // 只做一次顺序扫描统计引号奇偶，切分点一定落在引号外的换行之后
+    QList<QPair<qint64, qint64>> chunks;
+    qint64 chunkStart = 0;
+    bool inQuotes = false;
+
+    for (qint64 i = 0; i < size; ++i) {
+        char ch = data[i];
+        if (ch == '"') {
+            inQuotes = !inQuotes; // "" 转义会翻转两次，不影响结果
+        } else if (ch == '\n' && !inQuotes && i + 1 - chunkStart >= chunkSize) {
+            chunks.append(qMakePair(chunkStart, i + 1));
+            chunkStart = i + 1;
+        }
+    }
+    if (chunkStart < size) {
+        chunks.append(qMakePair(chunkStart, size));
+    }
+    return chunks;
+}
+
+QList<QStringList> CsvFormat::parseRecords(const char *begin, const char *end)
+{
+    QList<QStringList> records;
+    QStringList fields;
+    const char *p = begin;
+    while (p < end) {
+        p = parseRecord(p, end, fields);
+        if (!isBlank(fields)) {
+            records.append(fields);
+        }
+    }
+    return records;
+}
+
+qint64 CsvFormat::parseFirstRecord(const char *data, qint64 size, QStringList *fields)
+{
+    const char *p = data;
+    const char *end = data + size;
+    do {
+        p = parseRecord(p, end, *fields);
+    } while (p < end && isBlank(*fields));
+    return p - data;
+}
+
+void CsvFormat::appendField(QByteArray &out, const QString &field)
+{
+    appendField(out, field.toUtf8());
+}
+
+void CsvFormat::appendField(QByteArray &out, const QByteArray &utf8)
+{
+    bool needsQuotes = false;
+    for (char ch : utf8) {
+        if (ch == ',' || ch == '"' || ch == '\n' || ch == '\r') {
+            needsQuotes = true;
+            break;
+        }
+    }
+
+    if (!needsQuotes) {
+        out += utf8;
+        return;
+    }
+
+    out += '"';
+    for (char ch : utf8) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+QByteArray CsvFormat::exportHeader()
+{
+    // BOM：解决 Excel 中文乱码
+    return QByteArray("\xEF\xBB\xBF") + "ID,金额,时间,备注,分类,类型\r\n";
+}
+
+void CsvFormat::TimeFormatter::append(QByteArray &out, qint64 timestamp)
+{
+    if (timestamp < m_start || timestamp >= m_end) {
+        QDate date = QDateTime::fromSecsSinceEpoch(timestamp).date();
+        m_start = QDateTime(date, QTime(0, 0)).toSecsSinceEpoch();
+        m_end = QDateTime(date.addDays(1), QTime(0, 0)).toSecsSinceEpoch();
+        m_datePrefix = date.toString("yyyy-MM-dd ").toLatin1();
+    }
+
+    if (m_end - m_start != 86400) {
+        out += QDateTime::fromSecsSinceEpoch(timestamp).toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+        return;
+    }
+
+    int secs = int(timestamp - m_start);
+    char time[8] = {
+        char('0' + secs / 36000), char('0' + secs / 3600 % 10), ':',
+        char('0' + secs % 3600 / 600), char('0' + secs % 3600 / 60 % 10), ':',
+        char('0' + secs % 60 / 10), char('0' + secs % 10)
+    };
+    out += m_datePrefix;
+    out.append(time, sizeof(time));
+}
@@ -0,0 +1,46 @@
+#ifndef CSVFORMAT_H
+#define CSVFORMAT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+// RFC 4180 CSV 的读写工具 (UTF-8)
+// 导入时在多个线程上并行解析，导出时用于字段转义
+namespace CsvFormat
+{
+    // 把 [begin, end) 按“不在引号内的换行”切成大约 chunkSize 字节的若干段，
+    // 每段都从一条记录的开头开始，可以独立解析
+    QList<QPair<qint64, qint64>> splitChunks(const char *data, qint64 size, qint64 chunkSize);
+
+    // 解析 [begin, end) 内的全部记录；支持 "" 转义、引号内换行、CRLF，忽略空行
+    QList<QStringList> parseRecords(const char *begin, const char *end);
+
+    // 解析第一条记录 (表头)，返回其后一条记录的起始偏移
+    qint64 parseFirstRecord(const char *data, qint64 size, QStringList *fields);
+
+    // 按 RFC 4180 追加一个字段：含逗号、引号、换行时整体加引号，内部引号加倍
+    void appendField(QByteArray &out, const QString &field);
+    void appendField(QByteArray &out, const QByteArray &utf8);
+
+    // 导出文件的表头 (含 UTF-8 BOM 与 CRLF)，导入可以直接识别
+    QByteArray exportHeader();
+
+    // 时间戳 -> "yyyy-MM-dd HH:mm:ss" (本地时间)
+    // 按时间顺序写出时相邻记录大多在同一天：日期部分每天只格式化一次，
+    // 时分秒直接由当天零点的偏移算出 (夏令时切换的那一天不足/超过 24 小时，退回 QDateTime)
+    class TimeFormatter
+    {
+    public:
+        void append(QByteArray &out, qint64 timestamp);
+
+    private:
+        qint64 m_start = 1;
+        qint64 m_end = 0;
+        QByteArray m_datePrefix;
+    };
+}
+
+#endif // CSVFORMAT_H
@@ -1,5 +1,22 @@
 #include "databasemanager.h"
+#include "ledgerqueries.h"
+#include "startupprofiler.h"
 #include <QDateTime>
+#include <QFileInfo>
+#include <QSqlDriver>
+#include <QTimer>
+#include <iterator>
+
+#include <QtSql/qtsqlglobal.h>
+
+// Qt 自带 (静态编进驱动) 的 SQLite 与这里链接的库是两份全局状态，句柄不能跨库使用；
+// 只有 Qt 用的是系统 SQLite 时才中断查询，否则只靠任务编号丢弃过期结果
+#if defined(FM_HAVE_SQLITE_API) && defined(QT_FEATURE_system_sqlite)
+#if QT_CONFIG(system_sqlite)
+#define FM_USE_SQLITE_INTERRUPT
+#include <sqlite3.h>
+#endif
+#endif
 
 // 单例实现
 DatabaseManager& DatabaseManager::instance()
@@ -8,123 +25,983 @@ DatabaseManager& DatabaseManager::instance()
     return _instance;
 }
 
+namespace {
+const char kWorkerConnection[] = "finance_worker";
+const char kRollupConnection[] = "finance_rollup";
+}
+
 DatabaseManager::DatabaseManager()
 {
     // 在构造时不做连接，留给 openDatabase 显式调用
+    m_workerPool.setMaxThreadCount(1);
+    m_workerPool.setExpiryTimeout(-1);
+
+    StorageProfile::Level level = StorageProfile::Balanced;
+    const QString profile = qEnvironmentVariable("FM_STORAGE_PROFILE");
+    if (!profile.isEmpty() && !StorageProfile::parse(profile, &level)) {
+        qDebug() << "Unknown storage profile:" << profile;
+    }
+    m_profile = StorageProfile::forLevel(level);
+    m_columnsEnabled = qEnvironmentVariableIntValue("FM_COLUMNAR_SNAPSHOT") != 0;
 }
 
 DatabaseManager::~DatabaseManager()
 {
-    if (m_db.isOpen()) {
+    // 静态对象析构时 main() 已经返回，应用对象与线程池可能已经拆掉，这里不再做任何数据库操作；
+    // 写入表格编辑、关闭连接、把 WAL 并回主文件都由 closeDatabase() 完成，各程序在退出前显式调用
+}
+
+void DatabaseManager::closeDatabase()
+{
+#ifdef QT_DEBUG
+    if (m_db.isOpen()) qDebug().noquote() << statementStats();
+#endif
+    // 先写入尚未写入的表格编辑；写不进去的不丢，留在日志里等下次打开时补写
+    if (!m_edits.close()) {
+        qDebug() << "Warning: unsaved table edits kept in" << m_path + "-edits";
+    }
+    delete m_checkpointTimer;
+    m_checkpointTimer = nullptr;
+    closeWorker(); // 排队中的检查点也会先做完
+    m_statements.clear();
+    m_rollup.clear();
+    m_budgets.clear();
+    m_columns.close();
+    m_columnsActive = false;
+
+    if (m_db.isValid()) {
+        if (m_walActive && m_db.isOpen()) {
+            QSqlQuery query(m_db);
+            query.exec("PRAGMA wal_checkpoint(TRUNCATE)");
+        }
+        m_walActive = false;
+        QString connection = m_db.connectionName();
         m_db.close();
+        m_db = QSqlDatabase(); // 释放引用后才能移除连接
+        QSqlDatabase::removeDatabase(connection);
     }
+    m_path.clear();
+}
+
+QSqlDatabase DatabaseManager::workerDatabase()
+{
+    // 只会在数据库线程上调用；连接归属于创建它的线程
+    if (QSqlDatabase::contains(kWorkerConnection)) {
+        return QSqlDatabase::database(kWorkerConnection);
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kWorkerConnection);
+    db.setDatabaseName(m_path);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        qDebug() << "Error: worker connection failed" << db.lastError().text();
+        return db;
+    }
+    QSqlQuery query(db);
+    query.exec("PRAGMA foreign_keys = ON;");
+    for (const QString &pragma : m_profile.connectionPragmas()) {
+        query.exec(pragma);
+    }
+    m_workerStatements.setDatabase(db);
+
+#ifdef FM_USE_SQLITE_INTERRUPT
+    // 只有 Qt 驱动与本程序链接的是同一版本的 SQLite，句柄才能交给 sqlite3_interrupt
+    QVariant handle = db.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0
+        && query.exec("SELECT sqlite_version()") && query.next()
+        && query.value(0).toString() == QLatin1String(sqlite3_libversion())) {
+        QMutexLocker locker(&m_runningMutex);
+        m_workerHandle = *static_cast<sqlite3 *const *>(handle.constData());
+    }
+    query.finish();
+#endif
+    return db;
+}
+
+void DatabaseManager::setRunning(const void *sequence, quint64 ticket)
+{
+    QMutexLocker locker(&m_runningMutex);
+    m_runningSequence = sequence;
+    m_runningTicket = ticket;
+}
+
+void DatabaseManager::interruptSuperseded(const RequestSequence &requests)
+{
+    // 在锁内判断并中断：数据库线程要先拿到锁才能换成下一个任务，不会误伤新任务
+    QMutexLocker locker(&m_runningMutex);
+    if (!m_workerHandle || m_runningSequence != requests.id() || requests.isCurrent(m_runningTicket)) {
+        return;
+    }
+#ifdef FM_USE_SQLITE_INTERRUPT
+    sqlite3_interrupt(static_cast<sqlite3 *>(m_workerHandle));
+#endif
+}
+
+void DatabaseManager::closeWorker()
+{
+    // 连接必须在它所属的线程上关闭
+    m_workerPool.waitForDone();
+    QFuture<void> done = QtConcurrent::run(&m_workerPool, [this]() {
+        {
+            QMutexLocker locker(&m_runningMutex);
+            m_workerHandle = nullptr;
+        }
+        m_workerStatements.clear();
+        if (!QSqlDatabase::contains(kWorkerConnection)) return;
+        QSqlDatabase::database(kWorkerConnection, false).close();
+        QSqlDatabase::removeDatabase(kWorkerConnection);
+    });
+    done.waitForFinished();
+}
+
+QString DatabaseManager::statementStats() const
+{
+    // 数据库线程的计数只在该线程上修改，这里读到的可能略旧，仅供观察
+    return QString("Statement cache: gui %1 hits / %2 misses, worker %3 hits / %4 misses")
+        .arg(m_statements.hits()).arg(m_statements.misses())
+        .arg(m_workerStatements.hits()).arg(m_workerStatements.misses());
 }
 
 int DatabaseManager::getUncategorizedId(int type)
 {
-    QSqlQuery query;
     // 先查找是否存在名为“未分类”且类型匹配的记录
-    query.prepare("SELECT id FROM category WHERE name = '未分类' AND type = :type");
-    query.bindValue(":type", type);
+    QSqlQuery *query = m_statements.prepared("SELECT id FROM category WHERE name = '未分类' AND type = :type");
+    if (!query) return -1;
+    query->bindValue(":type", type);
 
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt();
+    if (query->exec() && query->next()) {
+        const int id = query->value(0).toInt();
+        query->finish();
+        return id;
     }
+    query->finish();
 
     // 如果不存在，则创建一个
-    query.prepare("INSERT INTO category (name, type) VALUES ('未分类', :type)");
-    query.bindValue(":type", type);
-    if (query.exec()) {
-        return query.lastInsertId().toInt(); // 返回新生成的ID
+    query = m_statements.prepared("INSERT INTO category (name, type) VALUES ('未分类', :type)");
+    if (!query) return -1;
+    query->bindValue(":type", type);
+    if (query->exec()) {
+        return query->lastInsertId().toInt(); // 返回新生成的ID
     }
 
     return -1; // 出错
 }
 
-bool DatabaseManager::openDatabase(const QString& path)
+bool DatabaseManager::openDatabase(const QString& path, OpenMode mode)
 {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName(path);
+    m_path = path;
+    {
+        StartupProfiler::Phase phase("db open");
+        m_db = QSqlDatabase::addDatabase("QSQLITE");
+        m_db.setDatabaseName(path);
+        m_statements.setDatabase(m_db);
+
+        if (!m_db.open()) {
+            qDebug() << "Error: connection with database failed";
+            return false;
+        }
+        applyStorageProfile();
+    }
+
+    // 连接成功后，顺便检查一下表结构并升级到最新版本
+    {
+        StartupProfiler::Phase phase("schema check");
+        if (!initTables()) {
+            return false;
+        }
+    }
+
+#ifdef QT_DEBUG
+    // 调试构建下自检：应用发出的每条查询都必须命中索引
+    const QStringList scans = findFullScans(LedgerQueries::planCheckQueries());
+    for (const QString &offender : scans) {
+        qWarning().noquote() << "Query falls back to a full scan:" << offender;
+    }
+#endif
+
+    // 分类元数据整表读入，之后只做增量同步
+    {
+        StartupProfiler::Phase phase("categories");
+        m_categories.reload(m_db);
+    }
+
+    // 表格编辑的日志：上次崩溃前没来得及写入的修改先补写，再建汇总缓存
+    // (命令行报表与界面可能同时运行，不碰界面的日志)
+    if (mode != OpenMode::Headless && m_edits.open(path + "-edits")) {
+        m_edits.flush();
+    }
+
+    // 预算与本月花费 (一个月的分组查询，之后随写入增量调整)
+    if (mode != OpenMode::Headless) {
+        StartupProfiler::Phase phase("budgets");
+        m_budgets.reload(m_db);
+#ifdef QT_DEBUG
+        for (const QString &mismatch : m_budgets.verifyAgainstSql(m_db)) {
+            qWarning().noquote() << "Budget counter mismatch:" << mismatch;
+        }
+#endif
+    }
+
+    // 列式快照：界面延后启动时随汇总缓存一起在后台同步；不启用时删掉旧快照与写日志的触发器，
+    // 之后的写入不再记日志 (命令行报表不动界面的设置)
+    if (!m_columnsEnabled) {
+        if (mode != OpenMode::Headless) {
+            QFile::remove(path + "-columns");
+            ColumnarSnapshot::setChangeLogEnabled(m_db, false);
+        }
+    } else {
+        // 建不了触发器就没有变更日志，无法保证快照与数据库一致，这次不用快照
+        m_columnsActive = ColumnarSnapshot::setChangeLogEnabled(m_db, true);
+        if (m_columnsActive && mode != OpenMode::Deferred) {
+            StartupProfiler::Phase phase("columnar snapshot");
+            syncColumns();
+        }
+    }
+
+    if (mode != OpenMode::Interactive) {
+        return true; // 缓存未就绪时，汇总与趋势自动走 SQL (或列式快照)
+    }
 
-    if (!m_db.open()) {
-        qDebug() << "Error: connection with database failed";
+    // 建立按天汇总缓存，之后的日期范围统计不再逐行扫描
+    {
+        StartupProfiler::Phase phase("rollup");
+        if (!m_columns.isOpen() || !m_rollup.rebuild(m_columns, m_db)) {
+            m_rollup.rebuild();
+        }
+        m_columnsRevision = m_rollup.revision();
+    }
+
+#ifdef QT_DEBUG
+    // 调试构建下自检：缓存与 SQL 的统计结果必须逐分一致
+    const QStringList mismatches = m_rollup.verifyAgainstSql(20, quint32(QDateTime::currentSecsSinceEpoch()));
+    for (const QString &mismatch : mismatches) {
+        qWarning().noquote() << "Rollup cache mismatch:" << mismatch;
+    }
+#endif
+    return true;
+}
+
+bool DatabaseManager::syncColumns()
+{
+    ColumnarSnapshot::Stats stats;
+    if (!m_columns.sync(m_db, m_path + "-columns", &stats)) {
+        qDebug() << "Columnar snapshot unavailable for" << m_path;
         return false;
     }
+    m_columnsRevision = m_rollup.revision();
+    ColumnarSnapshot::pruneLog(m_db, m_columns.changeSeq());
+    if (stats.rebuilt || stats.changed > 0) {
+        qDebug() << "Columnar snapshot:" << (stats.rebuilt ? "rebuilt" : "merged") << stats.changed
+                 << "changed records," << m_columns.rowCount() << "rows in" << stats.elapsedMs << "ms";
+    }
+    return true;
+}
+
+const ColumnarSnapshot *DatabaseManager::columnarSnapshot() const
+{
+    return m_columns.isOpen() && m_columnsRevision == m_rollup.revision() ? &m_columns : nullptr;
+}
+
+void DatabaseManager::applyStorageProfile()
+{
+    delete m_checkpointTimer;
+    m_checkpointTimer = nullptr;
+    QSqlQuery query(m_db);
+
+    // 空文件即新建的数据库，此时还能设置页大小
+    bool newDatabase = query.exec("PRAGMA page_count") && query.next() && query.value(0).toLongLong() == 0;
+    QStringList pragmas = m_profile.databasePragmas(newDatabase) + m_profile.connectionPragmas();
+    if (m_profile.wal) {
+        // 检查点由数据库线程来做，不在界面线程的提交里顺带做
+        pragmas << "PRAGMA wal_autocheckpoint = 0";
+    }
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qDebug() << "Pragma error:" << pragma << query.lastError().text();
+        }
+    }
 
-    // 连接成功后，顺便检查一下表存不存在
-    initTables();
+    // 以实际生效的日志模式为准
+    m_walActive = query.exec("PRAGMA journal_mode") && query.next()
+                  && query.value(0).toString().compare("wal", Qt::CaseInsensitive) == 0;
+    query.finish();
+    if (m_walActive) {
+        m_checkpointTimer = new QTimer();
+        m_checkpointTimer->setSingleShot(true);
+        m_checkpointTimer->setInterval(m_profile.idleCheckpointMs);
+        QObject::connect(m_checkpointTimer, &QTimer::timeout, [this]() { checkpointInBackground(); });
+    } else if (m_profile.wal) {
+        qDebug() << "Warning: WAL is not available for" << m_path << ", using rollback journal";
+        query.exec("PRAGMA wal_autocheckpoint = 1000");
+    }
+}
+
+void DatabaseManager::noteWrite()
+{
+    if (!m_walActive) return;
+
+    // 连续大量写入 (批量编辑) 时 WAL 长得快，不等空闲，到阈值就检查点
+    if (QFileInfo(m_path + "-wal").size() >= m_profile.walCheckpointBytes) {
+        checkpointInBackground();
+    } else if (m_checkpointTimer) {
+        m_checkpointTimer->start(); // 重新计时
+    }
+}
+
+void DatabaseManager::checkpointInBackground()
+{
+    if (!m_walActive || !m_checkpointQueued.testAndSetOrdered(0, 1)) return;
+
+    runOnWorker([this](QSqlDatabase &db) {
+        m_checkpointQueued.storeRelease(0);
+        // PASSIVE：不等读者、不阻塞界面线程的写入，这次做不完的留给下一次
+        QSqlQuery query(db);
+        if (!query.exec("PRAGMA wal_checkpoint(PASSIVE)")) {
+            qDebug() << "Checkpoint error:" << query.lastError().text();
+        }
+    });
+}
+
+void DatabaseManager::rebuildRollupInBackground(QObject *context, std::function<void(bool)> onReady)
+{
+    // 不占用数据库线程：重建要扫全表，期间表格计数、筛选汇总照常在数据库线程上执行
+    // 启用列式快照时，先在同一个后台连接上把快照补到最新，再从快照建缓存
+    // (后台线程要替换快照文件，界面线程这边先解除映射，换入缓存时再重新映射)
+    m_columns.close();
+    const quint64 revision = m_rollup.revision();
+    const QString path = m_path;
+    const QStringList pragmas = m_profile.connectionPragmas();
+    const bool useColumns = m_columnsActive;
+    QFuture<QSharedPointer<RollupCache>> built = QtConcurrent::run([path, pragmas, useColumns]() {
+        QSharedPointer<RollupCache> cache(new RollupCache);
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kRollupConnection);
+            db.setDatabaseName(path);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+            if (db.open()) {
+                QSqlQuery query(db);
+                for (const QString &pragma : pragmas) {
+                    query.exec(pragma);
+                }
+                ColumnarSnapshot columns;
+                if (!useColumns || !columns.sync(db, path + "-columns") || !cache->rebuild(columns, db)) {
+                    cache->rebuild(db);
+                }
+                db.close();
+            } else {
+                qDebug() << "Error: rollup connection failed" << db.lastError().text();
+            }
+        }
+        QSqlDatabase::removeDatabase(kRollupConnection);
+        return cache;
+    });
+
+    built.then(context, [this, context, revision, path, onReady](QSharedPointer<RollupCache> cache) {
+        if (path != m_path || !cache->isReady()) {
+            onReady(false); // 已换库或重建失败，继续走 SQL
+            return;
+        }
+        if (m_rollup.revision() != revision) {
+            rebuildRollupInBackground(context, onReady); // 期间有写入，按最新数据重来
+            return;
+        }
+        m_rollup.takeFrom(*cache);
+        if (m_columnsActive && m_columns.open(path + "-columns")) {
+            m_columnsRevision = m_rollup.revision();
+            ColumnarSnapshot::pruneLog(m_db, m_columns.changeSeq()); // 只读连接不能清理，这里补上
+        }
+#ifdef QT_DEBUG
+        const QStringList mismatches = m_rollup.verifyAgainstSql(20, quint32(QDateTime::currentSecsSinceEpoch()));
+        for (const QString &mismatch : mismatches) {
+            qWarning().noquote() << "Rollup cache mismatch:" << mismatch;
+        }
+#endif
+        onReady(true);
+    });
+}
+
+// 数据库结构迁移
+// 每个步骤把数据库从 version-1 升级到 version，步骤只增不改：
+// 已发布的步骤不能再修改，结构变化一律追加新的步骤
+namespace {
+
+struct Migration {
+    int version;
+    const char *description;
+    bool (*apply)(QSqlQuery &query);
+};
+
+bool execAll(QSqlQuery &query, const QStringList &statements)
+{
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            qDebug() << "Migration statement failed:" << sql << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// v1: 基础表结构 + 默认分类
+// 旧版本创建的 finance.db (user_version = 0) 已经有这两张表，IF NOT EXISTS 保证可以原地升级
+bool migrateV1(QSqlQuery &query)
+{
+    bool ok = execAll(query, {
+        "CREATE TABLE IF NOT EXISTS category ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "name TEXT NOT NULL, "
+        "type INTEGER NOT NULL DEFAULT 0)",
+
+        "CREATE TABLE IF NOT EXISTS record ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "amount REAL NOT NULL, "
+        "timestamp INTEGER NOT NULL, "
+        "note TEXT, "
+        "cid INTEGER NOT NULL, "
+        "FOREIGN KEY (cid) REFERENCES category(id) ON DELETE CASCADE)"
+    });
+    if (!ok) return false;
+
+    // 检查是否需要初始化基础数据(如果分类表为空)
+    if (!query.exec("SELECT count(*) FROM category") || !query.next()) return false;
+    if (query.value(0).toInt() > 0) return true;
+
+    // 插入一些默认数据
+    QStringList expenses = {"餐饮美食", "交通出行", "生活日用", "娱乐休闲", "住房水电"};
+    QStringList incomes = {"工资薪金", "奖金补贴", "投资理财"};
+
+    query.prepare("INSERT INTO category (name, type) VALUES (?, ?)");
+    for(const auto& name : expenses) {
+        query.addBindValue(name);
+        query.addBindValue(0); // 支出
+        if (!query.exec()) return false;
+    }
+    for(const auto& name : incomes) {
+        query.addBindValue(name);
+        query.addBindValue(1); // 收入
+        if (!query.exec()) return false;
+    }
+    return true;
+}
+
+// v2: 覆盖索引
+// (timestamp, cid, amount)：按时间范围筛选 + 汇总金额只读索引，不回表
+// (cid, timestamp, amount)：按分类/类型筛选、JOIN category、删除分类时的级联与转移
+// category(type, id)：按收支类型取分类 ID
+bool migrateV2(QSqlQuery &query)
+{
+    return execAll(query, {
+        "CREATE INDEX IF NOT EXISTS idx_record_ts_cid_amount ON record(timestamp, cid, amount)",
+        "CREATE INDEX IF NOT EXISTS idx_record_cid_ts_amount ON record(cid, timestamp, amount)",
+        "CREATE INDEX IF NOT EXISTS idx_category_type_id ON category(type, id)",
+        "ANALYZE"
+    });
+}
+
+// v3: 明细表格按列排序用的索引 (分页按 "排序列, id" 做键集翻页)
+// 备注统一存空串而不是 NULL，行值比较 (note, id) > (?, ?) 才不会漏掉记录
+bool migrateV3(QSqlQuery &query)
+{
+    return execAll(query, {
+        "UPDATE record SET note = '' WHERE note IS NULL",
+        "CREATE INDEX IF NOT EXISTS idx_record_ts ON record(timestamp)",
+        "CREATE INDEX IF NOT EXISTS idx_record_amount ON record(amount)",
+        "CREATE INDEX IF NOT EXISTS idx_record_note ON record(note)"
+    });
+}
+
+// v4: 原先在这里建备注全文索引。SQLite 没有 FTS5 时这一步跳过，版本号却照样推进，之后换了带 FTS5 的
+// SQLite 也不会再建；现改为每次打开时检查 (见 ensureNoteIndex)，这一步保留为空以维持版本号
+bool migrateV4(QSqlQuery &query)
+{
+    Q_UNUSED(query);
     return true;
 }
 
-void DatabaseManager::initTables()
+// 备注全文索引 (FTS5 外部内容表，trigram 分词：中文无需分词，任意三个字以上的子串可查)
+// 由触发器与 record 保持同步；不属于某个版本，每次打开时检查，缺了就建 (为已有账单补建索引)
+// SQLite 未编译 FTS5 或版本低于 3.34 (无 trigram) 时建不了，备注搜索继续使用 LIKE，下次打开再试
+// 返回 false 表示建到一半失败，调用方回滚
+bool ensureNoteIndex(QSqlQuery &query)
+{
+    if (query.exec("SELECT 1 FROM sqlite_master WHERE name = 'record_fts'") && query.next()) {
+        query.finish();
+        return true;
+    }
+
+    if (!query.exec("CREATE VIRTUAL TABLE record_fts USING fts5("
+                    "note, content='record', content_rowid='id', tokenize='trigram')")) {
+        qDebug() << "Full-text index unavailable, note search falls back to LIKE:" << query.lastError().text();
+        return true;
+    }
+
+    return execAll(query, {
+        "CREATE TRIGGER IF NOT EXISTS record_fts_ai AFTER INSERT ON record BEGIN "
+        "INSERT INTO record_fts(rowid, note) VALUES (new.id, new.note); END",
+
+        "CREATE TRIGGER IF NOT EXISTS record_fts_ad AFTER DELETE ON record BEGIN "
+        "INSERT INTO record_fts(record_fts, rowid, note) VALUES ('delete', old.id, old.note); END",
+
+        "CREATE TRIGGER IF NOT EXISTS record_fts_au AFTER UPDATE OF note ON record BEGIN "
+        "INSERT INTO record_fts(record_fts, rowid, note) VALUES ('delete', old.id, old.note); "
+        "INSERT INTO record_fts(rowid, note) VALUES (new.id, new.note); END",
+
+        // 为已有账单建立索引
+        "INSERT INTO record_fts(record_fts) VALUES ('rebuild')"
+    });
+}
+
+// v5: 金额改为整数分 (amount REAL -> amount_cents INTEGER)
+// SQLite 不能修改列类型，按官方推荐的步骤重建表：建新表、拷数据、删旧表、改名，再补回索引与触发器
+// 记录 ID 不变 (全文索引按 rowid 对应，无需重建)，自增序号也保留，删除过的 ID 不会被重新分配
+// 列名一并改掉：旧版本程序打开新库会直接报错，而不是把“分”当成“元”显示
+bool migrateV5(QSqlQuery &query)
+{
+    bool hasFts = query.exec("SELECT 1 FROM sqlite_master WHERE name = 'record_fts'") && query.next();
+
+    bool ok = execAll(query, {
+        "CREATE TABLE record_v5 ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "amount_cents INTEGER NOT NULL, "
+        "timestamp INTEGER NOT NULL, "
+        "note TEXT NOT NULL DEFAULT '', "
+        "cid INTEGER NOT NULL, "
+        "FOREIGN KEY (cid) REFERENCES category(id) ON DELETE CASCADE)",
+
+        "INSERT INTO record_v5 (id, amount_cents, timestamp, note, cid) "
+        "SELECT id, CAST(ROUND(amount * 100) AS INTEGER), timestamp, COALESCE(note, ''), cid FROM record",
+
+        // 新表的序号此时是最大的 ID，旧表的可能更大 (末尾的记录被删过)
+        "UPDATE sqlite_sequence SET seq = MAX(seq, COALESCE((SELECT seq FROM sqlite_sequence WHERE name = 'record'), 0)) "
+        "WHERE name = 'record_v5'",
+
+        // 旧表的索引与触发器随表一起删除
+        "DROP TABLE record",
+        "ALTER TABLE record_v5 RENAME TO record",
+
+        "CREATE INDEX idx_record_ts_cid_amount ON record(timestamp, cid, amount_cents)",
+        "CREATE INDEX idx_record_cid_ts_amount ON record(cid, timestamp, amount_cents)",
+        "CREATE INDEX idx_record_ts ON record(timestamp)",
+        "CREATE INDEX idx_record_amount ON record(amount_cents)",
+        "CREATE INDEX idx_record_note ON record(note)"
+    });
+    if (!ok) return false;
+
+    if (hasFts) {
+        ok = execAll(query, {
+            "CREATE TRIGGER record_fts_ai AFTER INSERT ON record BEGIN "
+            "INSERT INTO record_fts(rowid, note) VALUES (new.id, new.note); END",
+
+            "CREATE TRIGGER record_fts_ad AFTER DELETE ON record BEGIN "
+            "INSERT INTO record_fts(record_fts, rowid, note) VALUES ('delete', old.id, old.note); END",
+
+            "CREATE TRIGGER record_fts_au AFTER UPDATE OF note ON record BEGIN "
+            "INSERT INTO record_fts(record_fts, rowid, note) VALUES ('delete', old.id, old.note); "
+            "INSERT INTO record_fts(rowid, note) VALUES (new.id, new.note); END"
+        });
+        if (!ok) return false;
+    }
+    return query.exec("ANALYZE");
+}
+
+// v6: 记录变更日志，供列式快照 (见 ColumnarSnapshot) 增量同步
+// 每次增删改由触发器记下记录 ID，序号自增且不复用，快照据此知道自己落后了哪些记录；
+// ledger_id 区分不同的数据库文件，换了文件 (或恢复了备份) 的快照不会被当成最新
+// 未启用快照时，打开数据库会清空日志，日志只在两次打开之间增长
+bool migrateV6(QSqlQuery &query)
+{
+    return execAll(query, {
+        "CREATE TABLE change_log ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "record_id INTEGER NOT NULL)",
+
+        "CREATE TABLE ledger_meta (key TEXT PRIMARY KEY, value)",
+        "INSERT INTO ledger_meta (key, value) VALUES ('ledger_id', abs(random()))"
+    });
+    // 写日志的触发器不在这里建：只有启用列式快照的账本才需要 (见 ColumnarSnapshot::setChangeLogEnabled)
+}
+
+// v7: 支出分类的月预算 (分类删除时随之删除)；alert_percent 为提前提醒的比例
+bool migrateV7(QSqlQuery &query)
+{
+    return execAll(query, {
+        "CREATE TABLE budget ("
+        "cid INTEGER PRIMARY KEY, "
+        "amount_cents INTEGER NOT NULL, "
+        "alert_percent INTEGER NOT NULL DEFAULT 80, "
+        "FOREIGN KEY (cid) REFERENCES category(id) ON DELETE CASCADE)"
+    });
+}
+
+// v8: 重复账单规则；generated 为已生成的次数，与生成的账单在同一事务里推进 (见 RecurringScheduler)
+bool migrateV8(QSqlQuery &query)
+{
+    return execAll(query, {
+        "CREATE TABLE recurring_rule ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "amount_cents INTEGER NOT NULL, "
+        "cid INTEGER NOT NULL, "
+        "note TEXT, "
+        "start_time INTEGER NOT NULL, "
+        "unit INTEGER NOT NULL CHECK (unit IN (0, 1, 2)), "
+        "every INTEGER NOT NULL DEFAULT 1 CHECK (every >= 1), "
+        "end_date TEXT, "
+        "generated INTEGER NOT NULL DEFAULT 0, "
+        "FOREIGN KEY (cid) REFERENCES category(id) ON DELETE CASCADE)"
+    });
+}
+
+const Migration kMigrations[] = {
+    {1, "base tables", migrateV1},
+    {2, "covering indexes", migrateV2},
+    {3, "sort indexes", migrateV3},
+    {4, "note full-text index", migrateV4},
+    {5, "integer cents", migrateV5},
+    {6, "change log", migrateV6},
+    {7, "budgets", migrateV7},
+    {8, "recurring rules", migrateV8},
+};
+
+} // namespace
+
+int DatabaseManager::latestSchemaVersion()
+{
+    return kMigrations[std::size(kMigrations) - 1].version;
+}
+
+int DatabaseManager::schemaVersion()
 {
     QSqlQuery query;
+    if (query.exec("PRAGMA user_version") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return -1;
+}
 
-    // 开启外键
+bool DatabaseManager::initTables()
+{
+    QSqlQuery query;
+
+    // 开启外键 (必须在事务之外设置)
     query.exec("PRAGMA foreign_keys = ON;");
 
-    // 建 Category 表
-    query.exec("CREATE TABLE IF NOT EXISTS category ("
-               "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-               "name TEXT NOT NULL, "
-               "type INTEGER NOT NULL DEFAULT 0)");
-
-    // 建 Record 表
-    query.exec("CREATE TABLE IF NOT EXISTS record ("
-               "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-               "amount REAL NOT NULL, "
-               "timestamp INTEGER NOT NULL, "
-               "note TEXT, "
-               "cid INTEGER NOT NULL, "
-               "FOREIGN KEY (cid) REFERENCES category(id) ON DELETE CASCADE)");
+    int current = schemaVersion();
+    if (current < 0) {
+        qDebug() << "Error: cannot read schema version";
+        return false;
+    }
+    if (current > latestSchemaVersion()) {
+        // 数据库由更新版本的程序创建，不做降级，按现有结构继续使用
+        qDebug() << "Warning: database schema version" << current
+                 << "is newer than supported version" << latestSchemaVersion();
+        RecordFilter::setNoteIndexAvailable(query.exec("SELECT rowid FROM record_fts WHERE 0"));
+        return true;
+    }
 
-    // 检查是否需要初始化基础数据(如果分类表为空)
-    query.exec("SELECT count(*) FROM category");
-    if (query.next() && query.value(0).toInt() == 0) {
-        // 插入一些默认数据
-        QStringList expenses = {"餐饮美食", "交通出行", "生活日用", "娱乐休闲", "住房水电"};
-        QStringList incomes = {"工资薪金", "奖金补贴", "投资理财"};
+    // 依次执行尚未应用的迁移，每一步单独一个事务，版本号随事务一起提交
+    for (const Migration &migration : kMigrations) {
+        if (migration.version <= current) continue;
 
-        QSqlQuery insertQuery;
-        insertQuery.prepare("INSERT INTO category (name, type) VALUES (?, ?)");
+        m_db.transaction();
+        if (!migration.apply(query)
+            || !query.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+            qDebug() << "Migration to version" << migration.version
+                     << "(" << migration.description << ") failed";
+            m_db.rollback();
+            return false;
+        }
+        m_db.commit();
+        current = migration.version;
 
-        for(const auto& name : expenses) {
-            insertQuery.addBindValue(name);
-            insertQuery.addBindValue(0); // 支出
-            insertQuery.exec();
+        // 结构变了，之前编译的语句一律作废
+        m_statements.clear();
+    }
+
+    // 全文索引在版本之外补建 (新库、或 SQLite 换成了带 FTS5 的版本)
+    m_db.transaction();
+    if (ensureNoteIndex(query)) {
+        m_db.commit();
+    } else {
+        qDebug() << "Full-text index creation failed";
+        m_db.rollback();
+    }
+
+    // 全文索引表存在且能查询才使用 (数据库可能来自带 FTS5 的 SQLite，而当前的没有)
+    RecordFilter::setNoteIndexAvailable(query.exec("SELECT rowid FROM record_fts WHERE 0"));
+    return true;
+}
+
+QStringList DatabaseManager::findFullScans(const QStringList &queries)
+{
+    QStringList offenders;
+    QSqlQuery query;
+
+    for (const QString &sql : queries) {
+        if (!query.exec("EXPLAIN QUERY PLAN " + sql)) {
+            offenders << sql + "\n  (explain failed: " + query.lastError().text() + ")";
+            continue;
         }
-        for(const auto& name : incomes) {
-            insertQuery.addBindValue(name);
-            insertQuery.addBindValue(1); // 收入
-            insertQuery.exec();
+
+        // 结果列：id, parent, notused, detail
+        // "SCAN xxx" 表示全表 (或全索引) 扫描，"SEARCH xxx" 才是走索引定位
+        // 只检查账单表：分类表只有十几行，优化器拿它做外层循环再按索引查账单反而最快
+        QStringList plan;
+        bool hasScan = false;
+        while (query.next()) {
+            QString detail = query.value(3).toString();
+            plan << detail;
+
+            QStringList words = detail.split(' ', Qt::SkipEmptyParts);
+            if (words.value(0) != "SCAN") continue;
+            QString table = (words.value(1) == "TABLE") ? words.value(2) : words.value(1); // 旧版 SQLite 输出 "SCAN TABLE xxx"
+            if (table == "record" || table == "r") {
+                hasScan = true;
+            }
+        }
+        if (hasScan) {
+            offenders << sql + "\n  " + plan.join("\n  ");
         }
     }
+    return offenders;
 }
 
 // 封装插入操作
-bool DatabaseManager::insertRecord(double amount, const QDateTime& datetime, const QString& note, int cid)
+bool DatabaseManager::insertRecord(qint64 cents, const QDateTime& datetime, const QString& note, int cid)
 {
-    QSqlQuery query;
-    query.prepare("INSERT INTO record (amount, timestamp, note, cid) "
-                  "VALUES (:amount, :time, :note, :cid)");
+    QSqlQuery *query = m_statements.prepared("INSERT INTO record (amount_cents, timestamp, note, cid) "
+                                             "VALUES (:cents, :time, :note, :cid)");
+    if (!query) return false;
 
-    query.bindValue(":amount", amount);
+    query->bindValue(":cents", cents);
     // 统一处理日期转时间戳，存储为 Unix 时间戳 (秒)
-    query.bindValue(":time", datetime.toSecsSinceEpoch());
-    query.bindValue(":note", note);
-    query.bindValue(":cid", cid);
+    query->bindValue(":time", datetime.toSecsSinceEpoch());
+    query->bindValue(":note", note.isNull() ? QString("") : note);
+    query->bindValue(":cid", cid);
+
+    if (!query->exec()) {
+        qDebug() << "Insert error:" << query->lastError().text();
+        return false;
+    }
+
+    // 同步更新按天汇总缓存
+    RollupCache::Entry entry;
+    entry.timestamp = datetime.toSecsSinceEpoch();
+    entry.cid = cid;
+    entry.cents = cents;
+    m_rollup.addEntry(entry);
+    m_budgets.addEntry(entry);
+    m_budgets.settle();
+    noteWrite();
+    return true;
+}
 
-    if (!query.exec()) {
-        qDebug() << "Insert error:" << query.lastError().text();
+// 字段名直接拼进 SQL，只允许可编辑的列
+static bool isEditableField(const QString &field)
+{
+    static const QStringList editable = {"amount_cents", "timestamp", "note", "cid"};
+    return editable.contains(field);
+}
+
+bool DatabaseManager::updateRecordField(qint64 id, const QString &field, const QVariant &value)
+{
+    if (!isEditableField(field)) {
         return false;
     }
+
+    RollupCache::Entry before;
+    if (!RollupCache::loadEntry(id, &before)) {
+        return false;
+    }
+
+    QSqlQuery *query = m_statements.prepared(QString("UPDATE record SET %1 = :value WHERE id = :id").arg(field));
+    if (!query) return false;
+    query->bindValue(":value", value);
+    query->bindValue(":id", id);
+    if (!query->exec()) {
+        qDebug() << "Update error:" << query->lastError().text();
+        return false;
+    }
+
+    // 旧贡献减掉、新贡献加回
+    RollupCache::Entry after;
+    if (RollupCache::loadEntry(id, &after)) {
+        m_rollup.removeEntry(before);
+        m_rollup.addEntry(after);
+        m_budgets.removeEntry(before);
+        m_budgets.addEntry(after);
+        m_budgets.settle();
+    }
+    noteWrite();
+    return true;
+}
+
+bool DatabaseManager::applyEdits(const QMap<qint64, EditQueue::FieldValues> &edits, qint64 *rejectedId)
+{
+    if (rejectedId) *rejectedId = -1;
+    m_db.transaction();
+
+    QList<QPair<RollupCache::Entry, RollupCache::Entry>> changed;
+    for (auto it = edits.cbegin(); it != edits.cend(); ++it) {
+        RollupCache::Entry before;
+        if (!RollupCache::loadEntry(it.key(), &before)) continue; // 编辑之后记录已被删除
+
+        // 字段按名称排序：改同一组字段的语句文本相同，预编译语句可以复用
+        QStringList fields;
+        for (auto field = it->cbegin(); field != it->cend(); ++field) {
+            if (isEditableField(field.key())) fields << field.key();
+        }
+        if (fields.isEmpty()) continue;
+        fields.sort();
+
+        QStringList assignments;
+        for (const QString &field : fields) {
+            assignments << QString("%1 = :%1").arg(field);
+        }
+        QSqlQuery *query = m_statements.prepared("UPDATE record SET " + assignments.join(", ") + " WHERE id = :id");
+        if (!query) {
+            m_db.rollback();
+            return false;
+        }
+        RollupCache::Entry after = before;
+        for (const QString &field : fields) {
+            const QVariant value = it->value(field);
+            query->bindValue(":" + field, value);
+            if (field == "amount_cents")   after.cents = value.toLongLong();
+            else if (field == "timestamp") after.timestamp = value.toLongLong();
+            else if (field == "cid")       after.cid = value.toInt();
+        }
+        query->bindValue(":id", it.key());
+        if (!query->exec()) {
+            qDebug() << "Update error:" << query->lastError().text();
+            if (rejectedId) *rejectedId = it.key();
+            m_db.rollback();
+            return false;
+        }
+        changed.append(qMakePair(before, after));
+    }
+
+    if (!m_db.commit()) {
+        m_db.rollback();
+        return false;
+    }
+
+    // 提交之后再同步缓存：旧贡献减掉、新贡献加回
+    for (const auto &change : changed) {
+        m_rollup.removeEntry(change.first);
+        m_rollup.addEntry(change.second);
+        m_budgets.removeEntry(change.first);
+        m_budgets.addEntry(change.second);
+    }
+    m_budgets.settle();
+    if (!changed.isEmpty()) noteWrite();
+    return true;
+}
+
+bool DatabaseManager::deleteRecords(const QList<qint64> &ids)
+{
+    return deleteRecords(RecordSelection::byIds(ids));
+}
+
+bool DatabaseManager::deleteRecords(const RecordSelection &selection, int *affected)
+{
+    return runBatch(selection, "DELETE FROM record WHERE ",
+                    [](RollupCache::Entry &) { return false; }, affected);
+}
+
+bool DatabaseManager::recategorizeRecords(const RecordSelection &selection, int cid, int *affected)
+{
+    if (!m_categories.find(cid)) {
+        return false;
+    }
+    return runBatch(selection, QString("UPDATE record SET cid = %1 WHERE ").arg(cid),
+                    [cid](RollupCache::Entry &entry) { entry.cid = cid; return true; }, affected);
+}
+
+bool DatabaseManager::shiftRecords(const RecordSelection &selection, qint64 seconds, int *affected)
+{
+    return runBatch(selection, QString("UPDATE record SET timestamp = timestamp + %1 WHERE ").arg(seconds),
+                    [seconds](RollupCache::Entry &entry) { entry.timestamp += seconds; return true; }, affected);
+}
+
+bool DatabaseManager::runBatch(const RecordSelection &selection, const QString &statement,
+                               const std::function<bool(RollupCache::Entry &)> &change, int *affected)
+{
+    if (affected) *affected = 0;
+    if (selection.isEmpty()) return true;
+    // 表格里尚未写入的编辑排在这次操作之前；写不进去时不执行，否则它们之后会覆盖这次的结果
+    if (!m_edits.flush()) {
+        qDebug() << "Batch aborted: pending table edits could not be written";
+        return false;
+    }
+
+    const QString where = selection.toRecordSql();
+    m_db.transaction();
+
+    // 受影响记录的缓存变化按 (天, 分类) 合并：几万条记录通常只落在几百个格子里
+    // 旧贡献减掉、新贡献加回；相邻记录大多在同一天，日期用游标换算
+    struct Delta {
+        qint64 cents = 0;
+        qint64 count = 0;
+    };
+    QHash<QPair<int, int>, Delta> deltas;
+    QSqlQuery scan(m_db);
+    scan.setForwardOnly(true);
+    if (!scan.exec(QString("SELECT timestamp, cid, amount_cents FROM record WHERE %1").arg(where))) {
+        qDebug() << "Batch scan error:" << scan.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    RollupCache::DayCursor before;
+    RollupCache::DayCursor after;
+    while (scan.next()) {
+        RollupCache::Entry entry;
+        entry.timestamp = scan.value(0).toLongLong();
+        entry.cid = scan.value(1).toInt();
+        entry.cents = scan.value(2).toLongLong();
+
+        Delta &removed = deltas[qMakePair(before.dayOf(entry.timestamp), entry.cid)];
+        removed.cents -= entry.cents;
+        removed.count -= 1;
+        if (change(entry)) {
+            Delta &added = deltas[qMakePair(after.dayOf(entry.timestamp), entry.cid)];
+            added.cents += entry.cents;
+            added.count += 1;
+        }
+    }
+    scan.finish();
+
+    // 整个选择只有这一条写语句 (不走预编译缓存：ID 列表每次都不同)
+    QSqlQuery query(m_db);
+    if (!query.exec(statement + where)) {
+        qDebug() << "Batch error:" << query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    int rows = query.numRowsAffected();
+
+    if (!m_db.commit()) {
+        m_db.rollback();
+        return false;
+    }
+
+    for (auto it = deltas.cbegin(); it != deltas.cend(); ++it) {
+        if (it->cents != 0 || it->count != 0) {
+            m_rollup.addDailyTotal(it.key().first, it.key().second, it->cents, it->count);
+            m_budgets.addDailyTotal(it.key().first, it.key().second, it->cents);
+        }
+    }
+    m_budgets.settle();
+    if (affected) *affected = rows;
+    if (rows > 0) noteWrite();
     return true;
 }
 
 // 封装查询分类
 QSqlQuery DatabaseManager::getCategories(int type)
 {
-    QSqlQuery query;
+    // 结果集交给调用方自己读完，不能与预编译语句缓存共享，每次单独建查询
+    // (界面上的分类列表都从 CategoryCache 取，这里很少用到)
+    QSqlQuery query(m_db);
     // 如果 type == -1，则查询所有分类（用于主界面筛选）
     if (type == -1) {
         query.prepare("SELECT name, id FROM category");
@@ -140,20 +1017,34 @@ bool DatabaseManager::addCategory(const QString &name, int type)
 {
     if (isCategoryNameExist(name, type)) return false; // 防止重复
 
-    QSqlQuery query;
-    query.prepare("INSERT INTO category (name, type) VALUES (:name, :type)");
-    query.bindValue(":name", name);
-    query.bindValue(":type", type);
-    return query.exec();
+    QSqlQuery *query = m_statements.prepared("INSERT INTO category (name, type) VALUES (:name, :type)");
+    if (!query) return false;
+    query->bindValue(":name", name);
+    query->bindValue(":type", type);
+    if (!query->exec()) {
+        return false;
+    }
+
+    int id = query->lastInsertId().toInt();
+    m_rollup.addCategory(id, name, type);
+    m_categories.add(id, name, type);
+    noteWrite();
+    return true;
 }
 
 bool DatabaseManager::removeCategory(int id, int type, bool keepRecords)
 {
+    // 尚未写入的编辑可能正把记录改到这个分类：先写入，写不进去就不删 (否则之后会把记录改回已删除的分类)
+    if (!m_edits.flush()) {
+        qDebug() << "Remove category aborted: pending table edits could not be written";
+        return false;
+    }
     m_db.transaction(); // 开启事务，保证原子性
 
     // 如果选择保留记录
+    int targetId = -1;
     if (keepRecords) {
-        int targetId = getUncategorizedId(type);
+        targetId = getUncategorizedId(type);
         if (targetId == -1) {
             m_db.rollback();
             return false;
@@ -168,26 +1059,58 @@ bool DatabaseManager::removeCategory(int id, int type, bool keepRecords)
         }
 
         // 执行转移：把原分类下的账单移动到“未分类”
-        QSqlQuery updateQuery;
-        updateQuery.prepare("UPDATE record SET cid = :newId WHERE cid = :oldId");
-        updateQuery.bindValue(":newId", targetId);
-        updateQuery.bindValue(":oldId", id);
+        QSqlQuery *updateQuery = m_statements.prepared("UPDATE record SET cid = :newId WHERE cid = :oldId");
+        if (!updateQuery) {
+            m_db.rollback();
+            return false;
+        }
+        updateQuery->bindValue(":newId", targetId);
+        updateQuery->bindValue(":oldId", id);
 
-        if (!updateQuery.exec()) {
+        if (!updateQuery->exec()) {
+            m_db.rollback();
+            return false;
+        }
+
+        // 重复账单规则也跟着转移，否则删除分类时会被级联删掉，之后不再生成
+        QSqlQuery *ruleQuery = m_statements.prepared("UPDATE recurring_rule SET cid = :newId WHERE cid = :oldId");
+        if (!ruleQuery) {
+            m_db.rollback();
+            return false;
+        }
+        ruleQuery->bindValue(":newId", targetId);
+        ruleQuery->bindValue(":oldId", id);
+
+        if (!ruleQuery->exec()) {
             m_db.rollback();
             return false;
         }
     }
 
     // 删除分类
-    // (如果keepRecords为真，此时该分类下已经没有账单了，删除安全)
+    // (如果keepRecords为真，此时该分类下已经没有账单和重复规则了，删除安全)
     // (如果keepRecords为假，Cascade机制会自动删除关联账单)
-    QSqlQuery deleteQuery;
-    deleteQuery.prepare("DELETE FROM category WHERE id = :id");
-    deleteQuery.bindValue(":id", id);
+    QSqlQuery *deleteQuery = m_statements.prepared("DELETE FROM category WHERE id = :id");
+    if (deleteQuery) {
+        deleteQuery->bindValue(":id", id);
+    }
 
-    if (deleteQuery.exec()) {
+    if (deleteQuery && deleteQuery->exec()) {
         m_db.commit(); // 提交事务
+
+        // 提交成功后再同步缓存 (“未分类”可能是刚刚创建的)
+        if (keepRecords) {
+            m_rollup.addCategory(targetId, "未分类", type);
+            m_rollup.moveCategory(id, targetId);
+            m_budgets.moveCategory(id, targetId);
+            m_categories.add(targetId, "未分类", type);
+        } else {
+            m_rollup.removeCategory(id);
+            m_budgets.removeCategory(id);
+        }
+        m_budgets.settle();
+        m_categories.remove(id);
+        noteWrite();
         return true;
     } else {
         m_db.rollback(); // 回滚
@@ -195,14 +1118,90 @@ bool DatabaseManager::removeCategory(int id, int type, bool keepRecords)
     }
 }
 
+bool DatabaseManager::setBudget(int cid, qint64 monthlyCents, int alertPercent)
+{
+    // 预算只针对支出分类
+    const CategoryInfo *category = m_categories.find(cid);
+    if (!category || category->type != 0 || alertPercent <= 0 || alertPercent > 100) {
+        return false;
+    }
+
+    QSqlQuery *query = monthlyCents > 0
+        ? m_statements.prepared("INSERT OR REPLACE INTO budget (cid, amount_cents, alert_percent) "
+                                "VALUES (:cid, :cents, :alert)")
+        : m_statements.prepared("DELETE FROM budget WHERE cid = :cid");
+    if (!query) return false;
+    query->bindValue(":cid", cid);
+    if (monthlyCents > 0) {
+        query->bindValue(":cents", monthlyCents);
+        query->bindValue(":alert", alertPercent);
+    }
+    if (!query->exec()) {
+        qDebug() << "Budget error:" << query->lastError().text();
+        return false;
+    }
+
+    m_budgets.setBudget(cid, monthlyCents, alertPercent);
+    noteWrite();
+    return true;
+}
+
+bool DatabaseManager::addRecurringRule(const RecurringRule &rule)
+{
+    if (!m_categories.find(rule.cid) || rule.cents < 0 || rule.every < 1 || !rule.start.isValid()
+        || (rule.endDate.isValid() && rule.endDate < rule.start.date())) {
+        return false;
+    }
+
+    QSqlQuery *query = m_statements.prepared(
+        "INSERT INTO recurring_rule (amount_cents, cid, note, start_time, unit, every, end_date) "
+        "VALUES (:cents, :cid, :note, :start, :unit, :every, :end)");
+    if (!query) return false;
+    query->bindValue(":cents", rule.cents);
+    query->bindValue(":cid", rule.cid);
+    query->bindValue(":note", rule.note);
+    query->bindValue(":start", rule.start.toSecsSinceEpoch());
+    query->bindValue(":unit", int(rule.unit));
+    query->bindValue(":every", rule.every);
+    query->bindValue(":end", rule.endDate.isValid() ? QVariant(rule.endDate.toString(Qt::ISODate)) : QVariant());
+    if (!query->exec()) {
+        qDebug() << "Recurring rule error:" << query->lastError().text();
+        return false;
+    }
+    noteWrite();
+    return true;
+}
+
+bool DatabaseManager::removeRecurringRule(qint64 id)
+{
+    QSqlQuery *query = m_statements.prepared("DELETE FROM recurring_rule WHERE id = :id");
+    if (!query) return false;
+    query->bindValue(":id", id);
+    if (!query->exec()) {
+        qDebug() << "Recurring rule error:" << query->lastError().text();
+        return false;
+    }
+    noteWrite();
+    return true;
+}
+
+QVector<RecurringRule> DatabaseManager::recurringRules()
+{
+    QVector<RecurringRule> rules;
+    RecurringScheduler::loadRules(m_db, &rules);
+    return rules;
+}
+
 bool DatabaseManager::isCategoryNameExist(const QString &name, int type)
 {
-    QSqlQuery query;
-    query.prepare("SELECT count(*) FROM category WHERE name = :name AND type = :type");
-    query.bindValue(":name", name);
-    query.bindValue(":type", type);
-    if (query.exec() && query.next()) {
-        return query.value(0).toInt() > 0;
+    QSqlQuery *query = m_statements.prepared("SELECT count(*) FROM category WHERE name = :name AND type = :type");
+    if (!query) return false;
+    query->bindValue(":name", name);
+    query->bindValue(":type", type);
+    bool exists = false;
+    if (query->exec() && query->next()) {
+        exists = query->value(0).toInt() > 0;
     }
-    return false;
+    query->finish();
+    return exists;
 }
@@ -7,6 +7,41 @@
 #include <QSqlError>
 #include <QDebug>
 #include <QDate>
+#include <QFuture>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+#include <functional>
+#include <type_traits>
+#include "rollupcache.h"
+#include "statementcache.h"
+#include "budgettracker.h"
+#include "categorycache.h"
+#include "columnarsnapshot.h"
+#include "editqueue.h"
+#include "recurringscheduler.h"
+#include "storageprofile.h"
+
+class QTimer;
+
+// 异步请求的序号：发起新请求即作废之前的请求
+// 副本共享同一个计数器，可以按值捕获进后台任务；
+// 尚未开始的过期任务直接跳过，已算完的过期结果由调用方丢弃
+class RequestSequence
+{
+public:
+    RequestSequence() : m_latest(new QAtomicInteger<quint64>(0)) {}
+
+    quint64 next() { return m_latest->fetchAndAddOrdered(1) + 1; }
+    bool isCurrent(quint64 ticket) const { return m_latest->loadAcquire() == ticket; }
+
+    // 区分不同的序列 (同一序列的副本相同)
+    const void *id() const { return m_latest.data(); }
+
+private:
+    QSharedPointer<QAtomicInteger<quint64>> m_latest;
+};
 
 class DatabaseManager
 {
@@ -14,26 +49,174 @@ public:
     // 获取单例实例 (静态方法)
     static DatabaseManager& instance();
 
+    // 打开方式：界面会反复统计，值得先建好按天汇总缓存；
+    // 界面冷启动时先让窗口出来，缓存之后在后台建 (见 rebuildRollupInBackground)；
+    // 命令行报表只统计一次，直接走 SQL，省掉全表扫描的建缓存时间
+    enum class OpenMode { Interactive, Deferred, Headless };
+
     // 连接并打开数据库
-    bool openDatabase(const QString& path);
+    bool openDatabase(const QString& path, OpenMode mode = OpenMode::Interactive);
+    // 关闭当前数据库并清空各缓存，之后可以再 openDatabase 另一个文件 (基准测试切换数据集)
+    // 程序退出前必须调用：析构函数不做清理 (主程序在 aboutToQuit 时调用)
+    void closeDatabase();
+    // 存储参数 (日志模式、落盘策略、缓存、内存映射)，下一次 openDatabase 时生效
+    // 默认取环境变量 FM_STORAGE_PROFILE (safe / balanced / fast)，未设置时为 balanced
+    void setStorageProfile(const StorageProfile &profile) { m_profile = profile; }
+    const StorageProfile &storageProfile() const { return m_profile; }
+    // 列式快照 (finance.db-columns，默认关闭)：打开数据库时按变更日志补到最新，汇总缓存改为顺序扫描快照建立，
+    // 命令行报表的统计直接扫快照；下一次 openDatabase 时生效，关闭时删掉快照文件并清空日志
+    // 默认取环境变量 FM_COLUMNAR_SNAPSHOT (1 开启)
+    void setColumnarSnapshotEnabled(bool enabled) { m_columnsEnabled = enabled; }
+    bool columnarSnapshotEnabled() const { return m_columnsEnabled; }
+    // 与数据库一致的快照；同步之后有过写入 (快照不随写入更新) 或未启用时返回空
+    const ColumnarSnapshot *columnarSnapshot() const;
+
+    // 当前数据库文件路径 (后台线程据此打开自己的连接)
+    QString databasePath() const { return m_db.databaseName(); }
+
+    // 自动初始化表结构 (按 PRAGMA user_version 依次执行迁移)
+    bool initTables();
 
-    // 自动初始化表结构
-    void initTables();
+    // 当前数据库结构版本 / 程序支持的最新版本
+    int schemaVersion();
+    static int latestSchemaVersion();
+
+    // 执行计划检查：返回会退化为全表扫描的查询 (附带其执行计划)，全部命中索引时返回空列表
+    QStringList findFullScans(const QStringList& queries);
 
     // 封装一些常用的业务操作
-    bool insertRecord(double amount, const QDateTime& datetime, const QString& note, int cid);
+    bool insertRecord(qint64 cents, const QDateTime& datetime, const QString& note, int cid); // 金额单位为分
     QSqlQuery getCategories(int type); // 获取分类列表
 
+    // 修改一条记录的某个字段 (amount_cents / timestamp / note / cid)，立即写入
+    bool updateRecordField(qint64 id, const QString& field, const QVariant& value);
+    // 一个事务写入多条记录的修改 (由 EditQueue 调用)；已不存在的记录跳过
+    // 某条记录的 UPDATE 本身失败 (例如违反约束) 时整批回滚，rejectedId 返回这条记录；
+    // 提交失败等与具体记录无关的失败 rejectedId 为 -1
+    bool applyEdits(const QMap<qint64, EditQueue::FieldValues>& edits, qint64 *rejectedId = nullptr);
+    // 批量操作：无论涉及多少条记录，都是一个事务里的一条按集合执行的语句，汇总缓存按 (天, 分类) 合并后增量更新
+    // affected 返回实际改动的记录数
+    bool deleteRecords(const QList<qint64>& ids);
+    bool deleteRecords(const RecordSelection& selection, int *affected = nullptr);
+    bool recategorizeRecords(const RecordSelection& selection, int cid, int *affected = nullptr); // 改为分类 cid
+    bool shiftRecords(const RecordSelection& selection, qint64 seconds, int *affected = nullptr); // 时间整体平移
+
     bool addCategory(const QString& name, int type);
     bool removeCategory(int id, int type, bool keepRecords);
     bool isCategoryNameExist(const QString& name, int type); // 防止同名
 
+    // 支出分类的月预算：monthlyCents 不大于 0 时取消；花费达到 alertPercent% 与 100% 时提醒
+    bool setBudget(int cid, qint64 monthlyCents, int alertPercent = BudgetTracker::DefaultAlertPercent);
+
+    // 重复账单规则：到期的账单由 RecurringScheduler 生成；删除规则只是停止重复，已生成的账单保留
+    bool addRecurringRule(const RecurringRule& rule);
+    bool removeRecurringRule(qint64 id);
+    QVector<RecurringRule> recurringRules(); // ID 升序
+
+    // 按天汇总缓存 (所有写操作都经过本类，由本类负责同步)
+    RollupCache& rollup() { return m_rollup; }
+
+    // 用单独的连接在后台线程上重建缓存，建好后回到 context 所在的线程换入，再调用 onReady(true)
+    // 重建期间缓存未就绪，统计自动走 SQL；期间有写入则结果作废、重新建；重建失败时 onReady(false)
+    // 导入在自己的线程上提交、稍后才补缓存，onReady 之前不要开始导入
+    void rebuildRollupInBackground(QObject *context, std::function<void(bool)> onReady);
+
+    // 分类元数据缓存 (增删分类时由本类同步，并发出 changed())
+    CategoryCache& categories() { return m_categories; }
+
+    // 预算与本月花费的计数 (界面打开数据库时读入，之后随每次写入增量调整，并在越过阈值时发出提醒)
+    BudgetTracker& budgets() { return m_budgets; }
+
+    // 表格编辑的延迟写入队列 (界面打开数据库时启用日志，并补写上次崩溃前未写入的修改)
+    // 按集合执行的写操作、删除分类、关闭数据库之前都会先写入队列里的修改
+    EditQueue& edits() { return m_edits; }
+
+    // 预编译语句缓存：界面线程的连接 / 数据库线程的连接 (后者只能在 runOnWorker 的任务里使用)
+    StatementCache& statements() { return m_statements; }
+    StatementCache& workerStatements() { return m_workerStatements; }
+    QString statementStats() const; // 命中/未命中计数
+
+    // 在后台数据库线程上执行 fn(db)，db 是该线程专用的连接
+    // 所有任务在同一个线程上按提交顺序执行，耗时的统计不再阻塞界面
+    template <typename Fn>
+    auto runOnWorker(Fn fn) -> QFuture<std::invoke_result_t<Fn, QSqlDatabase&>>
+    {
+        return QtConcurrent::run(&m_workerPool, [this, fn]() mutable {
+            QSqlDatabase db = workerDatabase();
+            return fn(db);
+        });
+    }
+
+    // 同上，但属于一个请求序列：ticket 为 requests.next() 的返回值
+    // 排队中的过期任务不执行，直接返回默认值；数据库线程上正在执行的同一序列的旧任务被中断
+    // (需要 SQLite 接口，见 interruptSuperseded)，被中断的查询以失败返回
+    template <typename Fn>
+    auto runLatestOnWorker(const RequestSequence &requests, quint64 ticket, Fn fn)
+        -> QFuture<std::invoke_result_t<Fn, QSqlDatabase&>>
+    {
+        using Result = std::invoke_result_t<Fn, QSqlDatabase&>;
+        interruptSuperseded(requests);
+        return QtConcurrent::run(&m_workerPool, [this, requests, ticket, fn]() mutable {
+            if (!requests.isCurrent(ticket)) return Result();
+            QSqlDatabase db = workerDatabase();
+            setRunning(requests.id(), ticket);
+            Result result = fn(db);
+            setRunning(nullptr, 0);
+            return result;
+        });
+    }
+
 private:
     // 构造函数私有化，禁止外部 new
     DatabaseManager();
     ~DatabaseManager();
 
+    // 后台线程的连接：第一次在该线程上使用时打开
+    QSqlDatabase workerDatabase();
+    void closeWorker();
+
+    // 打开后应用存储参数；WAL 模式下写入后安排检查点
+    void applyStorageProfile();
+    void noteWrite();
+    void checkpointInBackground();
+
+    // 把快照同步到 db 的最新状态 (界面线程的连接)，成功后清理已吸收的变更日志
+    bool syncColumns();
+
+    // 批量写入的公共部分：statement 以 "WHERE " 结尾，后接选择条件；
+    // 执行前先读出受影响记录的贡献，change 把它改成执行后的样子 (返回 false 表示记录被删除)
+    bool runBatch(const RecordSelection &selection, const QString &statement,
+                  const std::function<bool(RollupCache::Entry &)> &change, int *affected);
+
+    // 记录数据库线程上正在执行的请求；新请求发出时中断同一序列里过期的那个
+    void setRunning(const void *sequence, quint64 ticket);
+    void interruptSuperseded(const RequestSequence &requests);
+
     QSqlDatabase m_db;
+    RollupCache m_rollup;
+    CategoryCache m_categories;
+    BudgetTracker m_budgets;
+    EditQueue m_edits;
+    StatementCache m_statements;
+    StatementCache m_workerStatements;
+
+    // 只有一个线程、且永不回收的线程池，即专用的数据库线程
+    QThreadPool m_workerPool;
+    QString m_path;
+
+    StorageProfile m_profile;
+    bool m_columnsEnabled = false;
+    bool m_columnsActive = false;          // 本次打开实际使用快照 (启用且变更日志的触发器已就绪)
+    ColumnarSnapshot m_columns;
+    quint64 m_columnsRevision = 0;         // 快照同步时汇总缓存的修订号，之后有写入则不一致
+    bool m_walActive = false;              // 实际生效的日志模式是 WAL (网络盘等可能不支持)
+    QTimer *m_checkpointTimer = nullptr;   // 写入停下来之后触发检查点
+    QAtomicInt m_checkpointQueued;         // 已有检查点在数据库线程上排队
+
+    QMutex m_runningMutex;                   // 保护以下三项
+    const void *m_runningSequence = nullptr;
+    quint64 m_runningTicket = 0;
+    void *m_workerHandle = nullptr;          // 数据库线程连接的 sqlite3*，不可中断时为空
 
     // 辅助：获取（或创建）“未分类”的ID
     int getUncategorizedId(int type);
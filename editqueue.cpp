@@ -0,0 +1,150 @@
+#include "editqueue.h"
+#include "databasemanager.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QTimer>
+
+EditQueue::EditQueue(QObject *parent)
+    : QObject(parent)
+{
+}
+
+bool EditQueue::open(const QString &journalPath)
+{
+    // 还开着另一个数据库的日志时不写入 (连接已经换了)，未写入的修改留在它的日志里，下次打开那个数据库时补写
+    if (m_timer) m_timer->stop();
+    m_journal.close();
+    m_pending.clear();
+    m_journal.setFileName(journalPath);
+    if (!m_journal.open(QIODevice::ReadWrite)) {
+        qDebug() << "Edit journal open error:" << m_journal.errorString();
+        return false;
+    }
+
+    // 日志是一串 (记录ID, 字段, 值)，按写入顺序重放，同一字段后写的覆盖先写的
+    QDataStream in(&m_journal);
+    in.setVersion(QDataStream::Qt_6_0);
+    qint64 valid = 0;
+    while (!in.atEnd()) {
+        qint64 id = 0;
+        QString field;
+        QVariant value;
+        in >> id >> field >> value;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+        m_pending[id][field] = value;
+        valid = m_journal.pos();
+    }
+
+    // 崩溃时写了一半的最后一条丢掉，之后从完整记录的末尾接着追加
+    if (valid < m_journal.size()) {
+        qDebug() << "Edit journal: dropped incomplete tail of" << m_journal.size() - valid << "bytes";
+        m_journal.resize(valid);
+    }
+    m_journal.seek(valid);
+
+    if (!m_pending.isEmpty()) {
+        qDebug() << "Edit journal: recovered edits for" << m_pending.size() << "records";
+    }
+    return true;
+}
+
+bool EditQueue::close()
+{
+    const bool written = flush();
+    if (m_timer) m_timer->stop(); // 写入失败时的重试不再需要：未写入的修改留在日志里，下次打开时补写
+    if (m_journal.isOpen()) {
+        // 全部写入后日志为空，不留空文件
+        if (m_pending.isEmpty() && m_journal.size() == 0) {
+            m_journal.remove();
+        } else {
+            m_journal.close();
+        }
+    }
+    m_pending.clear();
+    return written;
+}
+
+bool EditQueue::enqueue(qint64 id, const QString &field, const QVariant &value)
+{
+    if (!m_journal.isOpen() || !appendToJournal(id, field, value)) {
+        // 没有日志就不能保证崩溃后不丢，直接写库
+        return DatabaseManager::instance().updateRecordField(id, field, value);
+    }
+
+    m_pending[id][field] = value;
+    scheduleFlush();
+    return true;
+}
+
+bool EditQueue::appendToJournal(qint64 id, const QString &field, const QVariant &value)
+{
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << id << field << value;
+
+    // 交给操作系统即可：程序崩溃不丢；断电时最多丢掉最近一次写入前的这一小段 (与 synchronous=NORMAL 相当)
+    if (m_journal.write(record) != record.size() || !m_journal.flush()) {
+        qDebug() << "Edit journal write error:" << m_journal.errorString();
+        return false;
+    }
+    return true;
+}
+
+void EditQueue::scheduleFlush()
+{
+    if (!m_timer) {
+        m_timer = new QTimer(this);
+        m_timer->setSingleShot(true);
+        m_timer->setInterval(FlushDelayMs);
+        connect(m_timer, &QTimer::timeout, this, &EditQueue::flush);
+    }
+    // 不随后续编辑顺延：连续编辑时也每隔 FlushDelayMs 写一次 (重试等待中也不提前)
+    if (!m_timer->isActive()) {
+        m_timer->start(FlushDelayMs);
+    }
+}
+
+void EditQueue::retryLater()
+{
+    // 没有新的编辑也要再试 (例如另一个进程暂时占着写锁)，间隔逐次加倍；次数用完后不再自动重试
+    ++m_failures;
+    if (m_failures > MaxRetries) {
+        qDebug() << "Edit queue: stopped retrying," << m_pending.size() << "records kept in the journal";
+        return;
+    }
+    scheduleFlush();
+    m_timer->start(FlushDelayMs << m_failures);
+}
+
+bool EditQueue::flush()
+{
+    if (m_timer) m_timer->stop();
+    if (m_pending.isEmpty()) return true;
+
+    // 写不进去的记录逐条剔除 (每轮至少少一条)，不让一条坏数据挡住其余的编辑
+    qint64 rejectedId = -1;
+    while (!DatabaseManager::instance().applyEdits(m_pending, &rejectedId)) {
+        if (rejectedId < 0 || !m_pending.contains(rejectedId)) {
+            qDebug() << "Edit queue flush failed," << m_pending.size() << "records kept for retry";
+            retryLater();
+            return false;
+        }
+        qDebug() << "Edit queue: dropped edits of record" << rejectedId << m_pending.value(rejectedId);
+        m_pending.remove(rejectedId);
+        emit rejected(rejectedId);
+        if (m_pending.isEmpty()) break;
+    }
+
+    m_failures = 0;
+    int records = m_pending.size();
+    m_pending.clear();
+    if (m_journal.isOpen()) {
+        m_journal.resize(0);
+        m_journal.seek(0);
+    }
+    emit flushed(records);
+    return true;
+}
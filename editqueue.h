@@ -0,0 +1,66 @@
+#ifndef EDITQUEUE_H
+#define EDITQUEUE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVariant>
+
+class QTimer;
+
+// 表格单元格编辑的延迟写入队列
+// 编辑先记进队列 (同一条记录同一字段只留最后一次的值) 并追加到日志文件，界面立即显示；
+// 稍后 (FlushDelayMs 之后、失去焦点、退出、或有按集合执行的写操作之前) 在一个事务里统一写入数据库，
+// 写入成功后清空日志并发出 flushed()，图表与概览每次写入只刷新一次
+// 日志与数据库放在一起 (finance.db-edits)：程序中途崩溃时，下次打开数据库会先把日志里的修改补写进去
+class EditQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    using FieldValues = QHash<QString, QVariant>; // 字段名 (amount_cents / timestamp / note / cid) -> 新值
+
+    static const int FlushDelayMs = 500; // 第一条未写入的编辑最多等待这么久
+    static const int MaxRetries = 6;     // 写入失败后自动重试的次数 (间隔从 FlushDelayMs 起逐次加倍)
+
+    explicit EditQueue(QObject *parent = nullptr);
+
+    // 打开日志文件，读出上次未写入数据库的修改 (读到不完整的末尾为止)；之后由调用方 flush()
+    bool open(const QString &journalPath);
+    // 写入剩余的修改并关闭日志；写不进去时返回 false，修改留在日志文件里，下次打开这个数据库时补写
+    bool close();
+
+    // 记下一次编辑：先追加到日志，再放进队列
+    // 日志写不进去时退回到直接写库 (DatabaseManager::updateRecordField)
+    bool enqueue(qint64 id, const QString &field, const QVariant &value);
+
+    bool isEmpty() const { return m_pending.isEmpty(); }
+    int pendingCount() const { return m_pending.size(); } // 涉及的记录数
+
+    // 某条记录尚未写入的修改 (从数据库读出的行要叠加上这些值才是界面上应显示的)
+    FieldValues pending(qint64 id) const { return m_pending.value(id); }
+
+    // 立即写入：一个事务，每条记录一条 UPDATE
+    // 某条记录写不进去 (例如违反约束) 时丢掉这条记录的修改并发出 rejected()，其余的照常写入；
+    // 其他失败 (例如另一个进程占着写锁) 时修改留在队列和日志里，按退避间隔重试至多 MaxRetries 次，
+    // 之后等下一次编辑或调用方再 flush()
+    bool flush();
+
+signals:
+    void flushed(int records);
+    void rejected(qint64 id);
+
+private:
+    void scheduleFlush();
+    void retryLater();
+    bool appendToJournal(qint64 id, const QString &field, const QVariant &value);
+
+    QMap<qint64, FieldValues> m_pending; // 按记录 ID 排序，写入时依次定位
+    QFile m_journal;
+    QTimer *m_timer = nullptr;
+    int m_failures = 0; // 连续失败次数，写入成功后清零
+};
+
+#endif // EDITQUEUE_H
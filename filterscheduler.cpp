@@ -0,0 +1,28 @@
+#include "filterscheduler.h"
+
+FilterScheduler::FilterScheduler(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &FilterScheduler::triggered);
+}
+
+void FilterScheduler::schedule(int delayMs)
+{
+    // 已有更早到期的刷新在等待，且这次不是输入 (输入需要重新计时)：维持原截止时间
+    if (m_timer.isActive() && delayMs < TypingDelayMs && m_timer.remainingTime() <= delayMs) {
+        return;
+    }
+    m_timer.start(delayMs);
+}
+
+void FilterScheduler::flush()
+{
+    m_timer.stop();
+    emit triggered();
+}
+
+void FilterScheduler::cancel()
+{
+    m_timer.stop();
+}
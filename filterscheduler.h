@@ -0,0 +1,33 @@
+#ifndef FILTERSCHEDULER_H
+#define FILTERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+
+// 筛选刷新的合并调度
+// 筛选控件每次变化都调用 schedule()，等待期间的所有变化合并成一次 triggered()：
+// 搜索框每次按键都重新计时 (防抖)，用户停下来才刷新；
+// 其他变化不会推迟已经更早到期的刷新
+class FilterScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int TypingDelayMs = 300; // 搜索框：等用户停下来
+    static const int StepDelayMs = 150;   // 日期微调按钮连点
+    static const int ImmediateMs = 0;     // 下拉框：下一轮事件循环即刷新 (同一轮里的多次变化合并)
+
+    explicit FilterScheduler(QObject *parent = nullptr);
+
+    void schedule(int delayMs);
+    void flush();  // 立即触发 (例如点击“筛选”按钮)
+    void cancel(); // 丢弃尚未触发的刷新
+
+signals:
+    void triggered();
+
+private:
+    QTimer m_timer;
+};
+
+#endif // FILTERSCHEDULER_H
@@ -0,0 +1,294 @@
+#include "headlessreport.h"
+#include "aggregationservice.h"
+#include "csvformat.h"
+#include "databasemanager.h"
+#include "money.h"
+#include "parallelaggregator.h"
+#include "recordexporter.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTextStream>
+#include <cstring>
+
+namespace
+{
+    QString typeName(int type)
+    {
+        return type == 1 ? "收入" : "支出";
+    }
+
+    QByteArray toCsv(const AggregateSnapshot &snapshot)
+    {
+        QByteArray out = QByteArray("\xEF\xBB\xBF") + "分类ID,分类,类型,金额,笔数\r\n";
+        auto appendRow = [&out](const QString &id, const QString &name, const QString &type,
+                                const QString &amount, const QString &count) {
+            CsvFormat::appendField(out, id);
+            out += ',';
+            CsvFormat::appendField(out, name);
+            out += ',';
+            CsvFormat::appendField(out, type);
+            out += ',';
+            CsvFormat::appendField(out, amount);
+            out += ',';
+            CsvFormat::appendField(out, count);
+            out += "\r\n";
+        };
+        for (const CategoryTotal &category : snapshot.categories()) {
+            appendRow(QString::number(category.id), category.name, typeName(category.type),
+                      Money::toString(category.cents), QString::number(category.count));
+        }
+        // 合计行不带分类ID，导入表格后按第一列筛选即可区分
+        appendRow(QString(), "总收入", typeName(1), Money::toString(snapshot.totalIncomeCents()), QString());
+        appendRow(QString(), "总支出", typeName(0), Money::toString(snapshot.totalExpenseCents()), QString());
+        appendRow(QString(), "结余", QString(), Money::toString(snapshot.balanceCents()),
+                  QString::number(snapshot.recordCount()));
+        return out;
+    }
+
+    QByteArray toJson(const AggregateSnapshot &snapshot, const RecordFilter &filter)
+    {
+        QJsonArray categories;
+        for (const CategoryTotal &category : snapshot.categories()) {
+            QJsonObject item;
+            item["id"] = category.id;
+            item["name"] = category.name;
+            item["type"] = typeName(category.type);
+            item["amount"] = Money::toYuan(category.cents);
+            item["count"] = category.count;
+            categories.append(item);
+        }
+
+        QJsonObject root;
+        root["from"] = filter.startDate.isValid() ? filter.startDate.toString(Qt::ISODate) : QJsonValue();
+        root["to"] = filter.endDate.isValid() ? filter.endDate.toString(Qt::ISODate) : QJsonValue();
+        root["income"] = Money::toYuan(snapshot.totalIncomeCents());
+        root["expense"] = Money::toYuan(snapshot.totalExpenseCents());
+        root["balance"] = Money::toYuan(snapshot.balanceCents());
+        root["records"] = snapshot.recordCount();
+        root["categories"] = categories;
+        return QJsonDocument(root).toJson(QJsonDocument::Indented);
+    }
+
+    // 按月报表：每个 (月, 分类) 一行，没有记录的格子不输出
+    QByteArray toMonthlyCsv(const MonthlyReport &report)
+    {
+        const CategoryCache &categories = DatabaseManager::instance().categories();
+        QByteArray out = QByteArray("\xEF\xBB\xBF") + "月份,分类ID,分类,类型,金额,笔数,单笔最小,单笔最大\r\n";
+        for (int month = 0; month < report.months().size(); ++month) {
+            const QString monthText = report.months()[month].toString("yyyy-MM");
+            for (int column = 0; column < report.categoryIds().size(); ++column) {
+                const PeriodTotal &total = report.at(month, column);
+                if (total.count == 0) continue;
+                const int id = report.categoryIds()[column];
+                const CategoryInfo *info = categories.find(id);
+                const QStringList fields = {
+                    monthText, QString::number(id), info ? info->name : QString(), info ? typeName(info->type) : QString(),
+                    Money::toString(total.cents), QString::number(total.count),
+                    Money::toString(total.minCents), Money::toString(total.maxCents)
+                };
+                for (int i = 0; i < fields.size(); ++i) {
+                    if (i > 0) out += ',';
+                    CsvFormat::appendField(out, fields[i]);
+                }
+                out += "\r\n";
+            }
+        }
+        return out;
+    }
+
+    QByteArray toMonthlyJson(const MonthlyReport &report, const RecordFilter &filter)
+    {
+        const CategoryCache &categories = DatabaseManager::instance().categories();
+        QJsonArray months;
+        for (int month = 0; month < report.months().size(); ++month) {
+            QJsonArray items;
+            for (int column = 0; column < report.categoryIds().size(); ++column) {
+                const PeriodTotal &total = report.at(month, column);
+                if (total.count == 0) continue;
+                const int id = report.categoryIds()[column];
+                const CategoryInfo *info = categories.find(id);
+                QJsonObject item;
+                item["id"] = id;
+                item["name"] = info ? info->name : QString();
+                item["type"] = info ? typeName(info->type) : QString();
+                item["amount"] = Money::toYuan(total.cents);
+                item["count"] = total.count;
+                item["min"] = Money::toYuan(total.minCents);
+                item["max"] = Money::toYuan(total.maxCents);
+                items.append(item);
+            }
+            QJsonObject entry;
+            entry["month"] = report.months()[month].toString("yyyy-MM");
+            entry["categories"] = items;
+            months.append(entry);
+        }
+
+        QJsonObject root;
+        root["from"] = filter.startDate.isValid() ? filter.startDate.toString(Qt::ISODate) : QJsonValue();
+        root["to"] = filter.endDate.isValid() ? filter.endDate.toString(Qt::ISODate) : QJsonValue();
+        root["months"] = months;
+        return QJsonDocument(root).toJson(QJsonDocument::Indented);
+    }
+
+    // 输出到文件 (先写临时文件再替换) 或标准输出 ("-" 或未指定)
+    bool writeOutput(const QString &path, const QByteArray &data, QString *error)
+    {
+        if (path.isEmpty() || path == "-") {
+            QFile out;
+            if (!out.open(stdout, QIODevice::WriteOnly) || out.write(data) != data.size()) {
+                *error = "无法写入标准输出";
+                return false;
+            }
+            return true;
+        }
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            *error = file.errorString();
+            return false;
+        }
+        return true;
+    }
+}
+
+bool HeadlessReport::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (std::strcmp(arg, "--report") == 0 || std::strcmp(arg, "--export") == 0
+            || std::strncmp(arg, "--export=", 9) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int HeadlessReport::run(const QStringList &arguments)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("个人记账：命令行报表与导出 (不启动界面)");
+    parser.addHelpOption();
+
+    QCommandLineOption reportOption("report", "输出收入、支出、结余与各分类合计");
+    QCommandLineOption exportOption("export", "把筛选出的记录导出为 CSV", "file");
+    QCommandLineOption fromOption("from", "起始日期 (含当天)", "yyyy-MM-dd");
+    QCommandLineOption toOption("to", "结束日期 (含当天)", "yyyy-MM-dd");
+    QCommandLineOption typeOption("type", "只统计 支出/expense 或 收入/income", "type");
+    QCommandLineOption categoryOption("category", "只统计该分类ID", "id");
+    QCommandLineOption searchOption("search", "备注关键词 (语法同界面的搜索框)", "text");
+    QCommandLineOption formatOption("format", "报表格式：csv 或 json", "format", "csv");
+    QCommandLineOption outputOption({"o", "output"}, "报表输出文件，默认为标准输出", "file");
+    QCommandLineOption dbOption("db", "数据库文件，默认为程序目录下的 finance.db", "file",
+                                QCoreApplication::applicationDirPath() + "/finance.db");
+    QCommandLineOption timingOption("timing", "在标准错误输出打印耗时");
+    QCommandLineOption monthlyOption("monthly", "报表改为按月、按分类列出 (金额、笔数、单笔最小/最大)，多核并行汇总");
+    QCommandLineOption columnarOption("columnar", "用列式快照 (数据库旁的 -columns 文件) 统计，快照按需补到最新");
+    parser.addOptions({reportOption, exportOption, fromOption, toOption, typeOption, categoryOption,
+                       searchOption, formatOption, outputOption, dbOption, timingOption, monthlyOption,
+                       columnarOption});
+    parser.process(arguments);
+
+    // 筛选条件与界面共用 RecordFilter，口径一致
+    RecordFilter filter;
+    bool ok = true;
+    if (parser.isSet(fromOption)) {
+        filter.startDate = QDate::fromString(parser.value(fromOption), Qt::ISODate);
+        ok = ok && filter.startDate.isValid();
+    }
+    if (parser.isSet(toOption)) {
+        filter.endDate = QDate::fromString(parser.value(toOption), Qt::ISODate);
+        ok = ok && filter.endDate.isValid();
+    }
+    if (parser.isSet(typeOption)) {
+        QString type = parser.value(typeOption).toLower();
+        if (type == "支出" || type == "expense" || type == "0") filter.type = 0;
+        else if (type == "收入" || type == "income" || type == "1") filter.type = 1;
+        else ok = false;
+    }
+    if (parser.isSet(categoryOption)) {
+        bool idOk = false;
+        filter.categoryId = parser.value(categoryOption).toInt(&idOk);
+        ok = ok && idOk;
+    }
+    filter.noteText = parser.value(searchOption).trimmed();
+
+    QString format = parser.value(formatOption).toLower();
+    bool wantReport = parser.isSet(reportOption);
+    bool wantExport = parser.isSet(exportOption);
+    if (!ok || (format != "csv" && format != "json") || (!wantReport && !wantExport)
+        || (filter.startDate.isValid() && filter.endDate.isValid() && filter.startDate > filter.endDate)) {
+        err << "参数无效，见 --help\n";
+        return 2;
+    }
+
+    const QString dbPath = QFileInfo(parser.value(dbOption)).absoluteFilePath();
+    if (!QFileInfo::exists(dbPath)) {
+        // 不在这里新建空账本：多半是路径写错了
+        err << "数据库不存在：" << dbPath << "\n";
+        return 1;
+    }
+
+    // 只统计一次，不建按天汇总缓存，汇总直接走 SQL (走索引的分组查询)；
+    // 启用列式快照时改为顺序扫描快照 (备注搜索仍走 SQL)
+    DatabaseManager &db = DatabaseManager::instance();
+    if (parser.isSet(columnarOption)) {
+        db.setColumnarSnapshotEnabled(true);
+    }
+    if (!db.openDatabase(dbPath, DatabaseManager::OpenMode::Headless)) {
+        err << "无法打开数据库：" << dbPath << "\n";
+        return 1;
+    }
+    qint64 openMs = timer.elapsed();
+
+    int exitCode = 0;
+    if (wantReport) {
+        QByteArray data;
+        if (parser.isSet(monthlyOption)) {
+            MonthlyReportPtr report = ParallelAggregator::compute(filter);
+            if (report) {
+                data = format == "json" ? toMonthlyJson(*report, filter) : toMonthlyCsv(*report);
+            }
+        } else {
+            AggregateSnapshotPtr snapshot = AggregationService::compute(filter);
+            data = format == "json" ? toJson(*snapshot, filter) : toCsv(*snapshot);
+        }
+        QString error;
+        if (data.isEmpty()) {
+            err << "统计失败\n";
+            exitCode = 1;
+        } else if (!writeOutput(parser.value(outputOption), data, &error)) {
+            err << "写入报表失败：" << error << "\n";
+            exitCode = 1;
+        }
+    }
+    qint64 reportMs = timer.elapsed() - openMs;
+
+    if (wantExport && exitCode == 0) {
+        RecordExporter exporter;
+        RecordExporter::Result result = exporter.run(filter, parser.value(exportOption), dbPath);
+        if (!result.error.isEmpty()) {
+            err << "导出失败：" << result.error << "\n";
+            exitCode = 1;
+        } else {
+            err << QString("已导出 %1 条记录 -> %2\n")
+                       .arg(result.exported)
+                       .arg(QFileInfo(parser.value(exportOption)).absoluteFilePath());
+        }
+    }
+
+    db.closeDatabase();
+    if (parser.isSet(timingOption)) {
+        err << QString("open %1 ms, report %2 ms, total %3 ms\n").arg(openMs).arg(reportMs).arg(timer.elapsed());
+    }
+    return exitCode;
+}
@@ -0,0 +1,22 @@
+#ifndef HEADLESSREPORT_H
+#define HEADLESSREPORT_H
+
+#include <QStringList>
+
+// 命令行报表/导出模式 (不创建任何窗口，可在无显示器的服务器上由定时任务调用)
+//   FinanceManager --report [--from 日期] [--to 日期] [--type 支出|收入] [--category ID] [--search 关键词]
+//                           [--format csv|json] [--output 文件] [--db 数据库] [--monthly] [--columnar]
+//   FinanceManager --export 文件.csv [同样的筛选参数] [--db 数据库]
+// 报表给出收入、支出、结余与各分类合计 (--monthly 时为各月各分类的合计、笔数与单笔最小/最大)；
+// 导出与界面“导出 CSV”的格式相同
+// 服务器上可改用不链接界面模块的 fmreport (tools/report)，参数相同
+namespace HeadlessReport
+{
+    // 命令行里是否带了 --report / --export (须在创建 QApplication 之前判断)
+    bool isRequested(int argc, char *argv[]);
+
+    // 需要已创建 QCoreApplication；返回进程退出码 (0 成功，1 失败，2 参数无效)
+    int run(const QStringList &arguments);
+}
+
+#endif // HEADLESSREPORT_H
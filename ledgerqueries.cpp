@@ -0,0 +1,151 @@
+#include "ledgerqueries.h"
+#include <QDate>
+
+namespace
+{
+    QString orderBy(const QStringList &sortColumns, bool descending)
+    {
+        QStringList terms;
+        for (const QString &column : sortColumns) {
+            terms << column + (descending ? " DESC" : " ASC");
+        }
+        return terms.join(", ");
+    }
+}
+
+QString LedgerQueries::categoryTotals(const RecordFilter &filter)
+{
+    return "SELECT c.id, c.name, c.type, SUM(r.amount_cents), COUNT(*) FROM record r "
+           "JOIN category c ON r.cid = c.id "
+           "WHERE 1=1 " + filter.toJoinedSql() +
+           " GROUP BY c.id";
+}
+
+QString LedgerQueries::dailyTotals(const RecordFilter &filter)
+{
+    return "SELECT CAST(julianday(r.timestamp, 'unixepoch', 'localtime', 'start of day') + 0.5 AS INTEGER) AS day, "
+           "c.type, SUM(r.amount_cents) FROM record r "
+           "JOIN category c ON r.cid = c.id "
+           "WHERE 1=1 " + filter.toJoinedSql() +
+           " GROUP BY day, c.type";
+}
+
+QString LedgerQueries::categoryRangeTotals(const RecordFilter &filter, qint64 fromSecs, qint64 toSecs)
+{
+    return QString("SELECT r.cid, SUM(r.amount_cents), COUNT(*), MIN(r.amount_cents), MAX(r.amount_cents) "
+                   "FROM record r JOIN category c ON r.cid = c.id "
+                   "WHERE r.timestamp >= %1 AND r.timestamp <= %2").arg(fromSecs).arg(toSecs)
+           + filter.toJoinedSql() + " GROUP BY r.cid";
+}
+
+QString LedgerQueries::categorySums(qint64 fromSecs, qint64 toSecs)
+{
+    return QString("SELECT cid, SUM(amount_cents) FROM record "
+                   "WHERE timestamp >= %1 AND timestamp <= %2 GROUP BY cid").arg(fromSecs).arg(toSecs);
+}
+
+QString LedgerQueries::recordCount(const RecordFilter &filter)
+{
+    return "SELECT COUNT(*) FROM record WHERE " + filter.toRecordSql();
+}
+
+QString LedgerQueries::recordWindow(const RecordFilter &filter, const QStringList &sortColumns, bool descending,
+                                    bool afterAnchor, int limit, qint64 offset)
+{
+    QString sql = "SELECT id, amount_cents, timestamp, note, cid FROM record WHERE " + filter.toRecordSql();
+
+    if (afterAnchor) {
+        QStringList placeholders;
+        for (int i = 0; i < sortColumns.size(); ++i) placeholders << "?";
+        sql += QString(" AND (%1) %2 (%3)")
+                   .arg(sortColumns.join(", "), descending ? "<" : ">", placeholders.join(", "));
+    }
+
+    sql += " ORDER BY " + orderBy(sortColumns, descending);
+    sql += QString(" LIMIT %1 OFFSET %2").arg(limit).arg(offset);
+    return sql;
+}
+
+QString LedgerQueries::recordAnchors(const RecordFilter &filter, const QStringList &sortColumns, bool descending,
+                                     int stride)
+{
+    // 窗口函数的排序与索引一致，只读索引、不需要临时排序
+    const QString columns = sortColumns.join(", ");
+    const QString order = orderBy(sortColumns, descending);
+    return QString("SELECT %1 FROM (SELECT %1, ROW_NUMBER() OVER (ORDER BY %2) AS rn FROM record WHERE %3) "
+                   "WHERE rn % %4 = 0 ORDER BY rn")
+        .arg(columns, order, filter.toRecordSql(), QString::number(stride));
+}
+
+QString LedgerQueries::exportRows(const RecordFilter &filter)
+{
+    // 不 JOIN 分类表：按时间索引顺序读取，不需要临时排序，内存占用与行数无关
+    return "SELECT id, amount_cents, timestamp, note, cid FROM record WHERE " + filter.toRecordSql() +
+           " ORDER BY timestamp";
+}
+
+QStringList LedgerQueries::planCheckQueries()
+{
+    // 以最近一个月为基础，叠加类型、分类、备注的各种组合
+    RecordFilter base;
+    base.startDate = QDate::currentDate().addMonths(-1);
+    base.endDate = QDate::currentDate();
+
+    QList<RecordFilter> filters;
+    filters << base;
+    for (int type : {0, 1}) {
+        RecordFilter f = base;
+        f.type = type;
+        filters << f;
+
+        f.categoryId = 1;
+        filters << f;
+    }
+    {
+        RecordFilter f = base;
+        f.categoryId = 1;
+        filters << f;
+
+        f.noteText = "午饭";
+        filters << f;
+    }
+    {
+        RecordFilter f = base;
+        f.noteText = "午饭";
+        filters << f;
+
+        f.noteText = "和同事 午饭钱*"; // 全文索引 + 前缀
+        filters << f;
+    }
+
+    QStringList queries;
+    for (const RecordFilter &f : filters) {
+        queries << categoryTotals(f);
+        queries << dailyTotals(f);
+        queries << categoryRangeTotals(f, 0, 2678399);
+        queries << recordCount(f);
+        queries << recordWindow(f, {"timestamp", "id"}, false, true, 256, 0);
+        queries << recordWindow(f, {"timestamp", "id"}, true, true, 256, 0);
+        queries << exportRows(f);
+    }
+
+    // 明细表格在无筛选时按各列翻页 (带锚点的窗口)
+    const QList<QStringList> sorts = {
+        {"timestamp", "id"}, {"amount_cents", "id"}, {"note", "id"}, {"cid", "timestamp", "amount_cents", "id"}
+    };
+    for (const QStringList &columns : sorts) {
+        queries << recordWindow(RecordFilter(), columns, false, true, 256, 0);
+        queries << recordWindow(RecordFilter(), columns, true, true, 256, 0);
+    }
+
+    // DatabaseManager 内部使用的语句 (参数以字面量代替)
+    queries << categorySums(0, 2678399);
+    queries << "SELECT name, id FROM category WHERE type = 0";
+    queries << "SELECT id FROM category WHERE name = '未分类' AND type = 0";
+    queries << "SELECT count(*) FROM category WHERE name = '餐饮美食' AND type = 0";
+    queries << "UPDATE record SET cid = 2 WHERE cid = 1";
+    queries << "DELETE FROM record WHERE cid = 1";
+    queries << "DELETE FROM category WHERE id = 1";
+
+    return queries;
+}
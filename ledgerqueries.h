@@ -0,0 +1,47 @@
+#ifndef LEDGERQUERIES_H
+#define LEDGERQUERIES_H
+
+#include <QString>
+#include <QStringList>
+#include "recordfilter.h"
+
+// 应用发出的统计/列表查询集中在这里生成
+// 一方面主界面直接使用，另一方面执行计划检查可以拿到与运行时完全相同的 SQL
+namespace LedgerQueries
+{
+    // 按分类汇总：分类ID、名称、类型、金额合计 (分)、记录数
+    // 图表与概览需要的全部数字都由这一条查询得出
+    QString categoryTotals(const RecordFilter &filter);
+
+    // 收支趋势：本地日期 (儒略日，与 QDate::toJulianDay 一致)、收支类型、金额合计 (分)
+    // 按 (天, 类型) 分组，趋势图的各时间段由调用方折叠
+    QString dailyTotals(const RecordFilter &filter);
+
+    // 多年报表的一个时间段 [fromSecs, toSecs]：分类ID、金额合计 (分)、记录数、单笔最小、单笔最大
+    // 筛选条件里的日期照常生效 (调用方按月切分时会把它去掉，改由时间段给出)
+    QString categoryRangeTotals(const RecordFilter &filter, qint64 fromSecs, qint64 toSecs);
+
+    // 预算：时间段 [fromSecs, toSecs] 内各分类的金额合计 (分)，不带其他筛选
+    QString categorySums(qint64 fromSecs, qint64 toSecs);
+
+    // 明细表格：满足筛选条件的记录数
+    QString recordCount(const RecordFilter &filter);
+
+    // 明细表格的一个窗口：按 sortColumns 排序 (最后一列为 id)，
+    // afterAnchor 为真时追加键集条件 (sortColumns) > (?, ...)，降序时为 <，参数按列顺序绑定
+    QString recordWindow(const RecordFilter &filter, const QStringList &sortColumns, bool descending,
+                         bool afterAnchor, int limit, qint64 offset);
+
+    // 明细表格的稀疏锚点：按与 recordWindow 相同的排序，取第 stride、2*stride ... 行的排序键 (列同 sortColumns)
+    // 一次按索引顺序读完筛选结果，之后拖动到任意位置都从最近的锚点起定位，OFFSET 不超过 stride
+    QString recordAnchors(const RecordFilter &filter, const QStringList &sortColumns, bool descending, int stride);
+
+    // 导出：满足筛选条件的全部记录，按时间顺序逐行读取 (分类名由调用方按 cid 查表)
+    QString exportRows(const RecordFilter &filter);
+
+    // 需要检查执行计划的全部查询：覆盖各种筛选组合以及 DatabaseManager 内部的语句
+    // 不含“列出全部分类/全部账单”这类本身就要读完整张表的查询
+    QStringList planCheckQueries();
+}
+
+#endif // LEDGERQUERIES_H
@@ -1,10 +1,32 @@
 #include "mainwindow.h"
+#include "databasemanager.h"
+#include "headlessreport.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::start();
+
+    // 命令行报表/导出：只用 QCoreApplication，不加载平台插件、不创建任何窗口和图表
+    if (HeadlessReport::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        return HeadlessReport::run(app.arguments());
+    }
+
     QApplication a(argc, argv);
+    // 启动各阶段耗时 (也可设置环境变量 FM_STARTUP_TIMING=1)
+    if (a.arguments().contains("--startup-timing")) {
+        StartupProfiler::setEnabled(true);
+    }
+    StartupProfiler::mark("application");
+
+    // 事件循环结束时关闭账本 (写入表格编辑、把 WAL 并回主文件)，不留给单例在 main() 之后析构
+    QObject::connect(&a, &QCoreApplication::aboutToQuit, []() {
+        DatabaseManager::instance().closeDatabase();
+    });
+
     MainWindow w;
     w.show();
     return a.exec();
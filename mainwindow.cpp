@@ -4,17 +4,34 @@
 #include "addrecorddialog.h"
 #include "databasemanager.h"
 #include "categorydialog.h"
+#include "aggregationservice.h"
+#include "trendengine.h"
+#include "chartupdater.h"
+#include "recordexporter.h"
+#include "recordimporter.h"
+#include "recurringscheduler.h"
+#include "uistallmonitor.h"
+#include "filterscheduler.h"
+#include "startupprofiler.h"
+#include "money.h"
 
 #include <QMessageBox>
-#include <QSqlRecord>
-#include <QSqlRelationalDelegate>
+#include <QProgressDialog>
+#include <QComboBox>
 #include <QFileDialog>
-#include <QTextStream>
+#include <QInputDialog>
+#include <QMenu>
 #include <QDateTime>
 #include <QHeaderView>
 #include <QDateTimeEdit>
+#include <QApplication>
 #include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QStatusBar>
+#include <QTimer>
+#include <algorithm>
 
 // 时间戳转换代理 (TimeDelegate)
 // 作用：将数据库里的 Unix 时间戳 (秒) 转换为 "yyyy-MM-dd HH:mm" 格式显示，也负责在编辑时提供“日期时间控件”
@@ -93,28 +110,10 @@ public:
     void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override {
         QStyledItemDelegate::initStyleOption(option, index);
 
-        // 获取当前行的分类名称 (第4列)
-        // 使用 DisplayRole 确保获取到的是界面上看到的中文名 (如 "工资", "餐饮")
-        QString categoryName = index.sibling(index.row(), 4).data(Qt::DisplayRole).toString();
-
-        // 查询类型 (0:支出, 1:收入)
-        // 使用静态缓存，防止频繁查库导致卡顿
-        static QMap<QString, int> typeCache;
-
-        if (!typeCache.contains(categoryName)) {
-            // 如果缓存里没有，去数据库查一次
-            QSqlQuery query;
-            query.prepare("SELECT type FROM category WHERE name = ?");
-            query.addBindValue(categoryName);
-            if (query.exec() && query.next()) {
-                typeCache.insert(categoryName, query.value(0).toInt());
-            } else {
-                // 查不到就默认支出(0)，防止崩溃
-                typeCache.insert(categoryName, 0);
-            }
-        }
-
-        int type = typeCache.value(categoryName);
+        // 按分类ID从内存缓存取类型 (0:支出, 1:收入)，绘制时不访问数据库
+        int cid = index.data(RecordTableModel::CategoryIdRole).toInt();
+        const CategoryInfo *category = DatabaseManager::instance().categories().find(cid);
+        int type = category ? category->type : 0; // 查不到就默认支出(0)
 
         // 根据类型设置颜色和前缀
         if (type == 1) {
@@ -129,52 +128,273 @@ public:
     }
 };
 
+// 分类代理 (CategoryDelegate)
+// 作用：编辑时提供分类下拉框，模型里存的是分类ID
+class CategoryDelegate : public QStyledItemDelegate {
+public:
+    explicit CategoryDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {}
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
+                          const QModelIndex &index) const override
+    {
+        Q_UNUSED(option);
+        Q_UNUSED(index);
+
+        QComboBox *editor = new QComboBox(parent);
+        for (const CategoryInfo &category : DatabaseManager::instance().categories().categories()) {
+            editor->addItem(category.name, category.id);
+        }
+        return editor;
+    }
+
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override
+    {
+        QComboBox *combo = static_cast<QComboBox*>(editor);
+        combo->setCurrentIndex(combo->findData(index.data(Qt::EditRole).toInt()));
+    }
+
+    void setModelData(QWidget *editor, QAbstractItemModel *model,
+                      const QModelIndex &index) const override
+    {
+        QComboBox *combo = static_cast<QComboBox*>(editor);
+        if (combo->currentIndex() >= 0) {
+            model->setData(index, combo->currentData(), Qt::EditRole);
+        }
+    }
+
+    void updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option,
+                              const QModelIndex &index) const override
+    {
+        Q_UNUSED(index);
+        editor->setGeometry(option.rect);
+    }
+};
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
+    StartupProfiler::Phase phase("window");
     ui->setupUi(this);
 
-    // 获取当前 exe 运行目录
-    QString runPath = QCoreApplication::applicationDirPath();
-    // 拼接数据库文件名
-    QString dbPath = runPath + "/finance.db";
-
-    // 连接数据库
-    if (!DatabaseManager::instance().openDatabase(dbPath)) {
-        QMessageBox::critical(this, "错误", "无法连接数据库！\n路径: " + dbPath);
+    // 界面卡顿统计 (调试构建或 FM_STALL_MONITOR=1)
+    if (UiStallMonitor::isEnabled()) {
+        new UiStallMonitor(this);
     }
 
-    // 初始化各个模块
-    initModelView();
-    initCharts();
-
-    // 初始化筛选控件
-    ui->dateEdit_Start->setDate(QDate::currentDate().addMonths(-1)); // 默认查最近一个月
-    ui->dateEdit_End->setDate(QDate::currentDate());
-
     // 初始化筛选类型 ComboBox
     ui->comboBox_FilterType->clear();
     ui->comboBox_FilterType->addItem("全部", -1);
     ui->comboBox_FilterType->addItem("支出", 0);
     ui->comboBox_FilterType->addItem("收入", 1);
 
+    // 筛选条件恢复为上次退出时的 (分类要等分类表读出来，见 finishStartup)
+    restoreFilterSettings();
+
+    // 表格只建好视图与代理，不取数据
+    initModelView();
+
+    filterScheduler = new FilterScheduler(this);
+    recurringScheduler = new RecurringScheduler(this);
+
+    // 打开数据库、建图表、统计都放到窗口第一次画出来之后 (见 paintEvent)
+    setLoading(true);
+}
+
+MainWindow::~MainWindow()
+{
+    DatabaseManager::instance().edits().flush(); // 退出时写入尚未写入的表格编辑
+    saveFilterSettings();
+    delete ui;
+}
+
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+    if (m_startupScheduled) return;
+
+    // 等这一帧交给窗口系统之后再开始加载
+    m_startupScheduled = true;
+    StartupProfiler::mark("first paint");
+    QTimer::singleShot(0, this, &MainWindow::finishStartup);
+}
+
+void MainWindow::finishStartup()
+{
+    // 获取当前 exe 运行目录，拼接数据库文件名
+    QString dbPath = QCoreApplication::applicationDirPath() + "/finance.db";
+
+    // 存储参数：finance.ini 的 storage/profile (safe / balanced / fast)，环境变量 FM_STORAGE_PROFILE 优先
+    QSettings settings(settingsPath(), QSettings::IniFormat);
+    if (!settings.contains("storage/profile")) {
+        settings.setValue("storage/profile", StorageProfile::name(DatabaseManager::instance().storageProfile().level));
+    } else if (!qEnvironmentVariableIsSet("FM_STORAGE_PROFILE")) {
+        StorageProfile::Level level = StorageProfile::Balanced;
+        if (!StorageProfile::parse(settings.value("storage/profile").toString(), &level)) {
+            qDebug() << "Unknown storage profile:" << settings.value("storage/profile").toString();
+        }
+        DatabaseManager::instance().setStorageProfile(StorageProfile::forLevel(level));
+    }
+    // 列式快照：finance.ini 的 storage/columnarSnapshot (默认关闭)，环境变量 FM_COLUMNAR_SNAPSHOT 优先
+    if (!settings.contains("storage/columnarSnapshot")) {
+        settings.setValue("storage/columnarSnapshot", DatabaseManager::instance().columnarSnapshotEnabled());
+    } else if (!qEnvironmentVariableIsSet("FM_COLUMNAR_SNAPSHOT")) {
+        DatabaseManager::instance().setColumnarSnapshotEnabled(settings.value("storage/columnarSnapshot").toBool());
+    }
+
+    // 连接数据库；按天汇总缓存要扫全表，改在后台建，建好之前统计走数据库线程
+    bool opened = DatabaseManager::instance().openDatabase(dbPath, DatabaseManager::OpenMode::Deferred);
+    if (!opened) {
+        QMessageBox::critical(this, "错误", "无法连接数据库！\n路径: " + dbPath);
+    }
+
+    // 加载筛选分类并选回上次的分类；之后分类增删时自动刷新
+    loadFilterCategories(ui->comboBox_FilterType->currentData().toInt());
+    ui->comboBox_FilterCategory->setCurrentIndex(qMax(0, ui->comboBox_FilterCategory->findData(m_savedCategoryId)));
+    connect(&DatabaseManager::instance().categories(), &CategoryCache::changed, this, [this]() {
+        loadFilterCategories(ui->comboBox_FilterType->currentData().toInt());
+    });
+
+    // 本月预算：计数随每次写入调整，变化时刷新概览里的预算一行，越过提醒比例或预算时提醒
+    BudgetTracker &budgets = DatabaseManager::instance().budgets();
+    connect(&budgets, &BudgetTracker::changed, this, &MainWindow::updateBudget);
+    // 提醒排队到写入完成之后再弹出：弹窗的事件循环不能插进写入 (例如延迟写入队列的 flush) 中间
+    connect(&budgets, &BudgetTracker::thresholdCrossed, this, &MainWindow::showBudgetAlert, Qt::QueuedConnection);
+    updateBudget();
+
     // 联动连接：当筛选类型改变时，更新筛选分类
     connect(ui->comboBox_FilterType, SIGNAL(currentIndexChanged(int)),
             this, SLOT(on_filterTypeChanged(int)));
 
-    // 初始加载所有分类
-    loadFilterCategories(-1);
+    // 边输入边筛选：控件变化交给调度器合并，停下来后只刷新一次
+    connect(filterScheduler, &FilterScheduler::triggered, this, &MainWindow::applyFilter);
+    connect(ui->lineEdit_Search, &QLineEdit::textChanged, this, [this]() {
+        filterScheduler->schedule(FilterScheduler::TypingDelayMs);
+    });
+    connect(ui->dateEdit_Start, &QDateEdit::dateChanged, this, [this]() {
+        filterScheduler->schedule(FilterScheduler::StepDelayMs);
+    });
+    connect(ui->dateEdit_End, &QDateEdit::dateChanged, this, [this]() {
+        filterScheduler->schedule(FilterScheduler::StepDelayMs);
+    });
+    connect(ui->comboBox_FilterType, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        filterScheduler->schedule(FilterScheduler::ImmediateMs);
+    });
+    connect(ui->comboBox_FilterCategory, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        filterScheduler->schedule(FilterScheduler::ImmediateMs);
+    });
+
+    {
+        StartupProfiler::Phase phase("chart build");
+        initCharts();
+    }
+
+    // 表格按恢复的筛选条件只统计行数，视图滚到哪里再取哪一窗口的数据
+    // 行数、汇总缓存都好了才算启动完成
+    m_startupPending = opened ? 2 : 1;
+    QElapsedTimer selectTimer;
+    selectTimer.start();
+    connect(model, &QAbstractItemModel::modelReset, this, [this, selectTimer]() {
+        StartupProfiler::record("model select", selectTimer.nsecsElapsed() / 1000);
+        startupStepDone();
+    }, Qt::SingleShotConnection);
+    model->setFilter(currentFilter());
+    model->select();
 
     // 初始刷新图表
-    updateCharts();
+    refreshAggregates();
+
+    if (opened) {
+        DatabaseManager::instance().rebuildRollupInBackground(this, [this](bool ok) {
+            Q_UNUSED(ok); // 失败时统计继续走 SQL
+            StartupProfiler::mark("rollup ready");
+            ui->actionImport->setEnabled(true);
+            // 重复账单与导入一样在自己的线程上提交，同样等缓存建好再补生成上次退出以来到期的
+            recurringScheduler->activate();
+            startupStepDone();
+        });
+    }
 
-    updateSummary();
+    connect(recurringScheduler, &RecurringScheduler::finished, this, [this](const RecurringScheduler::Result &result) {
+        if (!result.error.isEmpty()) {
+            statusBar()->showMessage("重复账单生成失败：" + result.error, 10000);
+            return;
+        }
+        if (result.generated == 0) return;
+        model->select();
+        refreshAggregates();
+        statusBar()->showMessage(QString("已自动记入 %1 条到期的重复账单").arg(result.generated), 10000);
+    });
+
+    setLoading(false);
+    StartupProfiler::mark("interactive");
 }
 
-MainWindow::~MainWindow()
+void MainWindow::startupStepDone()
 {
-    delete ui;
+    if (--m_startupPending == 0) {
+        StartupProfiler::finish();
+    }
+}
+
+void MainWindow::setLoading(bool loading)
+{
+    // 数据库打开之前不能操作数据；导入另外等汇总缓存建好 (见 finishStartup)
+    ui->btn_Filter->setEnabled(!loading);
+    ui->btn_Reset->setEnabled(!loading);
+    ui->btn_Delete->setEnabled(!loading);
+    ui->actionAddRecord->setEnabled(!loading);
+    ui->actionExport->setEnabled(!loading);
+    ui->actionManageCategory->setEnabled(!loading);
+    ui->actionRecurringRules->setEnabled(!loading);
+
+    if (loading) {
+        ui->actionImport->setEnabled(false);
+        statusBar()->showMessage("正在打开账本...");
+    } else {
+        statusBar()->clearMessage();
+    }
+}
+
+QString MainWindow::settingsPath()
+{
+    // 与数据库放在一起，随程序目录一起搬走
+    return QCoreApplication::applicationDirPath() + "/finance.ini";
+}
+
+void MainWindow::restoreFilterSettings()
+{
+    QSettings settings(settingsPath(), QSettings::IniFormat);
+    QDate start = QDate::fromString(settings.value("filter/start").toString(), Qt::ISODate);
+    QDate end = QDate::fromString(settings.value("filter/end").toString(), Qt::ISODate);
+    QDate savedOn = QDate::fromString(settings.value("filter/savedOn").toString(), Qt::ISODate);
+
+    if (!start.isValid() || !end.isValid()) {
+        // 第一次运行：默认查最近一个月
+        start = QDate::currentDate().addMonths(-1);
+        end = QDate::currentDate();
+    } else if (savedOn.isValid() && end == savedOn) {
+        // 上次看的是“截至当天”，整段随日期顺延，仍然截至今天
+        qint64 days = savedOn.daysTo(QDate::currentDate());
+        start = start.addDays(days);
+        end = end.addDays(days);
+    }
+    ui->dateEdit_Start->setDate(start);
+    ui->dateEdit_End->setDate(end);
+
+    int type = settings.value("filter/type", -1).toInt();
+    ui->comboBox_FilterType->setCurrentIndex(qMax(0, ui->comboBox_FilterType->findData(type)));
+    m_savedCategoryId = settings.value("filter/category", -1).toInt();
+}
+
+void MainWindow::saveFilterSettings() const
+{
+    QSettings settings(settingsPath(), QSettings::IniFormat);
+    settings.setValue("filter/start", ui->dateEdit_Start->date().toString(Qt::ISODate));
+    settings.setValue("filter/end", ui->dateEdit_End->date().toString(Qt::ISODate));
+    settings.setValue("filter/savedOn", QDate::currentDate().toString(Qt::ISODate));
+    settings.setValue("filter/type", ui->comboBox_FilterType->currentData().toInt());
+    settings.setValue("filter/category", ui->comboBox_FilterCategory->currentData().toInt());
 }
 
 void MainWindow::on_actionAddRecord_triggered()
@@ -182,16 +402,39 @@ void MainWindow::on_actionAddRecord_triggered()
     AddRecordDialog dlg(this);
     if (dlg.exec() == QDialog::Accepted) {
         auto data = dlg.getRecordData();
+        if (data.cents < 0) {
+            QMessageBox::warning(this, "失败", "金额格式不正确。");
+            return;
+        }
+
+        // 重复账单：只保存规则，这一笔与以后各期都由调度器在到期时记入
+        RecurringRule rule;
+        if (dlg.getRepeat(&rule)) {
+            rule.cents = data.cents;
+            rule.start = data.dateTime;
+            rule.note = data.note;
+            rule.cid = data.categoryId;
+            if (rule.endDate.isValid() && rule.endDate < rule.start.date()) {
+                QMessageBox::warning(this, "失败", "重复的截止日期早于账单日期。");
+                return;
+            }
+            if (!DatabaseManager::instance().addRecurringRule(rule)) {
+                QMessageBox::warning(this, "失败", "添加失败，请检查数据库。");
+                return;
+            }
+            recurringScheduler->runNow();
+            QMessageBox::information(this, "成功", "重复账单已保存（" + rule.describe() + "），到期的账单会自动记入。");
+            return;
+        }
 
         // 插入数据库
         bool success = DatabaseManager::instance().insertRecord(
-            data.amount, data.dateTime, data.note, data.categoryId
+            data.cents, data.dateTime, data.note, data.categoryId
             );
 
         if (success) {
             model->select(); // 刷新表格
-            updateCharts();  // 刷新图表
-            updateSummary(); // 刷新概览
+            refreshAggregates();
             QMessageBox::information(this, "成功", "账单添加成功！");
         } else {
             QMessageBox::warning(this, "失败", "添加失败，请检查数据库。");
@@ -200,35 +443,84 @@ void MainWindow::on_actionAddRecord_triggered()
 }
 
 
+void MainWindow::on_actionImport_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "导入数据", "", "CSV Files (*.csv)");
+    if (fileName.isEmpty()) return;
+
+    // 导入在后台线程进行，界面只显示进度；取消时整批回滚
+    RecordImporter *importer = new RecordImporter(this);
+    QProgressDialog *progress = new QProgressDialog("正在导入...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+
+    connect(progress, &QProgressDialog::canceled, importer, &RecordImporter::cancel);
+    connect(importer, &RecordImporter::progress, progress, [progress](int percent, qint64 rows) {
+        progress->setValue(percent);
+        progress->setLabelText(QString("正在导入... 已写入 %1 条").arg(rows));
+    });
+    connect(importer, &RecordImporter::finished, this, [this, importer, progress](const RecordImporter::Result &result) {
+        progress->close();
+        progress->deleteLater();
+        importer->deleteLater();
+
+        if (!result.error.isEmpty()) {
+            QMessageBox::warning(this, "失败", "导入失败：" + result.error);
+            return;
+        }
+        if (result.cancelled) {
+            QMessageBox::information(this, "已取消", "导入已取消，数据未作任何修改。");
+            return;
+        }
+
+        model->select();
+        refreshAggregates();
+
+        QString message = QString("成功导入 %1 条账单").arg(result.imported);
+        if (result.skipped > 0) {
+            message += QString("，跳过 %1 行无法识别的数据").arg(result.skipped);
+        }
+        QMessageBox::information(this, "成功", message + "。");
+    });
+
+    importer->start(fileName);
+}
+
 void MainWindow::on_actionExport_triggered()
 {
     QString fileName = QFileDialog::getSaveFileName(this, "导出数据", "", "CSV Files (*.csv)");
     if (fileName.isEmpty()) return;
 
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QTextStream out(&file);
-        // 写入 BOM 以解决 Excel 中文乱码
-        out << QString::fromUtf8("\xEF\xBB\xBF");
-
-        // 写表头
-        out << "ID,金额,时间,备注,分类\n";
-
-        // 写数据 (遍历 Model)
-        for(int i = 0; i < model->rowCount(); ++i) {
-            QString id = model->record(i).value("id").toString();
-            QString amount = model->record(i).value("amount").toString();
-            // 简单处理时间戳
-            qint64 ts = model->record(i).value("timestamp").toLongLong();
-            QString time = QDateTime::fromSecsSinceEpoch(ts).toString("yyyy-MM-dd HH:mm");
-            QString note = model->record(i).value("note").toString();
-            QString category = model->record(i).value("name").toString(); // 关联后的名字
-
-            out << id << "," << amount << "," << time << "," << note << "," << category << "\n";
+    // 直接从数据库流式导出当前筛选结果 (不经过表格模型)，后台线程进行
+    RecordExporter *exporter = new RecordExporter(this);
+    QProgressDialog *progress = new QProgressDialog("正在导出...", "取消", 0, 100, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+
+    connect(progress, &QProgressDialog::canceled, exporter, &RecordExporter::cancel);
+    connect(exporter, &RecordExporter::progress, progress, [progress](int percent, qint64 rows) {
+        progress->setValue(percent);
+        progress->setLabelText(QString("正在导出... 已写出 %1 条").arg(rows));
+    });
+    connect(exporter, &RecordExporter::finished, this, [this, exporter, progress](const RecordExporter::Result &result) {
+        progress->close();
+        progress->deleteLater();
+        exporter->deleteLater();
+
+        if (!result.error.isEmpty()) {
+            QMessageBox::warning(this, "失败", "导出失败：" + result.error);
+        } else if (!result.cancelled) {
+            QMessageBox::information(this, "成功", QString("导出成功！共 %1 条账单。").arg(result.exported));
         }
-        file.close();
-        QMessageBox::information(this, "成功", "导出成功！");
-    }
+    });
+
+    // 导出在数据库线程上读取，先写入表格里尚未写入的编辑
+    DatabaseManager::instance().edits().flush();
+    exporter->start(model->filter(), fileName);
 }
 
 
@@ -247,38 +539,17 @@ void MainWindow::on_actionAbout_triggered()
 
 void MainWindow::on_btn_Filter_clicked()
 {
-    QString filterStr = "1=1"; // 初始条件
-
-    // 日期筛选
-    qint64 startSec = QDateTime(ui->dateEdit_Start->date(), QTime(0,0)).toSecsSinceEpoch();
-    qint64 endSec = QDateTime(ui->dateEdit_End->date(), QTime(23,59,59)).toSecsSinceEpoch();
-    filterStr += QString(" AND timestamp >= %1 AND timestamp <= %2").arg(startSec).arg(endSec);
-
-    // 类型筛选 (如果是 -1 则全部)
-    int type = ui->comboBox_FilterType->currentData().toInt();
-    if (type != -1) {
-        filterStr += QString(" AND cid IN (SELECT id FROM category WHERE type = %1)").arg(type);
-    }
-
-    // 分类筛选
-    int categoryId = ui->comboBox_FilterCategory->currentData().toInt();
-    if (categoryId != -1) {
-        filterStr += QString(" AND cid = %1").arg(categoryId);
-    }
-
-    // 备注搜索 (模糊查询)
-    QString note = ui->lineEdit_Search->text().trimmed();
-    if (!note.isEmpty()) {
-        filterStr += QString(" AND note LIKE '%%1%'").arg(note);
-    }
+    // 不等防抖，立即应用
+    filterScheduler->flush();
+}
 
-    model->setFilter(filterStr);
+void MainWindow::applyFilter()
+{
+    model->setFilter(currentFilter());
     model->select();
 
     // 刷新图表，让图表也反映筛选后的时间段
-    updateCharts();
-
-    updateSummary();
+    refreshAggregates();
 }
 
 
@@ -300,36 +571,138 @@ void MainWindow::on_btn_Reset_clicked()
         ui->comboBox_FilterCategory->setCurrentIndex(0);
     }
 
+    // 上面改动控件引起的刷新不需要了：重置后表格显示全部记录
+    filterScheduler->cancel();
+
     // 重置数据模型（清除 SQL 筛选）
-    model->setFilter("");
+    model->clearFilter();
     model->select();
 
     // 刷新图表和概览
-    updateCharts();
-    updateSummary();
+    refreshAggregates();
 }
 
 
 void MainWindow::on_btn_Delete_clicked()
 {
-    QModelIndexList selection = ui->tableView->selectionModel()->selectedRows();
-    if (selection.isEmpty()) {
-        QMessageBox::warning(this, "提示", "请先选择要删除的行");
-        return;
+    batchDelete(false);
+}
+
+QList<int> MainWindow::selectedRows() const
+{
+    // 按选择区间展开，选中几万行时不必逐行询问选择模型
+    QList<int> rows;
+    for (const QItemSelectionRange &range : ui->tableView->selectionModel()->selection()) {
+        for (int row = range.top(); row <= range.bottom(); ++row) {
+            rows.append(row);
+        }
     }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    return rows;
+}
 
-    int ret = QMessageBox::question(this, "确认", "确定要删除选中的记录吗？", QMessageBox::Yes | QMessageBox::No);
-    if (ret == QMessageBox::Yes) {
-        // 从最后一行开始删，防止索引变化
-        for(int i = selection.count() - 1; i >= 0; i--) {
-            model->removeRow(selection.at(i).row());
+bool MainWindow::batchTarget(bool allMatching, const QString &question, QList<int> *rows)
+{
+    int count = 0;
+    if (allMatching) {
+        count = model->rowCount();
+        if (count == 0) {
+            QMessageBox::warning(this, "提示", "当前筛选结果为空");
+            return false;
         }
-        model->submitAll(); // 提交到数据库
-        model->select();
-        updateCharts();
+    } else {
+        *rows = selectedRows();
+        count = rows->size();
+        if (count == 0) {
+            QMessageBox::warning(this, "提示", "请先选择要操作的行");
+            return false;
+        }
+    }
+
+    QString scope = allMatching ? QString("当前筛选结果的全部 %1 条记录").arg(count)
+                                : QString("选中的 %1 条记录").arg(count);
+    return QMessageBox::question(this, "确认", question.arg(scope),
+                                 QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes;
+}
+
+void MainWindow::batchDelete(bool allMatching)
+{
+    QList<int> rows;
+    if (!batchTarget(allMatching, "确定要删除%1吗？", &rows)) return;
+
+    // 一条 DELETE、一个事务；表格直接移除这些行，汇总缓存由 DatabaseManager 按天合并后扣除
+    int affected = 0;
+    if (!model->removeRecords(rows, allMatching, &affected)) {
+        QMessageBox::warning(this, "失败", "删除失败，请检查数据库。");
+        return;
+    }
+    statusBar()->showMessage(QString("已删除 %1 条记录").arg(affected), 5000);
+    refreshAggregates();
+}
+
+void MainWindow::batchRecategorize(bool allMatching)
+{
+    // 目标分类：收支两类的分类都可以选 (记录随之改为对应的收支类型)
+    const QVector<CategoryInfo> categories = DatabaseManager::instance().categories().categories();
+    QStringList names;
+    for (const CategoryInfo &category : categories) {
+        names << QString("%1 - %2").arg(category.type == 1 ? "收入" : "支出", category.name);
+    }
+    bool ok = false;
+    QString picked = QInputDialog::getItem(this, "修改分类", "改为分类:", names, 0, false, &ok);
+    if (!ok) return;
+    int cid = categories[names.indexOf(picked)].id;
+
+    QList<int> rows;
+    if (!batchTarget(allMatching, "确定要把%1的分类改为“" + picked + "”吗？", &rows)) return;
+
+    int affected = 0;
+    if (!model->recategorizeRecords(rows, cid, allMatching, &affected)) {
+        QMessageBox::warning(this, "失败", "修改分类失败，请检查数据库。");
+        return;
+    }
+    statusBar()->showMessage(QString("已修改 %1 条记录的分类").arg(affected), 5000);
+    refreshAggregates();
+}
 
-        updateSummary();
+void MainWindow::batchShiftDate(bool allMatching)
+{
+    bool ok = false;
+    int days = QInputDialog::getInt(this, "平移日期", "平移天数 (负数为提前):", 1, -36500, 36500, 1, &ok);
+    if (!ok || days == 0) return;
+
+    QList<int> rows;
+    QString question = "确定要把%1的日期" + (days > 0 ? QString("推后 %1 天吗？").arg(days)
+                                                      : QString("提前 %1 天吗？").arg(-days));
+    if (!batchTarget(allMatching, question, &rows)) return;
+
+    int affected = 0;
+    if (!model->shiftRecords(rows, days, allMatching, &affected)) {
+        QMessageBox::warning(this, "失败", "修改日期失败，请检查数据库。");
+        return;
     }
+    statusBar()->showMessage(QString("已平移 %1 条记录的日期").arg(affected), 5000);
+    refreshAggregates();
+}
+
+void MainWindow::showTableMenu(const QPoint &pos)
+{
+    if (!ui->btn_Delete->isEnabled()) return; // 加载期间不能改数据
+
+    bool hasSelection = ui->tableView->selectionModel()->hasSelection();
+    bool hasRows = model->rowCount() > 0;
+
+    QMenu menu(this);
+    menu.addAction("删除选中行", this, [this]() { batchDelete(false); })->setEnabled(hasSelection);
+    menu.addAction("修改选中行的分类...", this, [this]() { batchRecategorize(false); })->setEnabled(hasSelection);
+    menu.addAction("平移选中行的日期...", this, [this]() { batchShiftDate(false); })->setEnabled(hasSelection);
+    menu.addSeparator();
+    QString all = QString("筛选结果全部 (%1 条)").arg(model->rowCount());
+    menu.addAction(all + "：删除", this, [this]() { batchDelete(true); })->setEnabled(hasRows);
+    menu.addAction(all + "：修改分类...", this, [this]() { batchRecategorize(true); })->setEnabled(hasRows);
+    menu.addAction(all + "：平移日期...", this, [this]() { batchShiftDate(true); })->setEnabled(hasRows);
+    menu.exec(ui->tableView->viewport()->mapToGlobal(pos));
 }
 
 void MainWindow::on_filterTypeChanged(int index)
@@ -340,24 +713,9 @@ void MainWindow::on_filterTypeChanged(int index)
 
 void MainWindow::initModelView()
 {
-    // 初始化模型
-    model = new QSqlRelationalTableModel(this);
-    model->setTable("record");
-
-    // 设置外键关系
-    model->setRelation(4, QSqlRelation("category", "id", "name"));
-
-    // 设置编辑策略为：字段值变化时立即提交
-    model->setEditStrategy(QSqlTableModel::OnFieldChange);
-
-    // 加载数据
-    model->select();
-
-    // 设置表头名称
-    model->setHeaderData(1, Qt::Horizontal, "金额");
-    model->setHeaderData(2, Qt::Horizontal, "时间");
-    model->setHeaderData(3, Qt::Horizontal, "备注");
-    model->setHeaderData(4, Qt::Horizontal, "分类");
+    // 初始化模型 (分窗口按需加载，编辑即时写库)
+    // 数据在数据库打开后才取 (见 finishStartup)
+    model = new RecordTableModel(this);
 
     // 绑定模型到视图
     ui->tableView->setModel(model);
@@ -372,10 +730,12 @@ void MainWindow::initModelView()
     // 应用代理 (Delegate)
     ui->tableView->setItemDelegateForColumn(1, new AmountDelegate(ui->tableView));
     ui->tableView->setItemDelegateForColumn(2, new TimeDelegate(ui->tableView));
-    ui->tableView->setItemDelegateForColumn(4, new QSqlRelationalDelegate(ui->tableView));
+    ui->tableView->setItemDelegateForColumn(4, new CategoryDelegate(ui->tableView));
 
     // 开启左侧行号
+    // 固定行高：行数很多时视图不必逐行计算高度
     ui->tableView->verticalHeader()->setVisible(true);
+    ui->tableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     ui->tableView->verticalHeader()->setDefaultSectionSize(30);
 
     // 调整列宽策略
@@ -400,11 +760,25 @@ void MainWindow::initModelView()
         "QTableView QComboBox { background-color: white; color: black; }"
         );
 
-    // 当表格数据发生变化（用户编辑）时，重新画图
-    connect(model, &QSqlTableModel::dataChanged, this, [this](){
-        updateCharts();
+    // 右键菜单：对选中行或整个筛选结果做批量操作
+    ui->tableView->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->tableView, &QWidget::customContextMenuRequested, this, &MainWindow::showTableMenu);
 
-        updateSummary();
+    // 表格编辑先进延迟写入队列，每次写入数据库 (汇总缓存随之同步) 后重新画一次图
+    EditQueue &edits = DatabaseManager::instance().edits();
+    connect(&edits, &EditQueue::flushed, this, [this]() {
+        refreshAggregates();
+    });
+    // 写不进去而被丢掉的编辑：重新读表格，显示数据库里的值 (排队执行，不在 flush() 里重入)
+    connect(&edits, &EditQueue::rejected, this, [this](qint64 id) {
+        statusBar()->showMessage(QString("记录 %1 的修改无法保存，已撤销").arg(id), 10000);
+        model->select();
+    }, Qt::QueuedConnection);
+    // 切到别的程序时立即写入，不等定时器
+    connect(qApp, &QGuiApplication::applicationStateChanged, this, [](Qt::ApplicationState state) {
+        if (state != Qt::ApplicationActive) {
+            DatabaseManager::instance().edits().flush();
+        }
     });
 }
 
@@ -423,232 +797,214 @@ void MainWindow::initCharts()
     pieChart->setAnimationOptions(QChart::SeriesAnimations);
     ui->chartView_Pie->setChart(pieChart);
     ui->chartView_Pie->setRenderHint(QPainter::Antialiasing);
+
+    // 系列与坐标轴在这里一次建好，之后的刷新只改数据
+    chartUpdater = new ChartUpdater(pieChart, barChart, this);
+
+    // 趋势粒度：默认按筛选范围自动选择，切换时只重算趋势
+    ui->comboBox_TrendGranularity->addItem("自动", int(TrendGranularity::Auto));
+    ui->comboBox_TrendGranularity->addItem("按日", int(TrendGranularity::Day));
+    ui->comboBox_TrendGranularity->addItem("按周", int(TrendGranularity::Week));
+    ui->comboBox_TrendGranularity->addItem("按月", int(TrendGranularity::Month));
+    ui->comboBox_TrendGranularity->addItem("按年", int(TrendGranularity::Year));
+    connect(ui->comboBox_TrendGranularity, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::refreshTrend);
 }
 
-void MainWindow::updateCharts()
+void MainWindow::refreshAggregates()
 {
-    // 获取通用的筛选条件
-    QString filterSql = getFilterSql();
-
-    // 更新饼图 (按分类汇总金额)
-    pieChart->removeAllSeries();
-    QPieSeries *pieSeries = new QPieSeries();
-
-    QSqlQuery query;
-    // 构建查询语句
-    QString pieSql = "SELECT c.name, SUM(r.amount) FROM record r "
-                     "JOIN category c ON r.cid = c.id "
-                     "WHERE 1=1 " + filterSql +
-                     " GROUP BY c.name "
-                     "ORDER BY SUM(r.amount) DESC";
-
-    if(query.exec(pieSql)) {
-        while(query.next()) {
-            QString name = query.value(0).toString();
-            double value = query.value(1).toDouble();
-            if(value > 0) {
-                pieSeries->append(name, value);
-            }
-        }
+    if (!chartUpdater) return; // 启动尚未完成，图表还没建
+
+    const RecordFilter filter = currentFilter();
+    const quint64 ticket = m_aggregateRequests.next(); // 之前尚未完成的刷新全部作废
+    refreshTrend();
+
+    // 按天汇总缓存能回答时直接在界面线程取快照 (微秒级)
+    RollupCache &rollup = DatabaseManager::instance().rollup();
+    if (rollup.isReady() && RollupCache::canAnswer(filter)) {
+        AggregateSnapshotPtr snapshot = rollup.snapshot(filter);
+        chartUpdater->updatePie(*snapshot);
+        updateSummary(*snapshot);
+        return;
     }
 
-    // 设置饼图标签可见
-    for(auto slice : pieSeries->slices()) {
-        // 获取该切片的百分比 (0.0 ~ 1.0)
-        double percent = slice->percentage();
-
-        // 设置标签格式
-        QString label = QString("%1: %2%").arg(slice->label()).arg(QString::number(percent * 100, 'f', 1));
-        slice->setLabel(label);
-
-        // 只有占比大于 3% 的才默认显示标签，防止重叠
-        if (percent < 0.03) {
-            slice->setLabelVisible(false);
-        } else {
-            slice->setLabelVisible(true);
-            slice->setLabelPosition(QPieSlice::LabelOutside); // 标签放外面
-        }
-
-        // 添加鼠标悬停交互 (Hover)
-        // 当鼠标滑过任何切片（包括那些隐藏标签的小切片）时，突出显示并强制展示标签
-        connect(slice, &QPieSlice::hovered, this, [slice, percent](bool state){
-            // 鼠标移入(state=true)时炸开(Exploded)，移出复原
-            slice->setExploded(state);
-
-            // 鼠标移入时强制显示标签，移出时恢复默认逻辑(大于3%才显)
-            if (state) {
-                slice->setLabelVisible(true);
-            } else {
-                slice->setLabelVisible(percent >= 0.03);
-            }
+    // 其余情况 (备注搜索) 交给数据库线程，算完再回到界面线程刷新
+    // 仍在执行的上一次汇总会被中断，排队中的直接跳过
+    QFuture<AggregateSnapshotPtr> future = DatabaseManager::instance().runLatestOnWorker(
+        m_aggregateRequests, ticket, [filter](QSqlDatabase &db) {
+            return AggregationService::computeSql(filter, db);
         });
-    }
-
-    // 设置图例 (Legend)
-    // 对于隐藏了标签的小切片，用户可以通过右侧图例看颜色对应
-    pieChart->legend()->setVisible(true);
-    pieChart->legend()->setAlignment(Qt::AlignRight); // 图例放右边
-    pieChart->addSeries(pieSeries);
-
-
-    // 更新柱状图 (按收支类型汇总)
-    barChart->removeAllSeries();
-    // 清除旧坐标轴 (防止多次刷新后坐标轴残留)
-    QList<QAbstractAxis*> axes = barChart->axes();
-    for(auto axis : axes) barChart->removeAxis(axis);
-
-    QBarSeries *barSeries = new QBarSeries();
-    QBarSet *setIncome = new QBarSet("收入");
-    QBarSet *setExpense = new QBarSet("支出");
-
-    // 查询总收入和总支出
-    double totalIncome = 0;
-    double totalExpense = 0;
-
-    // 查经过筛选后的总收入
-    // 逻辑：基础筛选条件 + (类型必须是收入)
-    QString incomeSql = "SELECT SUM(r.amount) FROM record r JOIN category c ON r.cid = c.id "
-                        "WHERE c.type = 1 " + filterSql;
-    if(query.exec(incomeSql) && query.next()) totalIncome = query.value(0).toDouble();
-
-    // 查经过筛选后的总支出
-    // 逻辑：基础筛选条件 + (类型必须是支出)
-    QString expenseSql = "SELECT SUM(r.amount) FROM record r JOIN category c ON r.cid = c.id "
-                         "WHERE c.type = 0 " + filterSql;
-    if(query.exec(expenseSql) && query.next()) totalExpense = query.value(0).toDouble();
-
-    *setIncome << totalIncome;
-    *setExpense << totalExpense;
-
-    // 设置颜色
-    setIncome->setColor(QColor(60, 179, 113)); // MediumSeaGreen
-    setExpense->setColor(QColor(220, 20, 60)); // Crimson
-
-    barSeries->append(setIncome);
-    barSeries->append(setExpense);
 
-    // 显示数值标签 (在柱子上显示数字)
-    barSeries->setLabelsVisible(true);
-
-    barChart->addSeries(barSeries);
+    future.then(this, [this, ticket](AggregateSnapshotPtr snapshot) {
+        if (!snapshot || !m_aggregateRequests.isCurrent(ticket)) return;
+        chartUpdater->updatePie(*snapshot);
+        updateSummary(*snapshot);
+    });
+}
 
-    // 创建坐标轴
-    QStringList categories; categories << "总计";
-    QBarCategoryAxis *axisX = new QBarCategoryAxis();
-    axisX->append(categories);
-    barChart->addAxis(axisX, Qt::AlignBottom);
-    barSeries->attachAxis(axisX);
+void MainWindow::refreshTrend()
+{
+    const RecordFilter filter = currentFilter();
+    const auto granularity = TrendGranularity(ui->comboBox_TrendGranularity->currentData().toInt());
+    const quint64 ticket = m_trendRequests.next();
+
+    // 与汇总相同：缓存能回答时在界面线程直接算 (十年按天也只是几万次加法)
+    RollupCache &rollup = DatabaseManager::instance().rollup();
+    if (rollup.isReady() && RollupCache::canAnswer(filter)) {
+        chartUpdater->updateTrend(*TrendEngine::computeRollup(rollup, filter, granularity));
+        return;
+    }
 
-    QValueAxis *axisY = new QValueAxis();
-    barChart->addAxis(axisY, Qt::AlignLeft);
-    // 让Y轴稍微高一点，避免柱子顶到头
-    double maxVal = qMax(totalIncome, totalExpense);
-    axisY->setRange(0, maxVal == 0 ? 100 : maxVal * 1.2);
-    // 设置Y轴标签格式 (不显示小数)
-    axisY->setLabelFormat("%.0f");
+    QFuture<TrendSeriesPtr> future = DatabaseManager::instance().runLatestOnWorker(
+        m_trendRequests, ticket, [filter, granularity](QSqlDatabase &db) {
+            return TrendEngine::computeSql(filter, granularity, db);
+        });
 
-    barSeries->attachAxis(axisY);
+    future.then(this, [this, ticket](TrendSeriesPtr series) {
+        if (!series || !m_trendRequests.isCurrent(ticket)) return;
+        chartUpdater->updateTrend(*series);
+    });
 }
 
 void MainWindow::loadFilterCategories(int type)
 {
+    // 分类列表变化时尽量保留当前选中的分类
+    int selectedId = ui->comboBox_FilterCategory->currentData().isValid()
+                         ? ui->comboBox_FilterCategory->currentData().toInt() : -1;
     ui->comboBox_FilterCategory->clear();
     ui->comboBox_FilterCategory->addItem("全部", -1); // 默认项
 
-    QSqlQuery query = DatabaseManager::instance().getCategories(type);
-    while (query.next()) {
-        ui->comboBox_FilterCategory->addItem(query.value("name").toString(), query.value("id").toInt());
+    for (const CategoryInfo &category : DatabaseManager::instance().categories().categories(type)) {
+        ui->comboBox_FilterCategory->addItem(category.name, category.id);
     }
+    ui->comboBox_FilterCategory->setCurrentIndex(qMax(0, ui->comboBox_FilterCategory->findData(selectedId)));
 }
 
-void MainWindow::updateSummary()
+void MainWindow::updateSummary(const AggregateSnapshot &snapshot)
 {
-    // 获取通用的筛选条件
-    QString filterSql = getFilterSql();
+    // 更新 UI (整数分直接格式化，不经过浮点)
+    ui->lbl_TotalIncome->setText(Money::toString(snapshot.totalIncomeCents()));
+    ui->lbl_TotalExpense->setText(Money::toString(snapshot.totalExpenseCents()));
 
-    QSqlQuery query;
-    double totalIncome = 0.0;
-    double totalExpense = 0.0;
+    qint64 balance = snapshot.balanceCents();
+    ui->lbl_TotalBalance->setText(Money::toString(balance));
 
-    // 计算总收入
-    // 叠加条件：c.type = 1 (收入)
-    QString incomeSql = "SELECT SUM(r.amount) FROM record r JOIN category c ON r.cid = c.id "
-                        "WHERE c.type = 1 " + filterSql;
-
-    if (query.exec(incomeSql) && query.next()) {
-        totalIncome = query.value(0).toDouble();
+    // 结余颜色：正数黑色，负数红色
+    if (balance >= 0) {
+        ui->lbl_TotalBalance->setStyleSheet("color: black; font-weight: bold; font-size: 14px;");
+    } else {
+        ui->lbl_TotalBalance->setStyleSheet("color: red; font-weight: bold; font-size: 14px;");
     }
+}
 
-    // 计算总支出
-    // 叠加条件：c.type = 0 (支出)
-    QString expenseSql = "SELECT SUM(r.amount) FROM record r JOIN category c ON r.cid = c.id "
-                         "WHERE c.type = 0 " + filterSql;
-
-    if (query.exec(expenseSql) && query.next()) {
-        totalExpense = query.value(0).toDouble();
+void MainWindow::updateBudget()
+{
+    BudgetTracker &budgets = DatabaseManager::instance().budgets();
+    if (!budgets.hasBudgets()) {
+        ui->lbl_Budget->setText("未设置");
+        ui->lbl_Budget->setToolTip("在“分类管理”里为支出分类设置月预算");
+        ui->lbl_Budget->setStyleSheet(QString());
+        return;
     }
 
-    // 更新 UI
-    ui->lbl_TotalIncome->setText(QString::number(totalIncome, 'f', 2));
-    ui->lbl_TotalExpense->setText(QString::number(totalExpense, 'f', 2));
+    const BudgetTracker::Status total = budgets.total();
+    ui->lbl_Budget->setText(QString("已用 %1 / 剩余 %2 / 预计 %3")
+                                .arg(Money::toString(total.spentCents), Money::toString(total.remainingCents()),
+                                     Money::toString(total.projectedCents)));
+    // 已超支为红色，按当前速度月底会超支为橙色
+    if (total.spentCents > total.budgetCents) {
+        ui->lbl_Budget->setStyleSheet("color: red; font-weight: bold;");
+    } else if (total.projectedCents > total.budgetCents) {
+        ui->lbl_Budget->setStyleSheet("color: rgb(200, 110, 0);");
+    } else {
+        ui->lbl_Budget->setStyleSheet(QString());
+    }
 
-    double balance = totalIncome - totalExpense;
-    ui->lbl_TotalBalance->setText(QString::number(balance, 'f', 2));
+    QStringList lines;
+    for (const BudgetTracker::Status &status : budgets.statuses()) {
+        lines << QString("%1：已用 %2 / 预算 %3，预计 %4")
+                     .arg(DatabaseManager::instance().categories().name(status.cid),
+                          Money::toString(status.spentCents), Money::toString(status.budgetCents),
+                          Money::toString(status.projectedCents));
+    }
+    ui->lbl_Budget->setToolTip(lines.join("\n"));
+}
 
-    // 结余颜色：正数黑色，负数红色
-    if (balance >= 0) {
-        ui->lbl_TotalBalance->setStyleSheet("color: black; font-weight: bold; font-size: 14px;");
+void MainWindow::showBudgetAlert(int cid, int percent, qint64 spentCents, qint64 budgetCents)
+{
+    const QString name = DatabaseManager::instance().categories().name(cid);
+    if (percent < 100) {
+        statusBar()->showMessage(QString("“%1”本月已用 %2，达到预算 %3 的 %4%")
+                                     .arg(name, Money::toString(spentCents), Money::toString(budgetCents))
+                                     .arg(percent), 10000);
     } else {
-        ui->lbl_TotalBalance->setStyleSheet("color: red; font-weight: bold; font-size: 14px;");
+        QMessageBox::warning(this, "超出预算", QString("“%1”本月已用 %2，超出预算 %3。")
+                                                 .arg(name, Money::toString(spentCents), Money::toString(budgetCents)));
     }
 }
 
-QString MainWindow::getFilterSql()
+RecordFilter MainWindow::currentFilter() const
 {
-    QString sql = "";
+    RecordFilter filter;
 
     // 日期筛选
-    qint64 startSec = QDateTime(ui->dateEdit_Start->date(), QTime(0,0)).toSecsSinceEpoch();
-    qint64 endSec = QDateTime(ui->dateEdit_End->date(), QTime(23,59,59)).toSecsSinceEpoch();
-    sql += QString(" AND r.timestamp >= %1 AND r.timestamp <= %2").arg(startSec).arg(endSec);
+    filter.startDate = ui->dateEdit_Start->date();
+    filter.endDate = ui->dateEdit_End->date();
 
     // 类型筛选 (全部 / 支出 / 收入)
-    int type = ui->comboBox_FilterType->currentData().toInt();
-    if (type != -1) {
-        // 注意：这里使用了 c.type，因为在查询时会 JOIN category c
-        sql += QString(" AND c.type = %1").arg(type);
-    }
+    filter.type = ui->comboBox_FilterType->currentData().toInt();
 
     // 分类筛选 (具体分类 ID)
-    int categoryId = ui->comboBox_FilterCategory->currentData().toInt();
-    if (categoryId != -1) {
-        sql += QString(" AND r.cid = %1").arg(categoryId);
-    }
+    filter.categoryId = ui->comboBox_FilterCategory->currentData().toInt();
 
     // 备注搜索 (模糊查询)
-    QString text = ui->lineEdit_Search->text().trimmed();
-    if (!text.isEmpty()) {
-        sql += QString(" AND r.note LIKE '%%1%'").arg(text);
-    }
+    filter.noteText = ui->lineEdit_Search->text().trimmed();
 
-    return sql;
+    return filter;
 }
 
 
+void MainWindow::on_actionRecurringRules_triggered()
+{
+    const QVector<RecurringRule> rules = DatabaseManager::instance().recurringRules();
+    if (rules.isEmpty()) {
+        QMessageBox::information(this, "重复账单", "还没有重复账单。\n新增账单时在“重复”里选择周期即可。");
+        return;
+    }
+
+    CategoryCache &categories = DatabaseManager::instance().categories();
+    QStringList items;
+    for (const RecurringRule &rule : rules) {
+        QString item = QString("%1 %2 %3 ￥%4，自 %5")
+                           .arg(rule.describe(), categories.name(rule.cid), rule.note.left(20),
+                                Money::toString(rule.cents), rule.start.date().toString("yyyy-MM-dd"));
+        if (rule.endDate.isValid()) item += " 至 " + rule.endDate.toString("yyyy-MM-dd");
+        items << item + QString("，已记 %1 笔").arg(rule.generated);
+    }
+    bool ok = false;
+    QString picked = QInputDialog::getItem(this, "重复账单", "选择要停止的重复账单:", items, 0, false, &ok);
+    if (!ok) return;
+
+    const RecurringRule &rule = rules[items.indexOf(picked)];
+    if (QMessageBox::question(this, "停止重复", "确定停止这项重复账单吗？已记入的账单不受影响。") != QMessageBox::Yes) {
+        return;
+    }
+    if (!DatabaseManager::instance().removeRecurringRule(rule.id)) {
+        QMessageBox::warning(this, "失败", "停止失败，请检查数据库。");
+        return;
+    }
+    statusBar()->showMessage("已停止重复账单：" + rule.describe() + " " + categories.name(rule.cid), 5000);
+}
+
 void MainWindow::on_actionManageCategory_triggered()
 {
     CategoryDialog dlg(this);
     dlg.exec(); // 模态显示
 
     // 当窗口关闭后，主界面可能需要刷新
-    // 刷新主界面的筛选下拉框（分类可能变了）
-    int currentType = ui->comboBox_FilterType->currentData().toInt();
-    loadFilterCategories(currentType);
-
+    // (筛选下拉框随分类缓存的变化通知自动刷新)
     // 刷新表格（如果用户删除了分类，表格里的记录会变化）
     model->select();
-    updateCharts();
-
-    updateSummary();
+    refreshAggregates();
 }
 
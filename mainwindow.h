@@ -2,8 +2,15 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QSqlRelationalTableModel>
 #include <QtCharts>
+#include "recordfilter.h"
+#include "aggregationservice.h"
+#include "recordtablemodel.h"
+#include "databasemanager.h"
+
+class FilterScheduler;
+class RecurringScheduler;
+class ChartUpdater;
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -22,6 +29,8 @@ public:
 private slots:
     void on_actionAddRecord_triggered();
 
+    void on_actionImport_triggered();
+
     void on_actionExport_triggered();
 
     void on_actionExit_triggered();
@@ -38,26 +47,63 @@ private slots:
 
     void on_actionManageCategory_triggered();
 
+    void on_actionRecurringRules_triggered();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
 private:
     Ui::MainWindow *ui;
 
-    QSqlRelationalTableModel *model; // 关系型表格模型
+    RecordTableModel *model; // 明细表格模型 (分窗口按需加载)
+
+    RequestSequence m_aggregateRequests; // 新的筛选作废尚未完成的汇总
+    RequestSequence m_trendRequests;     // 同上，收支趋势单独排队 (切换粒度时只重算趋势)
+    FilterScheduler *filterScheduler;    // 筛选控件变化的防抖与合并
+    RecurringScheduler *recurringScheduler; // 重复账单的补生成与定时生成
 
     // 图表对象
     QChart *barChart;
     QChart *pieChart;
+    ChartUpdater *chartUpdater = nullptr; // 图表的增量刷新 (系列、坐标轴只创建一次)
+
+    // 冷启动：窗口先画出来，打开数据库等放到之后
+    bool m_startupScheduled = false;
+    int m_startupPending = 0;   // 尚未完成的后台加载 (表格行数、汇总缓存)
+    int m_savedCategoryId = -1; // 上次选中的筛选分类，分类表读出来之后再选回
+    void finishStartup();
+    void startupStepDone();
+    void setLoading(bool loading); // 加载期间禁用会读写数据的操作
+
+    // 筛选条件的保存与恢复 (程序目录下的 finance.ini)
+    static QString settingsPath();
+    void restoreFilterSettings();
+    void saveFilterSettings() const;
 
     // 初始化函数
     void initModelView();
     void initCharts();
-    void updateCharts(); // 刷新图表数据
+    void refreshAggregates(); // 重新汇总并刷新图表与概览
+    void refreshTrend();      // 按当前筛选与粒度重算收支趋势
 
     // 辅助函数：加载主界面的筛选分类
     void loadFilterCategories(int type); // type: 0支出, 1收入, -1全部
 
-    void updateSummary();
-
-    // 辅助函数，用于生成通用的 SQL WHERE 子句
-    QString getFilterSql();
+    void updateSummary(const AggregateSnapshot &snapshot);
+    // 本月预算 (与筛选条件无关)：已用 / 剩余 / 按当前速度预计的月底花费，各分类明细放在提示里
+    void updateBudget();
+    void showBudgetAlert(int cid, int percent, qint64 spentCents, qint64 budgetCents);
+
+    // 批量操作 (右键菜单)：选中的行，或 allMatching 时当前筛选结果的全部记录
+    QList<int> selectedRows() const;
+    bool batchTarget(bool allMatching, const QString &question, QList<int> *rows); // 取操作对象并确认 (question 中 %1 为范围)
+    void batchDelete(bool allMatching);
+    void batchRecategorize(bool allMatching);
+    void batchShiftDate(bool allMatching);
+    void showTableMenu(const QPoint &pos);
+
+    // 辅助函数，读取界面上的通用筛选条件
+    RecordFilter currentFilter() const;
+    void applyFilter(); // 按当前筛选条件刷新表格、图表与概览
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,70 @@
+#include "money.h"
+
+bool Money::parse(const QString &text, qint64 *cents)
+{
+    bool negative = false;
+    bool seenSign = false;
+    bool seenDigit = false;
+    bool seenPoint = false;
+    int fractionDigits = 0;
+    bool roundUp = false;
+    quint64 value = 0;
+
+    for (QChar ch : text) {
+        if (ch == u'¥' || ch == u'￥' || ch == u',' || ch.isSpace()) continue;
+        if (ch == u'-' || ch == u'+') {
+            if (seenSign || seenDigit || seenPoint) return false;
+            seenSign = true;
+            negative = (ch == u'-');
+        } else if (ch == u'.') {
+            if (seenPoint) return false;
+            seenPoint = true;
+        } else if (ch >= u'0' && ch <= u'9') {
+            int digit = ch.unicode() - u'0';
+            seenDigit = true;
+            if (seenPoint && fractionDigits >= 2) {
+                // 第三位小数决定进位，其后的只需是数字
+                if (fractionDigits == 2) roundUp = digit >= 5;
+                ++fractionDigits;
+                continue;
+            }
+            if (value >= 1000000000000000ULL) return false; // 远超任何账目，也保证下面补位不溢出
+            value = value * 10 + quint64(digit);
+            if (seenPoint) ++fractionDigits;
+        } else {
+            return false;
+        }
+    }
+    if (!seenDigit) return false;
+
+    // 补齐到两位小数
+    for (int i = qMin(fractionDigits, 2); i < 2; ++i) value *= 10;
+    if (roundUp) ++value;
+
+    *cents = negative ? -qint64(value) : qint64(value);
+    return true;
+}
+
+void Money::append(QByteArray &out, qint64 cents)
+{
+    quint64 magnitude = cents < 0 ? quint64(0) - quint64(cents) : quint64(cents);
+    if (cents < 0) out += '-';
+    out += QByteArray::number(magnitude / 100);
+    out += '.';
+    out += char('0' + magnitude % 100 / 10);
+    out += char('0' + magnitude % 10);
+}
+
+QString Money::toString(qint64 cents)
+{
+    QByteArray text;
+    append(text, cents);
+    return QString::fromLatin1(text);
+}
+
+void Money::accumulate(qint64 *into, const qint64 *values, qsizetype count)
+{
+    for (qsizetype i = 0; i < count; ++i) {
+        into[i] = qint64(quint64(into[i]) + quint64(values[i]));
+    }
+}
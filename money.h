@@ -0,0 +1,32 @@
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <QByteArray>
+#include <QString>
+
+// 金额：以“分”为单位的 64 位整数
+// 数据库、汇总缓存、统计一律用整数分：加法满足结合律，无论求和顺序、分块方式、线程数如何，合计都逐分相同；
+// 只在显示、导出和画图时才换算成元
+namespace Money
+{
+    // 文本 -> 分："12.3"、"-0.05"、"1,234.50"、"￥12"、"+8" 均可；
+    // 忽略货币符号、千分位和空白，两位以后的小数四舍五入；无法解析或超出范围时返回 false
+    bool parse(const QString &text, qint64 *cents);
+
+    // 分 -> "1234.50" (负数带 "-")，导出与报表用，不经过浮点
+    QString toString(qint64 cents);
+    void append(QByteArray &out, qint64 cents);
+
+    // 换算成元，仅用于图表坐标等不要求逐分精确的场合
+    inline double toYuan(qint64 cents) { return cents / 100.0; }
+    // 元 (浮点) -> 分，四舍五入；用于旧数据与表格编辑器传回的数值
+    inline qint64 fromYuan(double yuan) { return qRound64(yuan * 100); }
+
+    // 整数逐项累加 into[i] += values[i] (汇总缓存合并按天序列、按天数组取区间时使用)
+    // 连续数组上无分支的循环，编译器可自动向量化 (SSE2/AVX2/NEON)；
+    // 内部按无符号数累加 (溢出时按 2^64 回绕，与求和顺序无关)，实际金额远不会溢出
+    // 按分类散列的合计 (ColumnarSnapshot::sumByCategory) 是逐行写不同的下标，不走这里
+    void accumulate(qint64 *into, const qint64 *values, qsizetype count);
+}
+
+#endif // MONEY_H
@@ -0,0 +1,307 @@
+#include "parallelaggregator.h"
+#include "columnarsnapshot.h"
+#include "databasemanager.h"
+#include "ledgerqueries.h"
+#include <QDateTime>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// 快照的一个分区至少这么多行，再小就不值得多开线程
+const qint64 kMinPartitionRows = 65536;
+
+// 一次汇总的全部只读参数：在调用线程上准备好，各分区共享
+struct Plan {
+    RecordFilter filter;        // 去掉了日期，时间范围由各月的边界给出
+    QVector<QDate> months;
+    QVector<qint64> bounds;     // months.size() + 1 个，第 i 月为 [bounds[i], bounds[i + 1])
+    int width = 0;              // 每月一行的格数 (最大分类ID + 1)
+    QVector<bool> included;     // 列式快照用：下标为分类ID，分类存在且符合类型/分类筛选
+};
+
+// 一个分区的部分结果，格子的排列与 Plan 一致 (months.size() × width)
+struct Partial {
+    QVector<PeriodTotal> cells;
+    bool ok = true;
+};
+
+void addValue(PeriodTotal &total, qint64 cents)
+{
+    if (total.count == 0) {
+        total.minCents = cents;
+        total.maxCents = cents;
+    } else {
+        total.minCents = qMin(total.minCents, cents);
+        total.maxCents = qMax(total.maxCents, cents);
+    }
+    total.cents += cents;
+    total.count += 1;
+}
+
+// 按本地日期切月：首尾两月截到 [from, to]
+void planMonths(qint64 from, qint64 to, Plan *plan)
+{
+    if (from > to) return;
+    const QDate last = QDateTime::fromSecsSinceEpoch(to).date();
+    QDate first = QDateTime::fromSecsSinceEpoch(from).date();
+    plan->bounds << from;
+    for (QDate month(first.year(), first.month(), 1); month <= last; month = month.addMonths(1)) {
+        if (!plan->months.isEmpty()) {
+            plan->bounds << QDateTime(month, QTime(0, 0)).toSecsSinceEpoch();
+        }
+        plan->months << month;
+    }
+    plan->bounds << to + 1;
+}
+
+// SQL：依次汇总给定的各月 (每月一条按分类分组的查询)
+Partial sumSql(const Plan &plan, const QVector<int> &monthIndexes, const QSqlDatabase &db)
+{
+    Partial partial;
+    partial.cells.resize(plan.months.size() * plan.width);
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    for (int month : monthIndexes) {
+        if (!query.exec(LedgerQueries::categoryRangeTotals(plan.filter, plan.bounds[month], plan.bounds[month + 1] - 1))) {
+            qDebug() << "Monthly report error:" << query.lastError().text();
+            partial.ok = false;
+            return partial;
+        }
+        while (query.next()) {
+            const int cid = query.value(0).toInt();
+            if (cid < 0 || cid >= plan.width) {
+                partial.ok = false; // 汇总期间另一个进程新建了分类
+                return partial;
+            }
+            PeriodTotal &total = partial.cells[month * plan.width + cid];
+            total.cents = query.value(1).toLongLong();
+            total.count = query.value(2).toLongLong();
+            total.minCents = query.value(3).toLongLong();
+            total.maxCents = query.value(4).toLongLong();
+        }
+    }
+    return partial;
+}
+
+// SQL 分区：在线程池线程上打开自己的只读连接 (连接不能跨线程)，用完即关
+Partial sumSqlPartition(const Plan &plan, const QVector<int> &monthIndexes, const QString &path,
+                        const QStringList &pragmas)
+{
+    const QString name = QString("finance_partition_%1").arg(quintptr(QThread::currentThreadId()));
+    Partial partial;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(path);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (db.open()) {
+            QSqlQuery query(db);
+            for (const QString &pragma : pragmas) {
+                query.exec(pragma);
+            }
+            partial = sumSql(plan, monthIndexes, db);
+            db.close();
+        } else {
+            qDebug() << "Error: partition connection failed" << db.lastError().text();
+            partial.ok = false;
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+    return partial;
+}
+
+// 列式快照：顺序扫描 [first, last) 行，行按时间有序，月份只会向后推进
+Partial sumColumns(const Plan &plan, const ColumnarSnapshot &columns, qint64 first, qint64 last)
+{
+    Partial partial;
+    partial.cells.resize(plan.months.size() * plan.width);
+    if (first >= last) return partial;
+
+    const qint64 *timestamps = columns.timestamps();
+    const qint64 *cents = columns.cents();
+    const qint32 *cids = columns.categoryIds();
+    int month = int(std::upper_bound(plan.bounds.begin(), plan.bounds.end(), timestamps[first])
+                    - plan.bounds.begin()) - 1;
+    qint64 monthEnd = plan.bounds[month + 1];
+    PeriodTotal *row = partial.cells.data() + month * plan.width;
+    for (qint64 i = first; i < last; ++i) {
+        while (timestamps[i] >= monthEnd) {
+            ++month;
+            monthEnd = plan.bounds[month + 1];
+            row += plan.width;
+        }
+        const qint32 cid = cids[i];
+        if (plan.included[cid]) {
+            addValue(row[cid], cents[i]);
+        }
+    }
+    return partial;
+}
+
+} // namespace
+
+void PeriodTotal::merge(const PeriodTotal &other)
+{
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    cents += other.cents;
+    count += other.count;
+    minCents = qMin(minCents, other.minCents);
+    maxCents = qMax(maxCents, other.maxCents);
+}
+
+bool PeriodTotal::operator==(const PeriodTotal &other) const
+{
+    if (count != other.count) return false;
+    return count == 0 || (cents == other.cents && minCents == other.minCents && maxCents == other.maxCents);
+}
+
+MonthlyReport::MonthlyReport(QVector<QDate> months, QVector<int> categoryIds, QVector<PeriodTotal> cells)
+    : m_months(std::move(months))
+    , m_categoryIds(std::move(categoryIds))
+    , m_cells(std::move(cells))
+{
+}
+
+bool MonthlyReport::operator==(const MonthlyReport &other) const
+{
+    return m_months == other.m_months && m_categoryIds == other.m_categoryIds && m_cells == other.m_cells;
+}
+
+MonthlyReportPtr ParallelAggregator::compute(const RecordFilter &filter, int partitions, Source source)
+{
+    DatabaseManager &manager = DatabaseManager::instance();
+    manager.edits().flush(); // 各分区用自己的连接读，先写入表格里尚未写入的编辑
+
+    const ColumnarSnapshot *columns = manager.columnarSnapshot();
+    bool useColumns = columns && RollupCache::canAnswer(filter);
+    if (source == Source::Columnar && !useColumns) return MonthlyReportPtr();
+    useColumns = useColumns && source != Source::Sql;
+
+    Plan plan;
+    plan.filter = filter;
+    plan.filter.startDate = QDate();
+    plan.filter.endDate = QDate();
+
+    // 不限日期的一端取数据实际覆盖的范围
+    QSqlDatabase db = QSqlDatabase::database();
+    qint64 dataFirst = 0;
+    qint64 dataLast = -1;
+    if (useColumns) {
+        if (columns->rowCount() > 0) {
+            dataFirst = columns->timestamps()[0];
+            dataLast = columns->timestamps()[columns->rowCount() - 1];
+        }
+        plan.width = columns->maxCategoryId() + 1;
+    } else {
+        QSqlQuery query(db);
+        if (query.exec("SELECT MIN(timestamp), MAX(timestamp) FROM record") && query.next() && !query.value(0).isNull()) {
+            dataFirst = query.value(0).toLongLong();
+            dataLast = query.value(1).toLongLong();
+        }
+        if (!query.exec("SELECT MAX(id) FROM category") || !query.next()) {
+            qDebug() << "Monthly report error:" << query.lastError().text();
+            return MonthlyReportPtr();
+        }
+        plan.width = query.value(0).toInt() + 1;
+    }
+    const bool bounded = filter.startDate.isValid() && filter.endDate.isValid();
+    if (bounded || dataFirst <= dataLast) {
+        planMonths(filter.startDate.isValid() ? filter.startSecs() : dataFirst,
+                   filter.endDate.isValid() ? filter.endSecs() : dataLast, &plan);
+    }
+    if (plan.months.isEmpty()) {
+        return MonthlyReportPtr(new MonthlyReport());
+    }
+
+    if (partitions <= 0) {
+        partitions = QThreadPool::globalInstance()->maxThreadCount();
+    }
+
+    QList<Partial> partials;
+    if (useColumns) {
+        // 类型、分类筛选在扫描前换成按分类ID查表 (分类已不存在的记录不计入，与 SQL 的 JOIN 一致)
+        const CategoryCache &categories = manager.categories();
+        plan.included.resize(plan.width);
+        for (int cid = 0; cid < plan.width; ++cid) {
+            const CategoryInfo *info = categories.find(cid);
+            plan.included[cid] = info && (filter.type == -1 || info->type == filter.type)
+                                 && (filter.categoryId == -1 || cid == filter.categoryId);
+        }
+
+        qint64 first = 0;
+        qint64 last = 0;
+        columns->rowsInRange(plan.bounds.first(), plan.bounds.last() - 1, &first, &last);
+        const qint64 rows = last - first;
+        partitions = int(qBound<qint64>(1, rows / kMinPartitionRows, partitions));
+        if (partitions == 1) {
+            partials << sumColumns(plan, *columns, first, last);
+        } else {
+            QList<int> indexes(partitions);
+            std::iota(indexes.begin(), indexes.end(), 0);
+            const Plan *shared = &plan;
+            partials = QtConcurrent::mapped(QThreadPool::globalInstance(), indexes,
+                                            [shared, columns, first, rows, partitions](int k) {
+                                                return sumColumns(*shared, *columns, first + rows * k / partitions,
+                                                                  first + rows * (k + 1) / partitions);
+                                            }).results();
+        }
+    } else {
+        // 月份轮流分给各分区：第 k 个分区算第 k、k + n、k + 2n … 个月
+        partitions = qBound(1, partitions, int(plan.months.size()));
+        QVector<QVector<int>> monthIndexes(partitions);
+        for (int month = 0; month < plan.months.size(); ++month) {
+            monthIndexes[month % partitions] << month;
+        }
+        if (partitions == 1) {
+            partials << sumSql(plan, monthIndexes[0], db);
+        } else {
+            // 各分区各自开读事务：期间另一个进程的写入可能只被部分分区看到 (本进程此时不会写入)
+            const QString path = manager.databasePath();
+            const QStringList pragmas = manager.storageProfile().connectionPragmas();
+            QList<int> indexes(partitions);
+            std::iota(indexes.begin(), indexes.end(), 0);
+            const Plan *shared = &plan;
+            const QVector<QVector<int>> *assigned = &monthIndexes;
+            partials = QtConcurrent::mapped(QThreadPool::globalInstance(), indexes,
+                                            [shared, assigned, path, pragmas](int k) {
+                                                return sumSqlPartition(*shared, assigned->at(k), path, pragmas);
+                                            }).results();
+        }
+    }
+
+    // 逐格合并，再只保留有记录的分类
+    QVector<PeriodTotal> merged(plan.months.size() * plan.width);
+    for (const Partial &partial : partials) {
+        if (!partial.ok) return MonthlyReportPtr();
+        for (qsizetype i = 0; i < merged.size(); ++i) {
+            merged[i].merge(partial.cells[i]);
+        }
+    }
+
+    QVector<int> categoryIds;
+    for (int cid = 0; cid < plan.width; ++cid) {
+        for (int month = 0; month < plan.months.size(); ++month) {
+            if (merged[month * plan.width + cid].count > 0) {
+                categoryIds << cid;
+                break;
+            }
+        }
+    }
+    QVector<PeriodTotal> cells;
+    cells.reserve(plan.months.size() * categoryIds.size());
+    for (int month = 0; month < plan.months.size(); ++month) {
+        for (int cid : categoryIds) {
+            cells << merged[month * plan.width + cid];
+        }
+    }
+    return MonthlyReportPtr(new MonthlyReport(plan.months, std::move(categoryIds), std::move(cells)));
+}
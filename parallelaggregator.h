@@ -0,0 +1,64 @@
+#ifndef PARALLELAGGREGATOR_H
+#define PARALLELAGGREGATOR_H
+
+#include <QDate>
+#include <QSharedPointer>
+#include <QVector>
+#include "recordfilter.h"
+
+// 某月某分类的合计
+struct PeriodTotal
+{
+    qint64 cents = 0;     // 金额合计 (分)
+    qint64 count = 0;     // 记录条数
+    qint64 minCents = 0;  // 单笔最小 / 最大金额 (count 为 0 时无意义)
+    qint64 maxCents = 0;
+
+    // 合并另一段的结果 (整数求和与取最值，与合并顺序无关)
+    void merge(const PeriodTotal &other);
+    bool operator==(const PeriodTotal &other) const;
+};
+
+// 按 (月, 分类) 的多年报表，构造后只读
+class MonthlyReport
+{
+public:
+    MonthlyReport() = default;
+    MonthlyReport(QVector<QDate> months, QVector<int> categoryIds, QVector<PeriodTotal> cells);
+
+    // 筛选范围覆盖的各月 (每月 1 号)，含没有记录的月份
+    const QVector<QDate> &months() const { return m_months; }
+    // 有记录的分类，ID 升序
+    const QVector<int> &categoryIds() const { return m_categoryIds; }
+    const PeriodTotal &at(int month, int category) const { return m_cells[month * m_categoryIds.size() + category]; }
+
+    bool operator==(const MonthlyReport &other) const;
+
+private:
+    QVector<QDate> m_months;
+    QVector<int> m_categoryIds;
+    QVector<PeriodTotal> m_cells; // 按月分行，每行依次为各分类
+};
+
+using MonthlyReportPtr = QSharedPointer<const MonthlyReport>;
+
+// 多年报表的并行汇总
+// 筛选范围按本地月份切开，分成若干分区放到全局线程池上同时算，各分区的部分结果最后逐格合并：
+//   SQL：每个分区打开自己的只读连接，按月执行走索引的分组查询 (月份轮流分给各分区，账本前疏后密时工作量也相近)
+//   列式快照：每个分区顺序扫描快照里连续的一段行 (按行数均分)，不经过 SQL
+// 结果只由整数求和与取最值得出，与分区数无关，与顺序执行 (partitions = 1) 完全一致
+class ParallelAggregator
+{
+public:
+    enum class Source {
+        Auto,     // 有与数据库一致的列式快照、且没有备注搜索时用快照，否则用 SQL
+        Sql,
+        Columnar  // 快照不可用时返回空指针
+    };
+
+    // 只在界面线程 (主线程) 调用，阻塞到全部分区算完；不要在全局线程池的任务里调用
+    // partitions 为 0 时取线程池的线程数；为 1 时在调用线程上用它的连接顺序执行，不开新连接
+    static MonthlyReportPtr compute(const RecordFilter &filter, int partitions = 0, Source source = Source::Auto);
+};
+
+#endif // PARALLELAGGREGATOR_H
@@ -0,0 +1,184 @@
+#include "recordexporter.h"
+#include "csvformat.h"
+#include "databasemanager.h"
+#include "ledgerqueries.h"
+#include "money.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSaveFile>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+
+// 写盘缓冲区大小：攒满一块再写，系统调用次数与行数无关
+const int kBufferBytes = 1 << 20;
+
+// 每隔多少行检查一次取消、汇报一次进度
+const int kProgressRows = 16384;
+
+struct CategoryInfo {
+    QByteArray name;
+    QByteArray type;
+};
+
+} // namespace
+
+RecordExporter::RecordExporter(QObject *parent)
+    : QObject(parent), m_cancel(false)
+{
+}
+
+RecordExporter::~RecordExporter()
+{
+    if (m_thread) {
+        cancel();
+        m_thread->wait();
+    }
+}
+
+void RecordExporter::start(const RecordFilter &filter, const QString &csvPath)
+{
+    if (m_thread) return;
+
+    m_cancel = false;
+    const QString databasePath = DatabaseManager::instance().databasePath();
+    m_thread = QThread::create([this, filter, csvPath, databasePath]() {
+        m_result = run(filter, csvPath, databasePath);
+    });
+    connect(m_thread, &QThread::finished, this, &RecordExporter::onThreadFinished);
+    m_thread->start();
+}
+
+void RecordExporter::cancel()
+{
+    m_cancel = true;
+}
+
+bool RecordExporter::isRunning() const
+{
+    return m_thread != nullptr;
+}
+
+void RecordExporter::onThreadFinished()
+{
+    m_thread->deleteLater();
+    m_thread = nullptr;
+    emit finished(m_result);
+}
+
+RecordExporter::Result RecordExporter::run(const RecordFilter &filter, const QString &csvPath,
+                                           const QString &databasePath)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+
+    QSaveFile file(csvPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        result.error = "无法创建文件：" + file.errorString();
+        return result;
+    }
+
+    static std::atomic_int connectionCounter(0);
+    const QString connectionName = QString("finance_export_%1").arg(++connectionCounter);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databasePath);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000;QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            result.error = "无法打开数据库：" + db.lastError().text();
+        } else {
+            // 分类表很小，先整张读入，记录按 cid 查表，不需要 JOIN
+            QHash<int, CategoryInfo> categories;
+            QSqlQuery query(db);
+            query.exec("SELECT id, name, type FROM category");
+            while (query.next()) {
+                CategoryInfo info;
+                info.name = query.value(1).toString().toUtf8();
+                info.type = query.value(2).toInt() == 1 ? QByteArray("收入") : QByteArray("支出");
+                categories.insert(query.value(0).toInt(), info);
+            }
+
+            // 总行数只用于进度显示
+            qint64 total = 0;
+            if (query.exec(LedgerQueries::recordCount(filter)) && query.next()) {
+                total = query.value(0).toLongLong();
+            }
+
+            query.setForwardOnly(true); // 只进游标：不缓存已读的行
+            if (!query.exec(LedgerQueries::exportRows(filter))) {
+                result.error = "查询失败：" + query.lastError().text();
+            } else {
+                QByteArray buffer;
+                buffer.reserve(kBufferBytes + 4096);
+                buffer += CsvFormat::exportHeader();
+
+                CsvFormat::TimeFormatter formatter;
+                int lastPercent = -1;
+                while (query.next()) {
+                    const CategoryInfo category = categories.value(query.value(4).toInt());
+
+                    buffer += QByteArray::number(query.value(0).toLongLong());
+                    buffer += ',';
+                    Money::append(buffer, query.value(1).toLongLong());
+                    buffer += ',';
+                    formatter.append(buffer, query.value(2).toLongLong());
+                    buffer += ',';
+                    CsvFormat::appendField(buffer, query.value(3).toString());
+                    buffer += ',';
+                    CsvFormat::appendField(buffer, category.name);
+                    buffer += ',';
+                    buffer += category.type;
+                    buffer += "\r\n";
+                    ++result.exported;
+
+                    if (buffer.size() >= kBufferBytes) {
+                        if (file.write(buffer) != buffer.size()) {
+                            result.error = "写入失败：" + file.errorString();
+                            break;
+                        }
+                        buffer.resize(0); // 保留已分配的容量
+                    }
+
+                    if (result.exported % kProgressRows == 0) {
+                        if (m_cancel) {
+                            result.cancelled = true;
+                            break;
+                        }
+                        int percent = total > 0 ? int(result.exported * 100 / total) : 0;
+                        if (percent != lastPercent) {
+                            lastPercent = percent;
+                            emit progress(percent, result.exported);
+                        }
+                    }
+                }
+
+                if (result.error.isEmpty() && !result.cancelled && file.write(buffer) != buffer.size()) {
+                    result.error = "写入失败：" + file.errorString();
+                }
+            }
+
+            query.finish();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!result.error.isEmpty() || result.cancelled) {
+        file.cancelWriting();
+        result.exported = 0;
+    } else if (!file.commit()) {
+        result.error = "保存文件失败：" + file.errorString();
+        result.exported = 0;
+    } else {
+        emit progress(100, result.exported);
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef RECORDEXPORTER_H
+#define RECORDEXPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include "recordfilter.h"
+
+class QThread;
+
+// 流式导出 CSV
+// 在后台线程用只进游标按时间顺序读取满足筛选条件的记录，逐行编码进一个大缓冲区，
+// 缓冲区满了再整块写盘：内存占用与导出行数无关
+// 输出符合 RFC 4180 (含逗号、引号、换行的字段加引号)，带 UTF-8 BOM 以便 Excel 识别中文
+// 写入先落到临时文件，完成后才替换目标文件；取消或出错时目标文件保持原样
+class RecordExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        qint64 exported = 0;
+        bool cancelled = false;
+        QString error;      // 非空表示失败
+        qint64 elapsedMs = 0;
+    };
+
+    explicit RecordExporter(QObject *parent = nullptr);
+    ~RecordExporter() override;
+
+    // 在后台线程导出 DatabaseManager 当前打开的数据库，结束时发出 finished
+    void start(const RecordFilter &filter, const QString &csvPath);
+    void cancel();
+    bool isRunning() const;
+
+    // 在当前线程同步导出 (基准测试、命令行使用)
+    Result run(const RecordFilter &filter, const QString &csvPath, const QString &databasePath);
+
+signals:
+    void progress(int percent, qint64 rowsExported);
+    void finished(const RecordExporter::Result &result);
+
+private:
+    void onThreadFinished();
+
+    std::atomic_bool m_cancel;
+    QThread *m_thread = nullptr;
+    Result m_result;
+};
+
+#endif // RECORDEXPORTER_H
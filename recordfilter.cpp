@@ -0,0 +1,195 @@
+#include "recordfilter.h"
+#include <QDateTime>
+
+namespace {
+
+bool g_noteIndexAvailable = false;
+
+// trigram 分词器只能索引三个字及以上的词 (更短的词 FTS5 会退化成扫描整个索引，不如直接 LIKE)
+const int kMinIndexedLength = 3;
+
+// LIKE 模式中的通配符按字面匹配 (配合 ESCAPE '\\')
+QString escapeLike(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("%", "\\%");
+    escaped.replace("_", "\\_");
+    return escaped;
+}
+
+// FTS5 短语：双引号括起，内部双引号加倍
+QString ftsPhrase(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace("\"", "\"\"");
+    return "\"" + escaped + "\"";
+}
+
+} // namespace
+
+qint64 RecordFilter::startSecs() const
+{
+    return QDateTime(startDate, QTime(0, 0)).toSecsSinceEpoch();
+}
+
+qint64 RecordFilter::endSecs() const
+{
+    return QDateTime(endDate, QTime(23, 59, 59)).toSecsSinceEpoch();
+}
+
+QString RecordFilter::toJoinedSql() const
+{
+    QString sql = "";
+
+    // 日期筛选
+    if (startDate.isValid()) {
+        sql += QString(" AND r.timestamp >= %1").arg(startSecs());
+    }
+    if (endDate.isValid()) {
+        sql += QString(" AND r.timestamp <= %1").arg(endSecs());
+    }
+
+    // 类型筛选 (全部 / 支出 / 收入)
+    // 注意：这里使用了 c.type，因为在查询时会 JOIN category c
+    if (type != -1) {
+        sql += QString(" AND c.type = %1").arg(type);
+    }
+
+    // 分类筛选 (具体分类 ID)
+    if (categoryId != -1) {
+        sql += QString(" AND r.cid = %1").arg(categoryId);
+    }
+
+    // 备注搜索 (全文索引 / 模糊查询)
+    sql += noteSql("r.note", "r.id");
+
+    return sql;
+}
+
+QString RecordFilter::toRecordSql() const
+{
+    QString sql = "1=1"; // 初始条件
+
+    if (startDate.isValid()) {
+        sql += QString(" AND timestamp >= %1").arg(startSecs());
+    }
+    if (endDate.isValid()) {
+        sql += QString(" AND timestamp <= %1").arg(endSecs());
+    }
+
+    // 没有 JOIN 时，类型通过子查询换成分类 ID 集合（可走 category(type, id) 索引）
+    if (type != -1) {
+        sql += QString(" AND cid IN (SELECT id FROM category WHERE type = %1)").arg(type);
+    }
+
+    if (categoryId != -1) {
+        sql += QString(" AND cid = %1").arg(categoryId);
+    }
+
+    sql += noteSql("note", "id");
+
+    return sql;
+}
+
+RecordSelection RecordSelection::byIds(const QList<qint64> &ids)
+{
+    RecordSelection selection;
+    selection.ids = ids;
+    return selection;
+}
+
+RecordSelection RecordSelection::byFilter(const RecordFilter &filter)
+{
+    RecordSelection selection;
+    selection.filter = filter;
+    selection.allMatching = true;
+    return selection;
+}
+
+QString RecordSelection::toRecordSql() const
+{
+    if (allMatching) {
+        return filter.toRecordSql();
+    }
+    if (ids.isEmpty()) {
+        return "0";
+    }
+
+    QString sql = "id IN (";
+    sql.reserve(sql.size() + ids.size() * 8);
+    for (int i = 0; i < ids.size(); ++i) {
+        if (i > 0) sql += ',';
+        sql += QString::number(ids[i]);
+    }
+    sql += ')';
+    return sql;
+}
+
+QString RecordFilter::quoted(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace("'", "''");
+    return "'" + escaped + "'";
+}
+
+void RecordFilter::setNoteIndexAvailable(bool available)
+{
+    g_noteIndexAvailable = available;
+}
+
+bool RecordFilter::noteIndexAvailable()
+{
+    return g_noteIndexAvailable;
+}
+
+QStringList RecordFilter::noteTerms(const QString &text)
+{
+    QStringList terms;
+    QString current;
+    bool inQuotes = false;
+
+    for (QChar ch : text) {
+        if (ch == '"') {
+            inQuotes = !inQuotes;
+        } else if (ch.isSpace() && !inQuotes) {
+            if (!current.isEmpty()) terms << current;
+            current.clear();
+        } else {
+            current += ch;
+        }
+    }
+    if (!current.isEmpty()) terms << current;
+    return terms;
+}
+
+QString RecordFilter::noteSql(const QString &noteColumn, const QString &idColumn) const
+{
+    QString sql;
+    QStringList indexed; // 交给全文索引的短语
+
+    for (QString term : noteTerms(noteText)) {
+        bool prefix = term.endsWith('*');
+        if (prefix) term.chop(1);
+        if (term.isEmpty()) continue;
+
+        bool useIndex = g_noteIndexAvailable && term.size() >= kMinIndexedLength;
+        if (useIndex) {
+            indexed << ftsPhrase(term);
+        }
+
+        // 前缀词在索引筛出的候选行上再确认位置；不走索引的词直接 LIKE
+        if (prefix) {
+            sql += QString(" AND %1 LIKE %2 ESCAPE '\\'").arg(noteColumn, quoted(escapeLike(term) + "%"));
+        } else if (!useIndex) {
+            sql += QString(" AND %1 LIKE %2 ESCAPE '\\'").arg(noteColumn, quoted("%" + escapeLike(term) + "%"));
+        }
+    }
+
+    if (!indexed.isEmpty()) {
+        // 子查询只读 FTS 索引，再按 rowid 回到 record
+        sql = QString(" AND %1 IN (SELECT rowid FROM record_fts WHERE record_fts MATCH %2)")
+                  .arg(idColumn, quoted(indexed.join(" AND "))) + sql;
+    }
+    return sql;
+}
@@ -0,0 +1,65 @@
+#ifndef RECORDFILTER_H
+#define RECORDFILTER_H
+
+#include <QDate>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// 账单筛选条件
+// 主界面、图表、概览共用同一份条件，统一在这里拼出 SQL，避免各处各写一套
+struct RecordFilter
+{
+    QDate startDate;        // 起始日期 (无效日期表示不限)
+    QDate endDate;          // 结束日期 (无效日期表示不限)
+    int type = -1;          // 收支类型：0支出, 1收入, -1全部
+    int categoryId = -1;    // 具体分类ID，-1 表示全部
+    QString noteText;       // 备注关键词，空表示不搜索 (语法见 noteTerms)
+
+    // 起止日期对应的 Unix 时间戳 (秒)，起始取当天 00:00:00，结束取当天 23:59:59
+    qint64 startSecs() const;
+    qint64 endSecs() const;
+
+    // 生成以 " AND ..." 开头的条件片段
+    // 用于 "record r JOIN category c" 形式的查询，字段带 r. / c. 前缀
+    QString toJoinedSql() const;
+
+    // 生成不依赖 JOIN 的条件（用于直接查询 record 表），空条件返回 "1=1"
+    QString toRecordSql() const;
+
+    // 把文本转义成 SQL 字符串字面量 (单引号加倍)
+    static QString quoted(const QString &text);
+
+    // 备注关键词拆分：空白分隔的多个词须同时出现；
+    // 双引号括起的部分是一个整体 (可含空格)；以 * 结尾的词表示备注以它开头
+    static QStringList noteTerms(const QString &text);
+
+    // 备注全文索引 (FTS5 trigram) 是否可用，由 DatabaseManager 在打开数据库后设置
+    // 可用时三个字及以上的词走索引，更短的词 (trigram 无法索引) 仍用 LIKE：
+    // 与长词同时出现时只在索引筛出的候选行上比对；单独的短词 (如“午饭”) 要逐条比对筛选范围内的备注，
+    // 耗时与范围内的记录数成正比，界面的搜索框提示里有说明
+    static void setNoteIndexAvailable(bool available);
+    static bool noteIndexAvailable();
+
+private:
+    // 备注条件片段 (以 " AND ..." 开头)，noteColumn / idColumn 为带或不带前缀的列名
+    QString noteSql(const QString &noteColumn, const QString &idColumn) const;
+};
+
+// 批量操作的对象：选中的若干条记录 (ids)，或满足筛选条件的全部记录 (allMatching 为真时，ids 不用)
+struct RecordSelection
+{
+    QList<qint64> ids;
+    RecordFilter filter;
+    bool allMatching = false;
+
+    static RecordSelection byIds(const QList<qint64> &ids);
+    static RecordSelection byFilter(const RecordFilter &filter);
+
+    bool isEmpty() const { return !allMatching && ids.isEmpty(); }
+
+    // 直接查询 record 表时的条件：ID 直接写成 IN 列表 (整数，无需转义)，筛选条件同 toRecordSql()
+    QString toRecordSql() const;
+};
+
+#endif // RECORDFILTER_H
@@ -0,0 +1,412 @@
+#include "recordimporter.h"
+#include "csvformat.h"
+#include "money.h"
+#include "rollupcache.h"
+#include "databasemanager.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QtConcurrent>
+#include <QDebug>
+#include <atomic>
+#include <cstring>
+
+namespace {
+
+// 每个解析块的大小；块越大调度开销越小，但首块返回前写入线程只能等待
+const qint64 kChunkBytes = 1 << 20;
+
+// 多行 VALUES 每批的行数 (4 个参数/行，远低于 SQLite 999 个参数的上限)
+const int kBatchRows = 64;
+
+// 解析并完成列映射后的一行
+struct ParsedRow {
+    qint64 timestamp = 0;
+    qint64 cents = 0;     // 金额 (分)
+    int type = -1;        // 0 支出，1 收入，-1 未知 (由分类决定)
+    QString note;
+    QString category;
+};
+
+struct ParsedChunk {
+    QVector<ParsedRow> rows;
+    qint64 skipped = 0;
+};
+
+// 银行流水常见的时间格式，按出现频率排列
+const QStringList &dateFormats()
+{
+    static const QStringList formats = {
+        "yyyy-MM-dd HH:mm:ss", "yyyy-MM-dd HH:mm", "yyyy-MM-dd",
+        "yyyy/MM/dd HH:mm:ss", "yyyy/MM/dd HH:mm", "yyyy/MM/dd",
+        "yyyy/M/d H:mm:ss", "yyyy/M/d H:mm", "yyyy/M/d",
+        "yyyyMMdd HH:mm:ss", "yyyyMMdd",
+        "yyyy年M月d日 HH:mm", "yyyy年M月d日"
+    };
+    return formats;
+}
+
+// 同一文件的时间格式通常一致：记住上次成功的格式，优先尝试
+bool parseTimestamp(const QString &text, int *lastFormat, qint64 *timestamp)
+{
+    QString value = text.trimmed();
+    if (value.isEmpty()) return false;
+
+    // 纯数字且不是 yyyyMMdd：视为 Unix 时间戳 (秒)
+    bool isNumber = false;
+    qint64 secs = value.toLongLong(&isNumber);
+    if (isNumber && value.size() != 8) {
+        *timestamp = secs;
+        return true;
+    }
+
+    const QStringList &formats = dateFormats();
+    for (int i = -1; i < formats.size(); ++i) {
+        int index = (i < 0) ? *lastFormat : i;
+        if (index < 0 || (i >= 0 && i == *lastFormat)) continue;
+
+        QDateTime dt = QDateTime::fromString(value, formats[index]);
+        if (dt.isValid()) {
+            *lastFormat = index;
+            *timestamp = dt.toSecsSinceEpoch();
+            return true;
+        }
+    }
+    return false;
+}
+
+int parseType(const QString &text)
+{
+    static const QStringList income = {"收入", "入账", "收", "income", "in", "1"};
+    static const QStringList expense = {"支出", "出账", "支", "expense", "out", "0"};
+
+    QString value = text.trimmed().toLower();
+    if (income.contains(value)) return 1;
+    if (expense.contains(value)) return 0;
+    return -1;
+}
+
+ParsedChunk parseChunk(const char *data, QPair<qint64, qint64> range, const ImportMapping &mapping)
+{
+    ParsedChunk chunk;
+    int lastFormat = -1;
+
+    const QList<QStringList> records = CsvFormat::parseRecords(data + range.first, data + range.second);
+    chunk.rows.reserve(records.size());
+
+    for (const QStringList &fields : records) {
+        ParsedRow row;
+        if (!parseTimestamp(fields.value(mapping.dateColumn), &lastFormat, &row.timestamp)
+            || !Money::parse(fields.value(mapping.amountColumn), &row.cents)) {
+            ++chunk.skipped;
+            continue;
+        }
+
+        if (mapping.typeColumn >= 0) {
+            row.type = parseType(fields.value(mapping.typeColumn));
+        }
+        // 负数表示支出
+        if (row.cents < 0) {
+            row.cents = -row.cents;
+            row.type = 0;
+        }
+        if (mapping.noteColumn >= 0) {
+            row.note = fields.value(mapping.noteColumn).trimmed();
+        }
+        if (mapping.categoryColumn >= 0) {
+            row.category = fields.value(mapping.categoryColumn).trimmed();
+        }
+        chunk.rows.append(row);
+    }
+    return chunk;
+}
+
+QString batchInsertSql(int rows)
+{
+    QString sql = "INSERT INTO record (amount_cents, timestamp, note, cid) VALUES ";
+    for (int i = 0; i < rows; ++i) {
+        sql += (i == 0) ? "(?, ?, ?, ?)" : ", (?, ?, ?, ?)";
+    }
+    return sql;
+}
+
+} // namespace
+
+ImportMapping ImportMapping::fromHeader(const QStringList &header)
+{
+    static const QStringList dateNames = {"时间", "日期", "交易时间", "交易日期", "date", "time", "timestamp"};
+    static const QStringList amountNames = {"金额", "交易金额", "金额(元)", "amount"};
+    static const QStringList noteNames = {"备注", "摘要", "说明", "交易说明", "note", "description", "memo"};
+    static const QStringList categoryNames = {"分类", "类别", "category"};
+    static const QStringList typeNames = {"类型", "收支", "收/支", "收支类型", "type"};
+
+    ImportMapping mapping;
+    for (int i = 0; i < header.size(); ++i) {
+        QString name = header[i].trimmed().toLower();
+        if (mapping.dateColumn < 0 && dateNames.contains(name))              mapping.dateColumn = i;
+        else if (mapping.amountColumn < 0 && amountNames.contains(name))     mapping.amountColumn = i;
+        else if (mapping.noteColumn < 0 && noteNames.contains(name))         mapping.noteColumn = i;
+        else if (mapping.categoryColumn < 0 && categoryNames.contains(name)) mapping.categoryColumn = i;
+        else if (mapping.typeColumn < 0 && typeNames.contains(name))         mapping.typeColumn = i;
+    }
+    return mapping;
+}
+
+RecordImporter::RecordImporter(QObject *parent)
+    : QObject(parent), m_cancel(false)
+{
+}
+
+RecordImporter::~RecordImporter()
+{
+    if (m_thread) {
+        cancel();
+        m_thread->wait();
+    }
+}
+
+void RecordImporter::start(const QString &csvPath)
+{
+    if (m_thread) return;
+
+    m_cancel = false;
+    const QString databasePath = DatabaseManager::instance().databasePath();
+    m_thread = QThread::create([this, csvPath, databasePath]() {
+        m_result = run(csvPath, databasePath);
+    });
+    connect(m_thread, &QThread::finished, this, &RecordImporter::onThreadFinished);
+    m_thread->start();
+}
+
+void RecordImporter::cancel()
+{
+    m_cancel = true;
+}
+
+bool RecordImporter::isRunning() const
+{
+    return m_thread != nullptr;
+}
+
+void RecordImporter::onThreadFinished()
+{
+    m_thread->deleteLater();
+    m_thread = nullptr;
+
+    // 缓存只在界面线程读写，导入线程只负责收集增量
+    if (m_result.error.isEmpty() && !m_result.cancelled) {
+        applyToRollup(DatabaseManager::instance().rollup());
+        BudgetTracker &budgets = DatabaseManager::instance().budgets();
+        for (auto it = m_dailyTotals.constBegin(); it != m_dailyTotals.constEnd(); ++it) {
+            budgets.addDailyTotal(it.key().first, it.key().second, it.value().cents);
+        }
+        budgets.settle();
+        for (const NewCategory &category : m_newCategories) {
+            DatabaseManager::instance().categories().add(category.id, category.name, category.type);
+        }
+    }
+    emit finished(m_result);
+}
+
+void RecordImporter::applyToRollup(RollupCache &rollup) const
+{
+    for (const NewCategory &category : m_newCategories) {
+        rollup.addCategory(category.id, category.name, category.type);
+    }
+    for (auto it = m_dailyTotals.constBegin(); it != m_dailyTotals.constEnd(); ++it) {
+        rollup.addDailyTotal(it.key().first, it.key().second, it.value().cents, it.value().count);
+    }
+}
+
+RecordImporter::Result RecordImporter::run(const QString &csvPath, const QString &databasePath)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+    m_newCategories.clear();
+    m_dailyTotals.clear();
+
+    QFile file(csvPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = "无法打开文件：" + file.errorString();
+        return result;
+    }
+
+    // 整个文件映射到内存，各解析线程直接读取，不做额外拷贝
+    const qint64 size = file.size();
+    const char *data = size > 0 ? reinterpret_cast<const char *>(file.map(0, size)) : nullptr;
+    if (!data) {
+        result.error = "文件为空或无法读取";
+        return result;
+    }
+
+    // 跳过 UTF-8 BOM (Excel 另存的 CSV 常带)
+    qint64 offset = 0;
+    if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        offset = 3;
+    }
+
+    QStringList header;
+    offset += CsvFormat::parseFirstRecord(data + offset, size - offset, &header);
+    const ImportMapping mapping = ImportMapping::fromHeader(header);
+    if (!mapping.isValid()) {
+        result.error = "无法识别表头，至少需要“时间”和“金额”两列";
+        return result;
+    }
+
+    // 第 1 段：按记录边界切块，在线程池上并行解析
+    QList<QPair<qint64, qint64>> chunks = CsvFormat::splitChunks(data + offset, size - offset, kChunkBytes);
+    for (auto &chunk : chunks) {
+        chunk.first += offset;
+        chunk.second += offset;
+    }
+    QFuture<ParsedChunk> parsed = QtConcurrent::mapped(chunks, [data, mapping](const QPair<qint64, qint64> &range) {
+        return parseChunk(data, range, mapping);
+    });
+
+    // 第 2、3 段在本线程按块顺序进行，使用独立连接，不占用界面线程的连接
+    static std::atomic_int connectionCounter(0);
+    const QString connectionName = QString("finance_import_%1").arg(++connectionCounter);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databasePath);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            parsed.cancel();
+            parsed.waitForFinished();
+            result.error = "无法打开数据库：" + db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.exec("PRAGMA foreign_keys = ON");
+
+            // 已有分类：(名称, 类型) -> ID；名称 -> 第一次见到的类型 (CSV 未给出收支时使用)
+            QHash<QPair<QString, int>, int> categoryIds;
+            QHash<QString, int> categoryTypes;
+            query.exec("SELECT id, name, type FROM category ORDER BY id");
+            while (query.next()) {
+                QString name = query.value(1).toString();
+                int type = query.value(2).toInt();
+                categoryIds.insert(qMakePair(name, type), query.value(0).toInt());
+                if (!categoryTypes.contains(name)) categoryTypes.insert(name, type);
+            }
+
+            QSqlQuery batchInsert(db);
+            QSqlQuery singleInsert(db);
+            QSqlQuery categoryInsert(db);
+            batchInsert.prepare(batchInsertSql(kBatchRows));
+            singleInsert.prepare(batchInsertSql(1));
+            categoryInsert.prepare("INSERT INTO category (name, type) VALUES (?, ?)");
+
+            db.transaction();
+
+            QVector<ParsedRow> pending;   // 已映射、等待凑满一批的行
+            QVector<int> pendingCids;
+            pending.reserve(kBatchRows);
+            pendingCids.reserve(kBatchRows);
+            RollupCache::DayCursor cursor;
+            int lastPercent = -1;
+
+            auto flush = [&](QSqlQuery &insert, int count) -> bool {
+                for (int i = 0; i < count; ++i) {
+                    const ParsedRow &row = pending[i];
+                    insert.bindValue(i * 4 + 0, row.cents);
+                    insert.bindValue(i * 4 + 1, row.timestamp);
+                    insert.bindValue(i * 4 + 2, row.note);
+                    insert.bindValue(i * 4 + 3, pendingCids[i]);
+                }
+                if (!insert.exec()) {
+                    result.error = "写入失败：" + insert.lastError().text();
+                    return false;
+                }
+                for (int i = 0; i < count; ++i) {
+                    DailyTotal &total = m_dailyTotals[qMakePair(cursor.dayOf(pending[i].timestamp), pendingCids[i])];
+                    total.cents += pending[i].cents;
+                    ++total.count;
+                }
+                result.imported += count;
+                pending.remove(0, count);
+                pendingCids.remove(0, count);
+                return true;
+            };
+
+            auto resolveCategory = [&](const ParsedRow &row) -> int {
+                QString name = row.category.isEmpty() ? QString("未分类") : row.category;
+                int type = row.type;
+                if (type < 0) {
+                    type = categoryTypes.value(name, 1);
+                }
+
+                auto key = qMakePair(name, type);
+                auto it = categoryIds.constFind(key);
+                if (it != categoryIds.constEnd()) return it.value();
+
+                // 新分类随导入事务一起提交或回滚
+                categoryInsert.bindValue(0, name);
+                categoryInsert.bindValue(1, type);
+                if (!categoryInsert.exec()) {
+                    result.error = "创建分类失败：" + categoryInsert.lastError().text();
+                    return -1;
+                }
+                int id = categoryInsert.lastInsertId().toInt();
+                categoryIds.insert(key, id);
+                if (!categoryTypes.contains(name)) categoryTypes.insert(name, type);
+                m_newCategories.append({id, name, type});
+                return id;
+            };
+
+            for (int i = 0; i < chunks.size() && result.error.isEmpty(); ++i) {
+                if (m_cancel) {
+                    result.cancelled = true;
+                    break;
+                }
+
+                const ParsedChunk chunk = parsed.resultAt(i); // 按块顺序取回，保持文件中的行序
+                result.skipped += chunk.skipped;
+
+                for (const ParsedRow &row : chunk.rows) {
+                    int cid = resolveCategory(row);
+                    if (cid < 0) break;
+
+                    pending.append(row);
+                    pendingCids.append(cid);
+                    if (pending.size() == kBatchRows && !flush(batchInsert, kBatchRows)) break;
+                }
+
+                int percent = int(chunks[i].second * 100 / size);
+                if (percent != lastPercent) {
+                    lastPercent = percent;
+                    emit progress(percent, result.imported);
+                }
+            }
+
+            // 不足一批的尾部逐行写入
+            while (result.error.isEmpty() && !result.cancelled && !pending.isEmpty()) {
+                if (!flush(singleInsert, 1)) break;
+            }
+
+            if (!result.error.isEmpty() || result.cancelled) {
+                parsed.cancel();
+                parsed.waitForFinished();
+                db.rollback();
+                result.imported = 0;
+                m_newCategories.clear();
+                m_dailyTotals.clear();
+            } else if (!db.commit()) {
+                result.error = "提交失败：" + db.lastError().text();
+                db.rollback();
+                result.imported = 0;
+                m_newCategories.clear();
+                m_dailyTotals.clear();
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
@@ -0,0 +1,87 @@
+#ifndef RECORDIMPORTER_H
+#define RECORDIMPORTER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+class QThread;
+class RollupCache;
+
+// CSV 列映射：根据表头自动识别各列
+struct ImportMapping
+{
+    int dateColumn = -1;      // 时间 (必需)
+    int amountColumn = -1;    // 金额 (必需，负数视为支出)
+    int noteColumn = -1;      // 备注
+    int categoryColumn = -1;  // 分类名
+    int typeColumn = -1;      // 收支类型 (“收入”/“支出”等)
+
+    bool isValid() const { return dateColumn >= 0 && amountColumn >= 0; }
+    static ImportMapping fromHeader(const QStringList &header);
+};
+
+// 批量导入 (银行流水 / 本程序导出的 CSV)
+// 三段流水线：
+//   1. 解析：文件按记录边界切块，在线程池上并行解析并完成列映射
+//   2. 映射：写入线程按顺序取回各块，把分类名换成分类ID (缺失的分类自动创建)
+//   3. 写入：独立连接上用多行 VALUES 的预编译语句批量插入，整个导入一个事务
+// 取消时整个事务回滚，数据库保持导入前的状态
+class RecordImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        qint64 imported = 0;   // 写入的记录数
+        qint64 skipped = 0;    // 无法解析而跳过的行
+        bool cancelled = false;
+        QString error;         // 非空表示失败
+        qint64 elapsedMs = 0;
+    };
+
+    explicit RecordImporter(QObject *parent = nullptr);
+    ~RecordImporter() override;
+
+    // 在后台线程导入到 DatabaseManager 当前打开的数据库，结束时发出 finished
+    void start(const QString &csvPath);
+    void cancel();
+    bool isRunning() const;
+
+    // 在当前线程同步导入 (基准测试、命令行使用)
+    Result run(const QString &csvPath, const QString &databasePath);
+
+    // 把本次导入对按天汇总缓存的增量 (新分类 + 按天合计) 应用到缓存
+    void applyToRollup(RollupCache &rollup) const;
+
+signals:
+    void progress(int percent, qint64 rowsImported);
+    void finished(const RecordImporter::Result &result);
+
+private:
+    struct NewCategory {
+        int id;
+        QString name;
+        int type;
+    };
+    struct DailyTotal {
+        qint64 cents = 0;
+        qint64 count = 0;
+    };
+
+    void onThreadFinished();
+
+    std::atomic_bool m_cancel;
+    QThread *m_thread = nullptr;
+    Result m_result;
+
+    // 导入过程中收集，结束后在界面线程应用到缓存
+    QList<NewCategory> m_newCategories;
+    QHash<QPair<int, int>, DailyTotal> m_dailyTotals; // (儒略日, 分类ID) -> 合计
+};
+
+#endif // RECORDIMPORTER_H
@@ -0,0 +1,569 @@
+#include "recordtablemodel.h"
+#include "databasemanager.h"
+#include "ledgerqueries.h"
+#include "money.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+
+RecordTableModel::RecordTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    // 分类改名/增删后刷新分类列的显示
+    connect(&DatabaseManager::instance().categories(), &CategoryCache::changed, this, [this]() {
+        if (m_rowCount > 0) {
+            emit dataChanged(index(0, ColCategory), index(m_rowCount - 1, ColCategory));
+        }
+    });
+}
+
+void RecordTableModel::setFilter(const RecordFilter &filter)
+{
+    m_filter = filter;
+    m_hasFilter = true;
+}
+
+void RecordTableModel::clearFilter()
+{
+    m_filter = RecordFilter();
+    m_hasFilter = false;
+}
+
+void RecordTableModel::select()
+{
+    // 计数在数据库线程上进行，先把尚未写入的编辑写进去 (编辑可能让记录移出筛选范围)
+    DatabaseManager::instance().edits().flush();
+
+    ActiveQuery query;
+    query.filter = m_hasFilter ? m_filter : RecordFilter();
+    query.sortColumn = m_sortColumn;
+    query.sortOrder = m_sortOrder;
+
+    // 行数只统计一次，窗口数据等视图真正需要时再取
+    const QString sql = LedgerQueries::recordCount(query.filter);
+    const quint64 ticket = m_countRequests.next();
+
+    // 仍在统计的上一次计数会被中断，排队中的直接跳过
+    QFuture<int> count = DatabaseManager::instance().runLatestOnWorker(m_countRequests, ticket, [sql](QSqlDatabase &db) {
+        Q_UNUSED(db);
+        QSqlQuery *counter = DatabaseManager::instance().workerStatements().prepared(sql);
+        if (counter && counter->exec() && counter->next()) {
+            int rows = counter->value(0).toInt();
+            counter->finish();
+            return rows;
+        }
+        if (counter) qDebug() << "Count error:" << counter->lastError().text();
+        return 0;
+    });
+
+    count.then(this, [this, query, ticket](int rowCount) {
+        if (m_countRequests.isCurrent(ticket)) {
+            applyQuery(query, rowCount);
+        }
+    });
+}
+
+void RecordTableModel::applyQuery(const ActiveQuery &query, int rowCount)
+{
+    beginResetModel();
+
+    m_windows.clear();
+    m_lru.clear();
+    m_anchors.clear();
+    m_windowTicket = m_windowRequests.next(); // 模型重置，视图会重新取
+    m_loading.clear();
+    m_active = query;
+    m_rowCount = rowCount;
+
+    endResetModel();
+
+    sampleAnchors();
+}
+
+void RecordTableModel::sampleAnchors()
+{
+    const quint64 ticket = m_anchorRequests.next();
+    if (m_rowCount <= AnchorStride * WindowSize) return; // 最多跳过 AnchorStride 个窗口，不值得多读一遍
+
+    const QStringList columns = sortColumns();
+    const QString sql = LedgerQueries::recordAnchors(m_active.filter, columns,
+                                                     m_active.sortOrder == Qt::DescendingOrder,
+                                                     AnchorStride * WindowSize);
+    QFuture<QList<QVariantList>> sampled = DatabaseManager::instance().runLatestOnWorker(
+        m_anchorRequests, ticket, [sql, columns](QSqlDatabase &db) {
+            Q_UNUSED(db);
+            QList<QVariantList> keys;
+            QSqlQuery *query = DatabaseManager::instance().workerStatements().prepared(sql);
+            if (!query || !query->exec()) {
+                if (query) qDebug() << "Anchor error:" << query->lastError().text();
+                return keys;
+            }
+            while (query->next()) {
+                QVariantList key;
+                for (int i = 0; i < columns.size(); ++i) {
+                    key << query->value(i);
+                }
+                keys << key;
+            }
+            query->finish();
+            return keys;
+        });
+
+    // 第 k 个键是第 k * AnchorStride - 1 个窗口的末行，即第 k * AnchorStride 个窗口的锚点
+    sampled.then(this, [this, ticket](const QList<QVariantList> &keys) {
+        if (!m_anchorRequests.isCurrent(ticket)) return;
+        for (int i = 0; i < keys.size(); ++i) {
+            m_anchors.insert((i + 1) * AnchorStride, keys[i]);
+        }
+    });
+}
+
+qint64 RecordTableModel::recordId(int row) const
+{
+    // 批量操作要拿到确切的 ID：没加载的窗口当场读
+    const Row *r = rowAt(row, true);
+    return r ? r->id : -1;
+}
+
+RecordSelection RecordTableModel::selectionOf(const QList<int> &rows, bool allMatching) const
+{
+    if (allMatching) {
+        return RecordSelection::byFilter(m_active.filter);
+    }
+
+    // 按行号顺序取 ID：窗口依次加载，每次都从上一窗口的锚点往后读
+    QList<int> sorted = rows;
+    std::sort(sorted.begin(), sorted.end());
+    QList<qint64> ids;
+    ids.reserve(sorted.size());
+    for (int row : sorted) {
+        qint64 id = recordId(row);
+        if (id >= 0) ids.append(id);
+    }
+    return RecordSelection::byIds(ids);
+}
+
+template <typename Fn>
+void RecordTableModel::patchRows(const QList<int> &rows, bool allMatching, Fn patch)
+{
+    if (m_rowCount == 0) return;
+    invalidateRequests(); // 正在取的窗口可能读到改动之前的值
+
+    int top = m_rowCount - 1;
+    int bottom = 0;
+    auto touch = [&](int row) {
+        auto it = m_windows.find(row / WindowSize);
+        if (it == m_windows.end() || row % WindowSize >= it->size()) return; // 未加载的行之后按需从数据库读
+        patch((*it)[row % WindowSize]);
+        top = qMin(top, row);
+        bottom = qMax(bottom, row);
+    };
+
+    if (allMatching) {
+        for (auto it = m_windows.begin(); it != m_windows.end(); ++it) {
+            for (int offset = 0; offset < it->size(); ++offset) {
+                touch(it.key() * WindowSize + offset);
+            }
+        }
+    } else {
+        for (int row : rows) {
+            touch(row);
+        }
+    }
+
+    if (top <= bottom) {
+        emit dataChanged(index(top, 0), index(bottom, ColumnCount - 1));
+    }
+}
+
+bool RecordTableModel::removeRecords(const QList<int> &rows, bool allMatching, int *affected)
+{
+    RecordSelection selection = selectionOf(rows, allMatching);
+    if (!DatabaseManager::instance().deleteRecords(selection, affected)) {
+        return false;
+    }
+
+    if (allMatching) {
+        // 筛选结果全部删除，表格为空
+        applyQuery(m_active, 0);
+        return true;
+    }
+
+    // 删除位置之后的窗口整体前移，已加载的内容与锚点都作废；之前的保留
+    QList<int> sorted = rows;
+    std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    if (sorted.isEmpty()) return true;
+
+    int firstWindow = sorted.last() / WindowSize;
+    for (auto it = m_windows.begin(); it != m_windows.end();) {
+        if (it.key() >= firstWindow) {
+            m_lru.removeOne(it.key());
+            it = m_windows.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_anchors.erase(m_anchors.upperBound(firstWindow), m_anchors.end());
+    m_anchorRequests.next(); // 正在取的锚点按删除前的位置计算，丢弃
+    invalidateRequests();
+
+    // 连续的行一次移除 (从下往上，行号不受前面移除的影响)
+    int i = 0;
+    while (i < sorted.size()) {
+        int last = sorted[i];
+        int first = last;
+        while (++i < sorted.size() && sorted[i] == first - 1) {
+            first = sorted[i];
+        }
+        if (first < 0 || last >= m_rowCount) continue;
+        beginRemoveRows(QModelIndex(), first, last);
+        m_rowCount -= last - first + 1;
+        endRemoveRows();
+    }
+    return true;
+}
+
+bool RecordTableModel::recategorizeRecords(const QList<int> &rows, int cid, bool allMatching, int *affected)
+{
+    if (!DatabaseManager::instance().recategorizeRecords(selectionOf(rows, allMatching), cid, affected)) {
+        return false;
+    }
+    patchRows(rows, allMatching, [cid](Row &row) { row.cid = cid; });
+    return true;
+}
+
+bool RecordTableModel::shiftRecords(const QList<int> &rows, int days, bool allMatching, int *affected)
+{
+    // 按整天 (86400 秒) 平移，时刻不变
+    qint64 seconds = qint64(days) * 86400;
+    if (!DatabaseManager::instance().shiftRecords(selectionOf(rows, allMatching), seconds, affected)) {
+        return false;
+    }
+    patchRows(rows, allMatching, [seconds](Row &row) { row.timestamp += seconds; });
+    return true;
+}
+
+int RecordTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+int RecordTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant RecordTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole && role != CategoryIdRole) return QVariant();
+
+    const Row *r = rowAt(index.row());
+    if (!r) return QVariant();
+
+    if (role == CategoryIdRole) {
+        return r->cid;
+    }
+
+    switch (index.column()) {
+    case ColId:
+        return r->id;
+    case ColAmount:
+        return Money::toYuan(r->cents); // 显示与编辑器都以元为单位
+    case ColTime:
+        return r->timestamp;
+    case ColNote:
+        return r->note;
+    case ColCategory:
+        // 显示分类名，编辑时交给代理的是分类ID
+        if (role == Qt::EditRole) return r->cid;
+        return DatabaseManager::instance().categories().name(r->cid);
+    }
+    return QVariant();
+}
+
+QVariant RecordTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    // 分类列按分类ID排序 (见 sortColumns)，不是按名称的字母顺序，表头提示里说明
+    if (role == Qt::ToolTipRole && orientation == Qt::Horizontal && section == ColCategory) {
+        return "按分类归组排序 (顺序为分类的创建顺序，不是名称顺序)，同一分类内按时间";
+    }
+    if (role != Qt::DisplayRole) return QVariant();
+
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+
+    switch (section) {
+    case ColId:       return "ID";
+    case ColAmount:   return "金额";
+    case ColTime:     return "时间";
+    case ColNote:     return "备注";
+    case ColCategory: return "分类";
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags RecordTableModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags f = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() != ColId) {
+        f |= Qt::ItemIsEditable;
+    }
+    return f;
+}
+
+bool RecordTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole) return false;
+
+    const Row *current = rowAt(index.row());
+    if (!current) return false;
+
+    QString field;
+    QVariant stored;
+    qint64 cents = 0;
+    switch (index.column()) {
+    case ColAmount:
+        // 编辑器传回的是元：文本按十进制精确解析，数值四舍五入到分
+        if (value.typeId() == QMetaType::QString) {
+            if (!Money::parse(value.toString(), &cents)) return false;
+        } else {
+            cents = Money::fromYuan(value.toDouble());
+        }
+        field = "amount_cents";
+        stored = cents;
+        break;
+    case ColTime:     field = "timestamp"; stored = value.toLongLong();  break;
+    case ColNote:     field = "note";      stored = value.toString();    break;
+    case ColCategory: field = "cid";       stored = value.toInt();       break;
+    default:
+        return false;
+    }
+
+    // 先记进延迟写入队列 (已写日志)，稍后与其它编辑一起在一个事务里写入
+    if (!DatabaseManager::instance().edits().enqueue(current->id, field, stored)) {
+        return false;
+    }
+
+    // 同步窗口中的缓存行，界面立即显示新值 (排序位置等下次 select() 时再调整)
+    Row &row = m_windows[index.row() / WindowSize][index.row() % WindowSize];
+    switch (index.column()) {
+    case ColAmount:   row.cents = stored.toLongLong();      break;
+    case ColTime:     row.timestamp = stored.toLongLong();  break;
+    case ColNote:     row.note = stored.toString();         break;
+    case ColCategory: row.cid = stored.toInt();             break;
+    }
+
+    emit dataChanged(index.siblingAtColumn(0), index.siblingAtColumn(ColumnCount - 1));
+    return true;
+}
+
+void RecordTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column < 0 || column >= ColumnCount) return;
+    m_sortColumn = column;
+    m_sortOrder = order;
+    select();
+}
+
+const RecordTableModel::Row *RecordTableModel::rowAt(int row, bool wait) const
+{
+    if (row < 0 || row >= m_rowCount) return nullptr;
+
+    int window = row / WindowSize;
+    if (!m_windows.contains(window)) {
+        // 显示用的取数不等：交给数据库线程，取回之前这些行是空白的
+        if (!wait) {
+            requestWindow(window);
+            return nullptr;
+        }
+        if (!loadWindow(window)) return nullptr;
+    }
+    touchWindow(window);
+
+    const QVector<Row> &rows = m_windows[window];
+    int offset = row % WindowSize;
+    return offset < rows.size() ? &rows[offset] : nullptr;
+}
+
+QString RecordTableModel::windowSql(int window, QVariantList *anchor) const
+{
+    // 找到不超过目标窗口的最近一个已知锚点，从那里往后数
+    // 顺序滚动时锚点就是上一窗口的末行，OFFSET 为 0；直接拖动滚动条时有稀疏锚点 (sampleAnchors)，
+    // 最多跳过 AnchorStride - 1 个窗口 (锚点取回之前仍从头数)
+    int base = 0;
+    anchor->clear();
+    auto it = m_anchors.upperBound(window);
+    if (it != m_anchors.begin()) {
+        --it;
+        base = it.key();
+        *anchor = it.value();
+    }
+
+    // 顺序滚动时 SQL 文本不变 (OFFSET 为 0，只换锚点参数)，预编译语句可以复用
+    return LedgerQueries::recordWindow(m_active.filter, sortColumns(),
+                                       m_active.sortOrder == Qt::DescendingOrder, !anchor->isEmpty(),
+                                       WindowSize, qint64(window - base) * WindowSize);
+}
+
+bool RecordTableModel::readWindow(QSqlQuery *query, const QVariantList &anchor, QVector<Row> *rows)
+{
+    if (!query) return false;
+    for (int i = 0; i < anchor.size(); ++i) {
+        query->bindValue(i, anchor[i]);
+    }
+    if (!query->exec()) {
+        qDebug() << "Window load error:" << query->lastError().text();
+        return false;
+    }
+
+    rows->reserve(WindowSize);
+    while (query->next()) {
+        Row row;
+        row.id = query->value(0).toLongLong();
+        row.cents = query->value(1).toLongLong();
+        row.timestamp = query->value(2).toLongLong();
+        row.note = query->value(3).toString();
+        row.cid = query->value(4).toInt();
+        rows->append(row);
+    }
+    query->finish();
+    return true;
+}
+
+bool RecordTableModel::loadWindow(int window) const
+{
+    QVariantList anchor;
+    const QString sql = windowSql(window, &anchor);
+    QVector<Row> rows;
+    if (!readWindow(DatabaseManager::instance().statements().prepared(sql), anchor, &rows)) {
+        return false;
+    }
+    storeWindow(window, rows);
+    return true;
+}
+
+void RecordTableModel::requestWindow(int window) const
+{
+    if (m_loading.contains(window)) return;
+
+    // 拖动滚动条扫过很多窗口时，排队中的都已不在视野里：作废它们 (正在执行的被中断)，只取现在要显示的
+    if (m_loading.size() >= MaxWindows) {
+        m_windowTicket = m_windowRequests.next();
+        m_loading.clear();
+    }
+    m_loading.insert(window);
+
+    QVariantList anchor;
+    const QString sql = windowSql(window, &anchor);
+    const quint64 ticket = m_windowTicket;
+    QFuture<LoadedWindow> loaded = DatabaseManager::instance().runLatestOnWorker(
+        m_windowRequests, ticket, [sql, anchor](QSqlDatabase &db) {
+            Q_UNUSED(db);
+            LoadedWindow result;
+            result.ok = readWindow(DatabaseManager::instance().workerStatements().prepared(sql), anchor, &result.rows);
+            return result;
+        });
+
+    // 模型对外是 const 的 (data() 里触发取数)，回调要一个 QObject 作上下文
+    RecordTableModel *self = const_cast<RecordTableModel *>(this);
+    loaded.then(self, [self, window, ticket](const LoadedWindow &result) {
+        // 重新计数、删除行之后发出的请求已作废，视图会按新的行号重新取
+        if (!self->m_windowRequests.isCurrent(ticket)) return;
+        self->m_loading.remove(window);
+        if (!result.ok || self->m_windows.contains(window)) return;
+
+        self->storeWindow(window, result.rows);
+        const int first = window * WindowSize;
+        const int last = qMin(first + int(result.rows.size()), self->m_rowCount) - 1;
+        if (first <= last) {
+            emit self->dataChanged(self->index(first, 0), self->index(last, ColumnCount - 1));
+        }
+    });
+}
+
+void RecordTableModel::invalidateRequests()
+{
+    // 正在取的窗口按改动之前的数据读出，丢弃；通知视图后，仍在视野里的会重新请求
+    const QSet<int> loading = m_loading;
+    m_windowTicket = m_windowRequests.next();
+    m_loading.clear();
+    for (int window : loading) {
+        const int first = window * WindowSize;
+        const int last = qMin(first + WindowSize, m_rowCount) - 1;
+        if (first <= last) {
+            emit dataChanged(index(first, 0), index(last, ColumnCount - 1));
+        }
+    }
+}
+
+void RecordTableModel::storeWindow(int window, QVector<Row> rows) const
+{
+    // 记下下一窗口的锚点，向下滚动时直接定位
+    // 必须用数据库里的值：末行若有尚未写入的排序列编辑，按新值定位会漏行或重复
+    if (rows.size() == WindowSize) {
+        m_anchors.insert(window + 1, keyOf(rows.last()));
+    }
+
+    // 叠加尚未写入数据库的编辑，窗口被淘汰后重新读出来也显示新值
+    const EditQueue &edits = DatabaseManager::instance().edits();
+    if (!edits.isEmpty()) {
+        for (Row &row : rows) {
+            const EditQueue::FieldValues pending = edits.pending(row.id);
+            for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+                if (it.key() == "amount_cents")   row.cents = it->toLongLong();
+                else if (it.key() == "timestamp") row.timestamp = it->toLongLong();
+                else if (it.key() == "note")      row.note = it->toString();
+                else if (it.key() == "cid")       row.cid = it->toInt();
+            }
+        }
+    }
+
+    m_windows.insert(window, rows);
+    touchWindow(window);
+}
+
+void RecordTableModel::touchWindow(int window) const
+{
+    if (!m_lru.isEmpty() && m_lru.last() == window) return;
+
+    m_lru.removeOne(window);
+    m_lru.append(window);
+
+    // 淘汰最久未使用的窗口，内存占用与账单总量无关
+    while (m_lru.size() > MaxWindows) {
+        m_windows.remove(m_lru.takeFirst());
+    }
+}
+
+QStringList RecordTableModel::sortColumns() const
+{
+    // 每种排序都与一个索引的列顺序一致 (id 即 rowid，隐含在每个索引末尾)
+    switch (m_active.sortColumn) {
+    case ColAmount:   return {"amount_cents", "id"};                     // idx_record_amount
+    case ColNote:     return {"note", "id"};                             // idx_record_note
+    // 分类按ID而不是名称排序：按名称要 JOIN 分类表、每个窗口都得整体排序，不能键集翻页；
+    // 按ID时同一分类的账单仍排在一起，表头提示里有说明
+    case ColCategory: return {"cid", "timestamp", "amount_cents", "id"}; // idx_record_cid_ts_amount (按分类ID归组)
+    case ColId:       return {"id"};
+    case ColTime:
+    default:          return {"timestamp", "id"};                        // idx_record_ts
+    }
+}
+
+QVariantList RecordTableModel::keyOf(const Row &row) const
+{
+    QVariantList key;
+    for (const QString &column : sortColumns()) {
+        if (column == "id")                key << row.id;
+        else if (column == "amount_cents") key << row.cents;
+        else if (column == "timestamp")    key << row.timestamp;
+        else if (column == "note")         key << row.note;
+        else if (column == "cid")          key << row.cid;
+    }
+    return key;
+}
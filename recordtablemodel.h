@@ -0,0 +1,128 @@
+#ifndef RECORDTABLEMODEL_H
+#define RECORDTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QVariantList>
+#include <QVector>
+#include "recordfilter.h"
+#include "databasemanager.h"
+
+// 明细表格模型 (分窗口按需加载)
+// 只把视图附近的若干个固定大小的窗口留在内存里，离开视野的窗口按 LRU 淘汰；
+// 窗口之间用“排序键 + id”做键集翻页 (WHERE (键) > (上一窗口最后一行的键))，
+// 每次取数都是一次索引定位 + LIMIT，与账单总量无关；显示用的窗口在数据库线程上读，取回之前这些行显示为空白，
+// 带短词备注搜索 (LIKE 逐条比对) 时滚动也不卡界面；批量操作要用的行 ID 仍当场读；
+// 计数完成后再在后台每隔 AnchorStride 个窗口取一个锚点，直接拖动滚动条时从最近的锚点起定位，不做大 OFFSET；
+// 分类名来自 CategoryCache，不再 JOIN category
+// 行数在数据库线程上统计 (带备注搜索时可能较慢)，统计完成前表格保持上一次的内容
+class RecordTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    // 列顺序与数据库 record 表一致
+    enum Column {
+        ColId = 0,
+        ColAmount,
+        ColTime,
+        ColNote,
+        ColCategory,
+        ColumnCount
+    };
+
+    // 分类列的分类ID (DisplayRole 为分类名)
+    static const int CategoryIdRole = Qt::UserRole + 1;
+
+    static const int WindowSize = 256; // 每个窗口的行数
+    static const int MaxWindows = 6;   // 同时驻留的窗口数
+    static const int AnchorStride = 16; // 稀疏锚点的间隔 (窗口数)
+
+    explicit RecordTableModel(QObject *parent = nullptr);
+
+    // 设置筛选条件后需调用 select() 生效
+    void setFilter(const RecordFilter &filter);
+    void clearFilter();
+    const RecordFilter &filter() const { return m_filter; }
+
+    // 按当前的筛选与排序重新计数，完成后丢弃所有已加载的窗口 (异步)
+    void select();
+
+    qint64 recordId(int row) const;
+
+    // 批量操作：作用于 rows 这些行，allMatching 为真时忽略 rows、作用于当前显示的筛选结果的全部记录
+    // 数据库里是一条按集合执行的语句；表格随之增量更新，不重新计数：
+    // 删除的行直接移除，改分类/平移日期只改已加载的行 (与单元格编辑一样，排序位置等下次 select() 时再调整)
+    // affected 返回实际改动的记录数
+    bool removeRecords(const QList<int> &rows, bool allMatching = false, int *affected = nullptr);
+    bool recategorizeRecords(const QList<int> &rows, int cid, bool allMatching = false, int *affected = nullptr);
+    bool shiftRecords(const QList<int> &rows, int days, bool allMatching = false, int *affected = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    struct Row {
+        qint64 id = 0;
+        qint64 cents = 0; // 金额 (分)
+        qint64 timestamp = 0;
+        QString note;
+        int cid = -1;
+    };
+
+    // 数据库线程读出的一个窗口
+    struct LoadedWindow {
+        bool ok = false;
+        QVector<Row> rows;
+    };
+
+    // 当前显示的数据对应的查询条件 (select() 完成时才切换)
+    struct ActiveQuery {
+        RecordFilter filter;
+        int sortColumn = ColTime;
+        Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    };
+
+    void applyQuery(const ActiveQuery &query, int rowCount);
+    RecordSelection selectionOf(const QList<int> &rows, bool allMatching) const;
+    template <typename Fn> void patchRows(const QList<int> &rows, bool allMatching, Fn patch); // 改已加载的行并通知视图
+    // 取一行：窗口没加载时 wait 为真则当场读，否则交给数据库线程 (requestWindow) 并返回空
+    const Row *rowAt(int row, bool wait = false) const;
+    QString windowSql(int window, QVariantList *anchor) const; // 从最近的锚点起读这个窗口的 SQL 与锚点参数
+    static bool readWindow(QSqlQuery *query, const QVariantList &anchor, QVector<Row> *rows);
+    bool loadWindow(int window) const;
+    void requestWindow(int window) const;
+    void storeWindow(int window, QVector<Row> rows) const; // 记下一窗口的锚点、叠加未写入的编辑后放进缓存
+    void invalidateRequests();                             // 作废正在取的窗口 (行号或内容已变)
+    void touchWindow(int window) const;
+    void sampleAnchors();                    // 在数据库线程上取稀疏锚点 (行数较多时)
+    QStringList sortColumns() const;         // 当前排序用到的列 (最后一列总是 id)
+    QVariantList keyOf(const Row &row) const;
+
+    RecordFilter m_filter;
+    bool m_hasFilter = false;
+    int m_sortColumn = ColTime;
+    Qt::SortOrder m_sortOrder = Qt::AscendingOrder;
+
+    ActiveQuery m_active;
+    int m_rowCount = 0;
+    RequestSequence m_countRequests; // 新的 select() 作废尚未完成的计数
+    RequestSequence m_anchorRequests; // 重新计数或删除行后作废尚未取回的锚点
+
+    mutable QHash<int, QVector<Row>> m_windows; // 窗口号 -> 行
+    mutable QList<int> m_lru;                   // 最近使用的窗口在末尾
+    mutable QMap<int, QVariantList> m_anchors;  // 窗口号 -> 上一窗口最后一行的键
+    mutable RequestSequence m_windowRequests;   // 同一批有效的窗口请求共用一个编号，作废时换号
+    mutable quint64 m_windowTicket = 0;
+    mutable QSet<int> m_loading;                // 已交给数据库线程、尚未取回的窗口
+};
+
+#endif // RECORDTABLEMODEL_H
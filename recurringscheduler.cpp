@@ -0,0 +1,249 @@
+#include "recurringscheduler.h"
+#include "databasemanager.h"
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <atomic>
+
+namespace {
+
+// 没有即将到期的规则时也定期看一眼 (其他进程新增的规则、系统休眠后时钟跳过了定时)
+const int kMaxWaitMs = 60 * 60 * 1000;
+
+// 规则从第 generated 次起到 until 为止到期的次数；nextDue 取未到期的最近一次
+qint64 dueCount(const RecurringRule &rule, const QDateTime &until, QDateTime *nextDue)
+{
+    qint64 index = rule.generated;
+    for (;; ++index) {
+        const QDateTime when = rule.occurrence(index);
+        if (!when.isValid() || (rule.endDate.isValid() && when.date() > rule.endDate)) break;
+        if (when > until) {
+            if (!nextDue->isValid() || when < *nextDue) *nextDue = when;
+            break;
+        }
+    }
+    return index - rule.generated;
+}
+
+} // namespace
+
+QDateTime RecurringRule::occurrence(qint64 index) const
+{
+    const qint64 steps = index * every;
+    QDate date;
+    switch (unit) {
+    case Day:   date = start.date().addDays(steps); break;
+    case Week:  date = start.date().addDays(steps * 7); break;
+    case Month: date = start.date().addMonths(int(steps)); break;
+    }
+    return QDateTime(date, start.time());
+}
+
+QString RecurringRule::describe() const
+{
+    static const char *units[] = {"天", "周", "月"};
+    static const char *single[] = {"每天", "每周", "每月"};
+    return every == 1 ? QString(single[unit]) : QString("每 %1 %2").arg(every).arg(QString(units[unit]));
+}
+
+RecurringScheduler::RecurringScheduler(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &RecurringScheduler::runNow);
+}
+
+RecurringScheduler::~RecurringScheduler()
+{
+    if (m_thread) {
+        m_thread->wait(); // 一次补生成只是一个事务，等它提交或回滚
+    }
+}
+
+void RecurringScheduler::activate()
+{
+    m_active = true;
+    runNow();
+}
+
+void RecurringScheduler::runNow()
+{
+    // 汇总缓存建好之前生成的账单无法计入缓存 (见 DatabaseManager::rebuildRollupInBackground)，等 activate()
+    if (!m_active) return;
+    if (m_thread) {
+        m_runAgain = true;
+        return;
+    }
+
+    m_timer->stop();
+    const QString databasePath = DatabaseManager::instance().databasePath();
+    m_thread = QThread::create([this, databasePath]() {
+        m_result = run(databasePath, QDateTime::currentDateTime());
+    });
+    connect(m_thread, &QThread::finished, this, &RecurringScheduler::onThreadFinished);
+    m_thread->start();
+}
+
+bool RecurringScheduler::isRunning() const
+{
+    return m_thread != nullptr;
+}
+
+void RecurringScheduler::onThreadFinished()
+{
+    m_thread->deleteLater();
+    m_thread = nullptr;
+
+    // 缓存只在界面线程读写，生成线程只负责收集增量
+    if (m_result.error.isEmpty() && !m_entries.isEmpty()) {
+        RollupCache &rollup = DatabaseManager::instance().rollup();
+        BudgetTracker &budgets = DatabaseManager::instance().budgets();
+        for (const RollupCache::Entry &entry : m_entries) {
+            rollup.addEntry(entry);
+            budgets.addEntry(entry);
+        }
+        budgets.settle();
+    }
+    m_entries.clear();
+    emit finished(m_result);
+
+    if (m_runAgain) {
+        m_runAgain = false;
+        runNow();
+    } else {
+        scheduleNext(m_result.nextDue);
+    }
+}
+
+void RecurringScheduler::scheduleNext(const QDateTime &nextDue)
+{
+    qint64 waitMs = kMaxWaitMs;
+    if (nextDue.isValid()) {
+        waitMs = qBound<qint64>(1000, QDateTime::currentDateTime().msecsTo(nextDue) + 1000, kMaxWaitMs);
+    }
+    m_timer->start(int(waitMs));
+}
+
+bool RecurringScheduler::loadRules(const QSqlDatabase &db, QVector<RecurringRule> *rules)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, amount_cents, cid, note, start_time, unit, every, end_date, generated "
+                    "FROM recurring_rule ORDER BY id")) {
+        qDebug() << "Recurring rule error:" << query.lastError().text();
+        return false;
+    }
+    rules->clear();
+    while (query.next()) {
+        RecurringRule rule;
+        rule.id = query.value(0).toLongLong();
+        rule.cents = query.value(1).toLongLong();
+        rule.cid = query.value(2).toInt();
+        rule.note = query.value(3).toString();
+        rule.start = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+        rule.unit = RecurringRule::Unit(qBound(0, query.value(5).toInt(), 2));
+        rule.every = qMax(1, query.value(6).toInt());
+        rule.endDate = QDate::fromString(query.value(7).toString(), Qt::ISODate);
+        rule.generated = query.value(8).toLongLong();
+        rules->append(rule);
+    }
+    return true;
+}
+
+RecurringScheduler::Result RecurringScheduler::run(const QString &databasePath, const QDateTime &until)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+    m_entries.clear();
+
+    static std::atomic_int connectionCounter(0);
+    const QString connectionName = QString("finance_recurring_%1").arg(++connectionCounter);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databasePath);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            result.error = "无法打开数据库：" + db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.exec("PRAGMA foreign_keys = ON");
+
+            // 多数时候没有到期的：先不加锁看一眼，有到期的才开写事务
+            QVector<RecurringRule> rules;
+            qint64 due = 0;
+            if (!loadRules(db, &rules)) {
+                result.error = "读取重复账单失败";
+            } else {
+                for (const RecurringRule &rule : rules) {
+                    due += dueCount(rule, until, &result.nextDue);
+                }
+            }
+
+            // IMMEDIATE：读规则之前先拿写锁，另一个进程同时补生成时等它提交后读到推进过的进度
+            if (due > 0 && !query.exec("BEGIN IMMEDIATE")) {
+                result.error = "无法开始事务：" + query.lastError().text();
+            } else if (due > 0) {
+                QSqlQuery insert(db);
+                QSqlQuery advance(db);
+                insert.prepare("INSERT INTO record (amount_cents, timestamp, note, cid) VALUES (?, ?, ?, ?)");
+                advance.prepare("UPDATE recurring_rule SET generated = ? WHERE id = ?");
+
+                result.nextDue = QDateTime();
+                if (!loadRules(db, &rules)) {
+                    result.error = "读取重复账单失败";
+                }
+                for (int i = 0; i < rules.size() && result.error.isEmpty(); ++i) {
+                    const RecurringRule &rule = rules[i];
+                    const qint64 count = dueCount(rule, until, &result.nextDue);
+                    if (count == 0) continue;
+
+                    for (qint64 index = rule.generated; index < rule.generated + count; ++index) {
+                        RollupCache::Entry entry;
+                        entry.timestamp = rule.occurrence(index).toSecsSinceEpoch();
+                        entry.cid = rule.cid;
+                        entry.cents = rule.cents;
+                        insert.bindValue(0, entry.cents);
+                        insert.bindValue(1, entry.timestamp);
+                        insert.bindValue(2, rule.note);
+                        insert.bindValue(3, entry.cid);
+                        if (!insert.exec()) {
+                            result.error = "写入失败：" + insert.lastError().text();
+                            break;
+                        }
+                        m_entries.append(entry);
+                    }
+                    if (!result.error.isEmpty()) break;
+
+                    // 进度与账单在同一事务里提交
+                    advance.bindValue(0, rule.generated + count);
+                    advance.bindValue(1, rule.id);
+                    if (!advance.exec()) {
+                        result.error = "更新重复账单失败：" + advance.lastError().text();
+                    }
+                }
+
+                if (result.error.isEmpty() && !db.commit()) {
+                    result.error = "提交失败：" + db.lastError().text();
+                }
+                if (!result.error.isEmpty()) {
+                    db.rollback();
+                    m_entries.clear();
+                }
+            }
+            result.generated = m_entries.size();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (!result.error.isEmpty()) {
+        qDebug() << "Recurring error:" << result.error;
+    }
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
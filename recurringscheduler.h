@@ -0,0 +1,83 @@
+#ifndef RECURRINGSCHEDULER_H
+#define RECURRINGSCHEDULER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include "rollupcache.h"
+
+class QThread;
+class QTimer;
+
+// 重复账单规则 (房租、工资、订阅等)：从 start 起每 every 个单位记一笔，直到 endDate (含)
+// 第 k 次的时间都从 start 直接推算 (不在上一次的基础上累加)，31 号按月重复时小月落在月末、下个月仍回到 31 号
+struct RecurringRule
+{
+    enum Unit { Day = 0, Week = 1, Month = 2 };
+
+    qint64 id = -1;
+    qint64 cents = 0;        // 金额 (分)
+    int cid = -1;
+    QString note;
+    QDateTime start;         // 第一次的日期与时间 (本地时间)
+    Unit unit = Month;
+    int every = 1;           // 每 every 个单位一次
+    QDate endDate;           // 最后一天 (含)，无效表示不截止
+    qint64 generated = 0;    // 已写入账单的次数：第 0 .. generated - 1 次已生成
+
+    QDateTime occurrence(qint64 index) const;
+    QString describe() const; // 例如 “每月”、“每 2 周”
+};
+
+// 重复账单的调度：把到期的规则生成为普通账单
+// 生成在独立连接上进行，一次补生成 (无论漏了几个月) 是一个 BEGIN IMMEDIATE 事务：
+// 读规则、逐条写入、推进各规则的 generated 都在同一事务里，提交后进度与账单一起生效，
+// 重启、重复调用或两个进程同时补生成都不会重复记账
+// 界面在汇总缓存建好后调用 activate()：先在后台补上次退出以来漏掉的，之后按最近一次到期时间定时再跑
+class RecurringScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        qint64 generated = 0;   // 本次写入的账单数
+        QDateTime nextDue;      // 尚未到期的最近一次，没有时无效
+        QString error;          // 非空表示失败 (整批回滚)
+        qint64 elapsedMs = 0;
+    };
+
+    explicit RecurringScheduler(QObject *parent = nullptr);
+    ~RecurringScheduler() override;
+
+    // 开始调度并立即在后台补生成一次；之前的 runNow() 只记下需要再跑
+    void activate();
+    // 在后台生成到现在为止到期的账单 (新增规则后调用)；正在跑时等这次结束后再跑一次
+    void runNow();
+    bool isRunning() const;
+
+    // 在当前线程同步生成到 until 为止到期的账单 (基准测试使用)
+    Result run(const QString &databasePath, const QDateTime &until);
+
+    // 读出全部规则 (ID 升序)
+    static bool loadRules(const QSqlDatabase &db, QVector<RecurringRule> *rules);
+
+signals:
+    void finished(const RecurringScheduler::Result &result);
+
+private:
+    void onThreadFinished();
+    void scheduleNext(const QDateTime &nextDue);
+
+    bool m_active = false;
+    bool m_runAgain = false;
+    QThread *m_thread = nullptr;
+    QTimer *m_timer = nullptr;
+    Result m_result;
+
+    // 本次生成的账单，结束后在界面线程计入汇总缓存与预算
+    QVector<RollupCache::Entry> m_entries;
+};
+
+#endif // RECURRINGSCHEDULER_H
@@ -0,0 +1,502 @@
+#include "rollupcache.h"
+#include "databasemanager.h"
+#include "money.h"
+#include "columnarsnapshot.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <cmath>
+#include <climits>
+
+namespace {
+
+// 扩容时在两端多留出的天数，避免逐日扩容
+const int kDayPadding = 366;
+
+// 所有时区偏移都是 15 分钟的整数倍，按 15 分钟对齐分组不会跨越本地日期边界
+const int kQuarterSecs = 900;
+
+} // namespace
+
+int RollupCache::dayOf(qint64 timestamp)
+{
+    return int(QDateTime::fromSecsSinceEpoch(timestamp).date().toJulianDay());
+}
+
+int RollupCache::DayCursor::dayOf(qint64 timestamp)
+{
+    if (timestamp < m_start || timestamp >= m_end) {
+        QDate date = QDateTime::fromSecsSinceEpoch(timestamp).date();
+        m_day = int(date.toJulianDay());
+        m_start = QDateTime(date, QTime(0, 0)).toSecsSinceEpoch();
+        m_end = QDateTime(date.addDays(1), QTime(0, 0)).toSecsSinceEpoch();
+    }
+    return m_day;
+}
+
+bool RollupCache::loadEntry(qint64 recordId, Entry *entry)
+{
+    // 每次编辑、删除都会调用，使用预编译语句
+    QSqlQuery *query = DatabaseManager::instance().statements().prepared(
+        "SELECT timestamp, cid, amount_cents FROM record WHERE id = :id");
+    if (!query) return false;
+    query->bindValue(":id", recordId);
+    if (!query->exec() || !query->next()) {
+        query->finish();
+        return false;
+    }
+    entry->timestamp = query->value(0).toLongLong();
+    entry->cid = query->value(1).toInt();
+    entry->cents = query->value(2).toLongLong();
+    query->finish(); // 不留着游标：WAL 下未结束的读事务会钉住快照，检查点做不完、看不到其他连接的提交
+    return true;
+}
+
+void RollupCache::clear()
+{
+    ++m_revision;
+    m_series.clear();
+    m_categories.clear();
+    m_firstDay = 0;
+    m_dayCount = 0;
+    m_ready = false;
+}
+
+bool RollupCache::loadCategories(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, name, type FROM category")) {
+        qDebug() << "Rollup error:" << query.lastError().text();
+        return false;
+    }
+    while (query.next()) {
+        CategoryMeta meta;
+        meta.name = query.value(1).toString();
+        meta.type = query.value(2).toInt();
+        m_categories.insert(query.value(0).toInt(), meta);
+    }
+    return true;
+}
+
+void RollupCache::buildTrees()
+{
+    for (Series &series : m_series) {
+        resizeSeries(series);
+        buildTree(series.dailyCents, series.treeCents);
+        buildTree(series.dailyCount, series.treeCount);
+    }
+    m_ready = true;
+}
+
+bool RollupCache::rebuild(const QSqlDatabase &db)
+{
+    clear();
+
+    // 分类元数据
+    if (!loadCategories(db)) {
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+
+    // 先在 SQLite 里按 (15分钟, 分类) 分组把行数压下来，再在内存里换算成本地日期
+    // q 为向下取整到 15 分钟的时间戳 (对负数同样向下取整)
+    QString sql = QString("SELECT timestamp - ((timestamp % %1) + %1) % %1 AS q, cid, "
+                          "SUM(amount_cents), COUNT(*) "
+                          "FROM record GROUP BY q, cid ORDER BY q").arg(kQuarterSecs);
+    if (!query.exec(sql)) {
+        qDebug() << "Rollup error:" << query.lastError().text();
+        return false;
+    }
+
+    // 行按时间有序，只有跨天时才做一次日期换算
+    DayCursor cursor;
+    while (query.next()) {
+        int day = cursor.dayOf(query.value(0).toLongLong());
+        ensureDay(day);
+        Series &series = m_series[query.value(1).toInt()];
+        resizeSeries(series);
+        series.dailyCents[day - m_firstDay] += query.value(2).toLongLong();
+        series.dailyCount[day - m_firstDay] += query.value(3).toLongLong();
+    }
+
+    buildTrees();
+    return true;
+}
+
+bool RollupCache::rebuild(const ColumnarSnapshot &columns, const QSqlDatabase &db)
+{
+    clear();
+    if (!columns.isOpen() || !loadCategories(db)) {
+        return false;
+    }
+
+    // 快照按时间有序：同一天的记录先在以分类ID为下标的数组里累加，跨天时再把这一天写进各分类的序列
+    const qint64 *timestamps = columns.timestamps();
+    const qint64 *cents = columns.cents();
+    const qint32 *cids = columns.categoryIds();
+    const qint64 rows = columns.rowCount();
+    QVector<qint64> dayCents(columns.maxCategoryId() + 1, 0);
+    QVector<qint64> dayCount(columns.maxCategoryId() + 1, 0);
+    QVector<int> touched;
+
+    auto flushDay = [&](int day) {
+        ensureDay(day);
+        for (int cid : touched) {
+            Series &series = m_series[cid];
+            resizeSeries(series);
+            series.dailyCents[day - m_firstDay] += dayCents[cid];
+            series.dailyCount[day - m_firstDay] += dayCount[cid];
+            dayCents[cid] = 0;
+            dayCount[cid] = 0;
+        }
+        touched.clear();
+    };
+
+    DayCursor cursor;
+    int currentDay = 0;
+    for (qint64 i = 0; i < rows; ++i) {
+        const int day = cursor.dayOf(timestamps[i]);
+        if (day != currentDay && !touched.isEmpty()) {
+            flushDay(currentDay);
+        }
+        currentDay = day;
+        const qint32 cid = cids[i];
+        if (dayCount[cid] == 0) touched.append(cid);
+        dayCents[cid] += cents[i];
+        dayCount[cid] += 1;
+    }
+    if (!touched.isEmpty()) {
+        flushDay(currentDay);
+    }
+
+    buildTrees();
+    return true;
+}
+
+void RollupCache::takeFrom(RollupCache &other)
+{
+    ++m_revision;
+    m_series = std::move(other.m_series);
+    m_categories = std::move(other.m_categories);
+    m_firstDay = other.m_firstDay;
+    m_dayCount = other.m_dayCount;
+    m_ready = other.m_ready;
+    other.clear();
+}
+
+void RollupCache::addEntry(const Entry &entry)
+{
+    ++m_revision;
+    if (!m_ready) return;
+    apply(dayOf(entry.timestamp), entry.cid, entry.cents, 1);
+}
+
+void RollupCache::removeEntry(const Entry &entry)
+{
+    ++m_revision;
+    if (!m_ready) return;
+    apply(dayOf(entry.timestamp), entry.cid, -entry.cents, -1);
+}
+
+void RollupCache::addDailyTotal(int day, int cid, qint64 cents, qint64 count)
+{
+    ++m_revision;
+    if (!m_ready) return;
+    apply(day, cid, cents, count);
+}
+
+void RollupCache::addCategory(int id, const QString &name, int type)
+{
+    ++m_revision;
+    if (!m_ready) return;
+    CategoryMeta meta;
+    meta.name = name;
+    meta.type = type;
+    m_categories.insert(id, meta);
+}
+
+void RollupCache::moveCategory(int fromId, int toId)
+{
+    ++m_revision;
+    if (!m_ready) return;
+
+    auto it = m_series.find(fromId);
+    if (it != m_series.end()) {
+        Series from = it.value();
+        m_series.erase(it);
+
+        Series &to = m_series[toId];
+        resizeSeries(from);
+        resizeSeries(to);
+        Money::accumulate(to.dailyCents.data(), from.dailyCents.constData(), m_dayCount);
+        Money::accumulate(to.dailyCount.data(), from.dailyCount.constData(), m_dayCount);
+        buildTree(to.dailyCents, to.treeCents);
+        buildTree(to.dailyCount, to.treeCount);
+    }
+    m_categories.remove(fromId);
+}
+
+void RollupCache::removeCategory(int id)
+{
+    ++m_revision;
+    if (!m_ready) return;
+    m_series.remove(id);
+    m_categories.remove(id);
+}
+
+AggregateSnapshotPtr RollupCache::snapshot(const RecordFilter &filter) const
+{
+    int fromDay = filter.startDate.isValid() ? int(filter.startDate.toJulianDay()) : INT_MIN;
+    int toDay = filter.endDate.isValid() ? int(filter.endDate.toJulianDay()) : INT_MAX;
+
+    QVector<CategoryTotal> categories;
+    for (auto it = m_series.constBegin(); it != m_series.constEnd(); ++it) {
+        if (!matches(it.key(), filter)) continue;
+        const CategoryMeta meta = m_categories.value(it.key());
+
+        RangeTotal range = rangeTotal(it.value(), fromDay, toDay);
+        if (range.count == 0) continue;
+
+        CategoryTotal total;
+        total.id = it.key();
+        total.name = meta.name;
+        total.type = meta.type;
+        total.cents = range.cents;
+        total.count = int(range.count);
+        categories.append(total);
+    }
+
+    return AggregateSnapshotPtr(new AggregateSnapshot(std::move(categories)));
+}
+
+void RollupCache::dailyTotals(const RecordFilter &filter, int fromDay, int toDay,
+                              QVector<qint64> *income, QVector<qint64> *expense) const
+{
+    int length = qMax(0, toDay - fromDay + 1);
+    income->fill(0, length);
+    expense->fill(0, length);
+
+    // 只需要遍历与缓存覆盖范围重叠的那几天
+    int first = qMax(fromDay, m_firstDay);
+    int last = qMin(toDay, m_firstDay + m_dayCount - 1);
+    if (first > last) return;
+
+    for (auto it = m_series.constBegin(); it != m_series.constEnd(); ++it) {
+        if (!matches(it.key(), filter)) continue;
+
+        const QVector<qint64> &daily = it.value().dailyCents;
+        qint64 *out = (m_categories.value(it.key()).type == 1 ? income : expense)->data();
+        Money::accumulate(out + (first - fromDay), daily.constData() + (first - m_firstDay), last - first + 1);
+    }
+}
+
+bool RollupCache::dayRange(int *firstDay, int *lastDay) const
+{
+    // 序列两端留有扩容余量，这里找出真正有记录的首尾
+    int first = INT_MAX;
+    int last = INT_MIN;
+    for (const Series &series : m_series) {
+        for (int i = 0; i < series.dailyCount.size() && m_firstDay + i < first; ++i) {
+            if (series.dailyCount[i] != 0) {
+                first = m_firstDay + i;
+                break;
+            }
+        }
+        for (int i = series.dailyCount.size() - 1; i >= 0 && m_firstDay + i > last; --i) {
+            if (series.dailyCount[i] != 0) {
+                last = m_firstDay + i;
+                break;
+            }
+        }
+    }
+    if (first > last) return false;
+
+    *firstDay = first;
+    *lastDay = last;
+    return true;
+}
+
+QStringList RollupCache::verifyAgainstSql(int rounds, quint32 seed) const
+{
+    QStringList mismatches;
+    if (!m_ready) {
+        mismatches << "rollup cache is not ready";
+        return mismatches;
+    }
+
+    QRandomGenerator rng(seed);
+    QList<int> categoryIds = m_categories.keys();
+
+    // 在数据覆盖的日期范围两侧各放宽一个月抽样，覆盖空范围与边界
+    int spanFirst = (m_dayCount > 0 ? m_firstDay : int(QDate::currentDate().toJulianDay())) - 30;
+    int spanDays = m_dayCount + 60;
+
+    for (int round = 0; round < rounds; ++round) {
+        RecordFilter filter;
+        int a = spanFirst + int(rng.bounded(spanDays));
+        int b = spanFirst + int(rng.bounded(spanDays));
+        filter.startDate = QDate::fromJulianDay(qMin(a, b));
+        filter.endDate = QDate::fromJulianDay(qMax(a, b));
+        filter.type = int(rng.bounded(3)) - 1;
+        if (!categoryIds.isEmpty() && rng.bounded(4) == 0) {
+            filter.categoryId = categoryIds.at(int(rng.bounded(categoryIds.size())));
+        }
+
+        QHash<int, RangeTotal> expected;
+        QSqlQuery query;
+        QString sql = "SELECT r.cid, SUM(r.amount_cents), COUNT(*) "
+                      "FROM record r JOIN category c ON r.cid = c.id "
+                      "WHERE 1=1 " + filter.toJoinedSql() + " GROUP BY r.cid";
+        if (!query.exec(sql)) {
+            mismatches << "query failed: " + query.lastError().text();
+            continue;
+        }
+        while (query.next()) {
+            RangeTotal total;
+            total.cents = query.value(1).toLongLong();
+            total.count = query.value(2).toLongLong();
+            expected.insert(query.value(0).toInt(), total);
+        }
+
+        QHash<int, RangeTotal> actual;
+        AggregateSnapshotPtr snap = snapshot(filter);
+        for (const CategoryTotal &c : snap->categories()) {
+            RangeTotal total;
+            total.cents = c.cents;
+            total.count = c.count;
+            actual.insert(c.id, total);
+        }
+
+        QSet<int> ids;
+        for (auto it = expected.constBegin(); it != expected.constEnd(); ++it) ids.insert(it.key());
+        for (auto it = actual.constBegin(); it != actual.constEnd(); ++it) ids.insert(it.key());
+        for (int id : ids) {
+            RangeTotal e = expected.value(id);
+            RangeTotal g = actual.value(id);
+            if (e.cents != g.cents || e.count != g.count) {
+                mismatches << QString("%1..%2 type=%3 category=%4 cid=%5: sql=%6/%7 cache=%8/%9")
+                                  .arg(filter.startDate.toString(Qt::ISODate), filter.endDate.toString(Qt::ISODate))
+                                  .arg(filter.type).arg(filter.categoryId).arg(id)
+                                  .arg(e.cents).arg(e.count).arg(g.cents).arg(g.count);
+            }
+        }
+    }
+    return mismatches;
+}
+
+void RollupCache::apply(int day, int cid, qint64 cents, qint64 count)
+{
+    ensureDay(day);
+    Series &series = m_series[cid];
+    resizeSeries(series);
+
+    int index = day - m_firstDay;
+    series.dailyCents[index] += cents;
+    series.dailyCount[index] += count;
+    treeAdd(series.treeCents, index + 1, cents);
+    treeAdd(series.treeCount, index + 1, count);
+}
+
+void RollupCache::ensureDay(int day)
+{
+    if (m_dayCount == 0) {
+        m_firstDay = day - kDayPadding;
+        m_dayCount = 2 * kDayPadding + 1;
+        return;
+    }
+    if (day >= m_firstDay && day < m_firstDay + m_dayCount) {
+        return;
+    }
+
+    // 超出当前范围：向缺口一侧扩容并整体平移原始值，再重建树
+    int newFirst = qMin(m_firstDay, day - kDayPadding);
+    int newEnd = qMax(m_firstDay + m_dayCount, day + kDayPadding + 1);
+    int shift = m_firstDay - newFirst;
+    int newCount = newEnd - newFirst;
+
+    for (Series &series : m_series) {
+        QVector<qint64> cents(newCount, 0);
+        QVector<qint64> count(newCount, 0);
+        for (int i = 0; i < series.dailyCents.size(); ++i) {
+            cents[i + shift] = series.dailyCents[i];
+            count[i + shift] = series.dailyCount[i];
+        }
+        series.dailyCents = cents;
+        series.dailyCount = count;
+        buildTree(series.dailyCents, series.treeCents);
+        buildTree(series.dailyCount, series.treeCount);
+    }
+
+    m_firstDay = newFirst;
+    m_dayCount = newCount;
+}
+
+void RollupCache::resizeSeries(Series &series) const
+{
+    // 新分类的序列按需补齐到当前天数 (全 0 时树也全 0，无需重建)
+    if (series.dailyCents.size() == m_dayCount) return;
+    series.dailyCents.resize(m_dayCount);
+    series.dailyCount.resize(m_dayCount);
+    series.treeCents.resize(m_dayCount + 1);
+    series.treeCount.resize(m_dayCount + 1);
+}
+
+void RollupCache::buildTree(const QVector<qint64> &daily, QVector<qint64> &tree)
+{
+    // O(n) 建树：每个节点把自己的值推给父节点
+    int n = daily.size();
+    tree.fill(0, n + 1);
+    for (int i = 1; i <= n; ++i) {
+        tree[i] += daily[i - 1];
+        int parent = i + (i & -i);
+        if (parent <= n) {
+            tree[parent] += tree[i];
+        }
+    }
+}
+
+void RollupCache::treeAdd(QVector<qint64> &tree, int index, qint64 delta)
+{
+    for (; index < tree.size(); index += index & -index) {
+        tree[index] += delta;
+    }
+}
+
+qint64 RollupCache::treePrefix(const QVector<qint64> &tree, int count)
+{
+    // 前 count 天之和
+    qint64 sum = 0;
+    for (; count > 0; count -= count & -count) {
+        sum += tree[count];
+    }
+    return sum;
+}
+
+bool RollupCache::matches(int cid, const RecordFilter &filter) const
+{
+    // 与 SQL 的 JOIN 语义一致：找不到分类的记录不参与统计
+    auto meta = m_categories.constFind(cid);
+    if (meta == m_categories.constEnd()) return false;
+    if (filter.type != -1 && meta->type != filter.type) return false;
+    if (filter.categoryId != -1 && cid != filter.categoryId) return false;
+    return true;
+}
+
+RollupCache::RangeTotal RollupCache::rangeTotal(const Series &series, int fromDay, int toDay) const
+{
+    RangeTotal total;
+    // 换算成序列下标并裁剪到 [0, m_dayCount)
+    qint64 from = qMax<qint64>(qint64(fromDay) - m_firstDay, 0);
+    qint64 to = qMin<qint64>(qint64(toDay) - m_firstDay, m_dayCount - 1);
+    if (from > to) return total;
+
+    total.cents = treePrefix(series.treeCents, int(to + 1)) - treePrefix(series.treeCents, int(from));
+    total.count = treePrefix(series.treeCount, int(to + 1)) - treePrefix(series.treeCount, int(from));
+    return total;
+}
@@ -0,0 +1,116 @@
+#ifndef ROLLUPCACHE_H
+#define ROLLUPCACHE_H
+
+#include <QHash>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "recordfilter.h"
+#include "aggregationservice.h"
+
+class ColumnarSnapshot;
+
+// 常驻内存的“按天 × 按分类”汇总缓存
+// 每个分类一棵以天为下标的树状数组 (Fenwick)，保存金额 (分) 与记录数的前缀和：
+// 任意日期范围 + 类型/分类筛选的汇总为 O(分类数 × log 天数)，不访问 SQLite
+// 单条记录的增删改只是一次点更新，由 DatabaseManager / MainWindow 在数据变化处增量维护
+class RollupCache
+{
+public:
+    // 一条记录对缓存的贡献
+    struct Entry {
+        qint64 timestamp = 0;
+        int cid = -1;
+        qint64 cents = 0;
+    };
+
+    // 时间戳 -> 本地日期的换算游标
+    // 相邻时间戳大多落在同一天，只有跨天时才真正做一次日期换算
+    struct DayCursor {
+        int dayOf(qint64 timestamp);
+    private:
+        qint64 m_start = 1;
+        qint64 m_end = 0;
+        int m_day = 0;
+    };
+
+    // 从数据库全量重建 (db 默认为界面线程的连接；新建的缓存对象也可以在数据库线程上用该线程的连接重建)
+    bool rebuild(const QSqlDatabase &db = QSqlDatabase::database());
+    // 同上，但记录从列式快照顺序扫描 (快照须已与数据库同步)，分类元数据仍从 db 读
+    bool rebuild(const ColumnarSnapshot &columns, const QSqlDatabase &db = QSqlDatabase::database());
+    void clear();
+    bool isReady() const { return m_ready; }
+
+    // 换入另一个缓存 (通常是在数据库线程上刚重建好的) 的内容，other 随之清空
+    void takeFrom(RollupCache &other);
+
+    // 修改计数：每次增量维护或清空都加一 (缓存未就绪时也加)
+    // 后台重建前记下，换入前比较：不一致说明期间有写入，重建的结果已经过时
+    quint64 revision() const { return m_revision; }
+
+    // 增量维护 (缓存未就绪时忽略)
+    void addEntry(const Entry &entry);
+    void removeEntry(const Entry &entry);
+    void addDailyTotal(int day, int cid, qint64 cents, qint64 count); // 批量导入时按 (天, 分类) 合并后写入
+    void addCategory(int id, const QString &name, int type);
+    void moveCategory(int fromId, int toId); // 删除分类但保留账单：记录整体转到目标分类
+    void removeCategory(int id);             // 分类连同账单一起删除
+
+    // 备注搜索无法由按天汇总回答，需要回退到 SQL
+    static bool canAnswer(const RecordFilter &filter) { return filter.noteText.isEmpty(); }
+    AggregateSnapshotPtr snapshot(const RecordFilter &filter) const;
+
+    // 趋势图用的逐天收支合计 (分)：下标 0 对应 fromDay，长度为 toDay - fromDay + 1
+    // 只看筛选条件里的类型/分类，日期范围以参数为准
+    void dailyTotals(const RecordFilter &filter, int fromDay, int toDay,
+                     QVector<qint64> *income, QVector<qint64> *expense) const;
+
+    // 有记录的第一天与最后一天 (儒略日)，缓存为空时返回 false
+    bool dayRange(int *firstDay, int *lastDay) const;
+
+    // 随机抽取筛选条件，与 SQL 的结果逐分类比对 (金额精确到分、记录数)
+    // 返回不一致的描述，全部一致时返回空列表
+    QStringList verifyAgainstSql(int rounds, quint32 seed) const;
+
+    // 从数据库读取某条记录当前的贡献，记录不存在时返回 false
+    static bool loadEntry(qint64 recordId, Entry *entry);
+
+    static int dayOf(qint64 timestamp); // 时间戳对应本地日期的儒略日
+
+private:
+    struct Series {
+        QVector<qint64> dailyCents;  // 每天的原始值
+        QVector<qint64> dailyCount;
+        QVector<qint64> treeCents;   // 树状数组 (下标从 1 开始)
+        QVector<qint64> treeCount;
+    };
+    struct CategoryMeta {
+        QString name;
+        int type = 0;
+    };
+    struct RangeTotal {
+        qint64 cents = 0;
+        qint64 count = 0;
+    };
+
+    bool loadCategories(const QSqlDatabase &db);
+    void buildTrees();
+    void apply(int day, int cid, qint64 cents, qint64 count);
+    void ensureDay(int day);
+    void resizeSeries(Series &series) const;
+    static void buildTree(const QVector<qint64> &daily, QVector<qint64> &tree);
+    static void treeAdd(QVector<qint64> &tree, int index, qint64 delta);
+    static qint64 treePrefix(const QVector<qint64> &tree, int count);
+    RangeTotal rangeTotal(const Series &series, int fromDay, int toDay) const;
+    bool matches(int cid, const RecordFilter &filter) const;
+
+    QHash<int, Series> m_series;           // 分类ID -> 按天序列
+    QHash<int, CategoryMeta> m_categories; // 分类ID -> 名称、类型
+    int m_firstDay = 0;                    // 序列下标 0 对应的儒略日
+    int m_dayCount = 0;
+    bool m_ready = false;
+    quint64 m_revision = 0;
+};
+
+#endif // ROLLUPCACHE_H
@@ -0,0 +1,81 @@
+#include "startupprofiler.h"
+#include <QDebug>
+#include <QVector>
+
+namespace {
+
+struct Sample {
+    const char *name;
+    qint64 us;
+    bool milestone; // true: 距零点的时间; false: 阶段耗时
+};
+
+QElapsedTimer g_clock;
+QVector<Sample> g_samples;
+bool g_enabled = false;
+
+}
+
+StartupProfiler::Phase::Phase(const char *name)
+    : m_name(name)
+{
+    m_timer.start();
+}
+
+StartupProfiler::Phase::~Phase()
+{
+    record(m_name, m_timer.nsecsElapsed() / 1000);
+}
+
+void StartupProfiler::start()
+{
+    g_clock.start();
+    g_samples.clear();
+    g_enabled = g_enabled || qEnvironmentVariableIntValue("FM_STARTUP_TIMING") != 0;
+}
+
+void StartupProfiler::record(const char *name, qint64 us)
+{
+    if (!g_enabled) return;
+    g_samples.append({name, us, false});
+}
+
+void StartupProfiler::mark(const char *milestone)
+{
+    if (!g_enabled) return;
+    g_samples.append({milestone, g_clock.isValid() ? g_clock.nsecsElapsed() / 1000 : 0, true});
+}
+
+qint64 StartupProfiler::elapsedMs()
+{
+    return g_clock.isValid() ? g_clock.elapsed() : 0;
+}
+
+void StartupProfiler::setEnabled(bool enabled)
+{
+    g_enabled = enabled;
+}
+
+bool StartupProfiler::isEnabled()
+{
+    return g_enabled;
+}
+
+void StartupProfiler::finish()
+{
+    if (g_enabled) {
+        qDebug().noquote() << report();
+    }
+    g_samples.clear();
+}
+
+QString StartupProfiler::report()
+{
+    QString text = "Startup timing:";
+    for (const Sample &sample : g_samples) {
+        text += QString("\n  %1 %2 ms")
+                    .arg(sample.milestone ? QString("@ %1").arg(sample.name) : QString(sample.name), -24)
+                    .arg(sample.us / 1000.0, 8, 'f', 1);
+    }
+    return text;
+}
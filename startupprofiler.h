@@ -0,0 +1,39 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+// 冷启动各阶段耗时
+// 以 main() 开头为零点，记录打开数据库、检查表结构、读取分类、建图表、加载表格等阶段各自的耗时，
+// 以及首次绘制、可操作等时间点，用于跟踪大账本上的“启动到可操作”时间
+// 设置环境变量 FM_STARTUP_TIMING=1 或带 --startup-timing 启动时，启动完成后输出；只在界面线程使用
+class StartupProfiler
+{
+public:
+    // 计时一个阶段：构造时开始，析构时记下耗时
+    class Phase
+    {
+    public:
+        explicit Phase(const char *name);
+        ~Phase();
+
+    private:
+        const char *m_name;
+        QElapsedTimer m_timer;
+    };
+
+    static void start();                              // 零点
+    static void record(const char *name, qint64 us);  // 阶段耗时 (如在其他线程上测得的)
+    static void mark(const char *milestone);          // 时间点：距零点多久
+    static qint64 elapsedMs();
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    // 汇总输出 (开启时) 并清空记录
+    static void finish();
+    static QString report();
+};
+
+#endif // STARTUPPROFILER_H
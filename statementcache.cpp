@@ -0,0 +1,59 @@
+#include "statementcache.h"
+#include <QSqlError>
+#include <QDebug>
+
+StatementCache::StatementCache(int capacity)
+    : m_capacity(capacity)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+void StatementCache::setDatabase(const QSqlDatabase &db)
+{
+    clear();
+    m_db = db;
+}
+
+QSqlQuery *StatementCache::prepared(const QString &sql)
+{
+    auto it = m_statements.constFind(sql);
+    if (it != m_statements.constEnd()) {
+        ++m_hits;
+        if (m_lru.last() != sql) {
+            m_lru.removeOne(sql);
+            m_lru.append(sql);
+        }
+
+        // 释放上一次执行留下的游标 (读锁)，再交给调用方重新绑定
+        QSqlQuery *query = it.value();
+        query->finish();
+        return query;
+    }
+
+    ++m_misses;
+    QSqlQuery *query = new QSqlQuery(m_db);
+    query->setForwardOnly(true);
+    if (!query->prepare(sql)) {
+        qDebug() << "Prepare error:" << sql << query->lastError().text();
+        delete query;
+        return nullptr;
+    }
+
+    m_statements.insert(sql, query);
+    m_lru.append(sql);
+    while (m_lru.size() > m_capacity) {
+        delete m_statements.take(m_lru.takeFirst());
+    }
+    return query;
+}
+
+void StatementCache::clear()
+{
+    qDeleteAll(m_statements);
+    m_statements.clear();
+    m_lru.clear();
+}
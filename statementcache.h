@@ -0,0 +1,48 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// 预编译语句缓存 (一个连接一份，只能在该连接所属的线程上使用)
+// 以 SQL 文本为键保存已 prepare 的 QSqlQuery，再次执行同一条语句时直接重新绑定参数，
+// 省去 SQLite 的解析与编译；超出容量时淘汰最久未用的语句
+// 数据库结构变化 (迁移) 后必须 clear()
+class StatementCache
+{
+public:
+    static const int DefaultCapacity = 64;
+
+    explicit StatementCache(int capacity = DefaultCapacity);
+    ~StatementCache();
+
+    // 绑定到一个连接 (重新打开数据库时调用，同时清空缓存)
+    void setDatabase(const QSqlDatabase &db);
+
+    // 取出已 prepare 的只进语句，prepare 失败时返回 nullptr
+    // 返回的语句在下一次取同一条 SQL 之前有效；结果必须在那之前读完
+    // 查询读完 (或只读一行) 后要调用 finish()：缓存里的语句只在再次取出时才重置，
+    // 不 finish 的话连接会一直停在读事务里 (挡住检查点、看不到其他连接的提交)
+    QSqlQuery *prepared(const QString &sql);
+
+    void clear();
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+    int size() const { return m_statements.size(); }
+
+private:
+    Q_DISABLE_COPY(StatementCache)
+
+    QSqlDatabase m_db;
+    int m_capacity;
+    QHash<QString, QSqlQuery *> m_statements;
+    QList<QString> m_lru; // 最近使用的在末尾
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+#endif // STATEMENTCACHE_H
@@ -0,0 +1,73 @@
+#include "storageprofile.h"
+
+StorageProfile StorageProfile::forLevel(Level level)
+{
+    StorageProfile profile;
+    profile.level = level;
+
+    switch (level) {
+    case Safe:
+        profile.wal = false;
+        profile.synchronous = "FULL";
+        profile.cacheKiB = 8 * 1024;
+        profile.mmapBytes = 0;
+        profile.tempInMemory = false;
+        break;
+    case Balanced:
+        break; // 即默认值
+    case Fast:
+        profile.synchronous = "OFF";
+        profile.cacheKiB = 128 * 1024;
+        profile.mmapBytes = 1024LL * 1024 * 1024;
+        profile.pageSize = 8192; // 索引树更矮，范围扫描读的页更少
+        profile.walCheckpointBytes = 64LL * 1024 * 1024;
+        profile.idleCheckpointMs = 5000;
+        break;
+    }
+    return profile;
+}
+
+bool StorageProfile::parse(const QString &name, Level *level)
+{
+    const QString key = name.trimmed().toLower();
+    for (Level candidate : {Safe, Balanced, Fast}) {
+        if (key == StorageProfile::name(candidate)) {
+            *level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString StorageProfile::name(Level level)
+{
+    switch (level) {
+    case Safe: return "safe";
+    case Fast: return "fast";
+    default: return "balanced";
+    }
+}
+
+QStringList StorageProfile::connectionPragmas() const
+{
+    QStringList pragmas = {
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        QString("PRAGMA cache_size = -%1").arg(cacheKiB), // 负数表示 KiB
+        QString("PRAGMA mmap_size = %1").arg(mmapBytes),
+        QString("PRAGMA temp_store = %1").arg(tempInMemory ? "MEMORY" : "DEFAULT")
+    };
+    if (wal) {
+        pragmas << QString("PRAGMA journal_size_limit = %1").arg(walCheckpointBytes);
+    }
+    return pragmas;
+}
+
+QStringList StorageProfile::databasePragmas(bool newDatabase) const
+{
+    QStringList pragmas;
+    if (newDatabase) {
+        pragmas << QString("PRAGMA page_size = %1").arg(pageSize);
+    }
+    pragmas << QString("PRAGMA journal_mode = %1").arg(wal ? "WAL" : "DELETE");
+    return pragmas;
+}
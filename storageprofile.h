@@ -0,0 +1,41 @@
+#ifndef STORAGEPROFILE_H
+#define STORAGEPROFILE_H
+
+#include <QString>
+#include <QStringList>
+
+// SQLite 存储参数，打开数据库时应用
+//   safe     回滚日志 + synchronous=FULL：每次提交都等数据落盘；数据库放在网络盘等不支持 WAL 的位置时使用
+//   balanced WAL + synchronous=NORMAL：提交只写 WAL、不等落盘，断电最多丢最后几次提交但不会损坏；
+//            读不阻塞写 (默认)
+//   fast     WAL + synchronous=OFF，更大的页缓存与内存映射：断电可能丢失较多提交，适合可以重新导入的数据
+// WAL 模式下由 DatabaseManager 在数据库线程上做检查点：写入停下来一会儿之后，或 WAL 超过阈值时
+struct StorageProfile
+{
+    enum Level { Safe, Balanced, Fast };
+
+    Level level = Balanced;
+    bool wal = true;
+    QString synchronous = "NORMAL";
+    int cacheKiB = 32 * 1024;                   // 每个连接的页缓存
+    qint64 mmapBytes = 256LL * 1024 * 1024;     // 内存映射读取的上限，0 为不映射
+    bool tempInMemory = true;                   // 排序、分组的临时表放内存
+    int pageSize = 4096;                        // 只对新建的数据库生效
+    qint64 walCheckpointBytes = 16LL * 1024 * 1024; // WAL 超过此大小立即检查点，之后截断到此大小
+    int idleCheckpointMs = 2000;                // 最后一次写入之后多久做检查点
+
+    static StorageProfile forLevel(Level level);
+
+    // "safe" / "balanced" / "fast" (不区分大小写)，无法识别时返回 false
+    static bool parse(const QString &name, Level *level);
+    static QString name(Level level);
+
+    // 每个连接都要设置的参数
+    QStringList connectionPragmas() const;
+
+    // 数据库文件级的参数，只在主连接上、其他连接打开之前设置
+    // 页大小只能在建表之前设置，newDatabase 为 true 时才带上
+    QStringList databasePragmas(bool newDatabase) const;
+};
+
+#endif // STORAGEPROFILE_H
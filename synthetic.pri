@@ -0,0 +1,6 @@
+# 可复现的合成账本 (基准测试与 tools/datagen 共用)，需要先 include core.pri
+SOURCES += \
+    $$PWD/syntheticledger.cpp
+
+HEADERS += \
+    $$PWD/syntheticledger.h
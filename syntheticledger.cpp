@@ -0,0 +1,433 @@
+#include "syntheticledger.h"
+#include "csvformat.h"
+#include "databasemanager.h"
+#include "money.h"
+#include "recordfilter.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+const char kConnection[] = "synthetic_ledger";
+
+// 1970-01-01 的儒略日：UTC 日期与时间戳直接换算
+const qint64 kUnixEpochJulianDay = 2440588;
+
+// 生成规则变化时加一，缓存文件随之失效
+const quint32 kGeneratorVersion = 2;
+
+// 每块的行数：块是并行生成与随机数播种的单位，与线程数无关，保证结果可复现
+const qint64 kChunkRows = 16384;
+
+// 每条 INSERT 的行数 (字面量 VALUES，不绑定参数，不受参数个数上限约束)
+const int kStatementRows = 512;
+
+// 默认分类之外补充的分类，凑成 14 个支出 + 6 个收入
+const char *const kExtraExpenses[] = {
+    "医疗健康", "教育培训", "服饰美容", "通讯网络", "人情往来",
+    "旅行度假", "宠物花草", "数码电器", "运动健身"
+};
+const char *const kExtraIncomes[] = {"兼职外快", "报销款", "红包礼金"};
+
+const char *const kExpenseNotes[] = {
+    "早餐", "午饭", "晚饭", "午饭钱", "周末聚餐", "外卖", "咖啡", "奶茶", "超市采购", "菜市场买菜",
+    "地铁", "公交", "打车回家", "加油", "停车费", "高铁票", "水电费", "燃气费", "房租", "物业费",
+    "话费充值", "宽带续费", "网购", "电影票", "演唱会门票", "快递", "药店买药", "体检", "健身房月卡",
+    "理发", "给朋友的生日礼物", "随份子", "孩子补习班", "宠物粮", "手机壳"
+};
+const char *const kIncomeNotes[] = {
+    "工资", "年终奖", "季度奖金", "绩效奖金", "理财收益", "基金分红", "兼职稿费", "差旅报销", "红包", "退款"
+};
+// 部分备注带一个修饰词，让全文索引的词汇更接近真实账本
+const char *const kNoteModifiers[] = {"和同事", "和家人", "周末", "出差", "加班", "双十一", "春节"};
+
+// 各月支出金额的倍数 (春节、暑期、双十一、年末)
+const double kExpenseSeason[12] = {1.5, 1.6, 0.9, 0.9, 1.0, 1.0, 1.2, 1.2, 1.0, 1.1, 1.4, 1.2};
+
+// 生成一块所需的全部只读参数
+struct Plan {
+    SyntheticLedger::Options options;
+    qint64 firstTimestamp = 0;
+    double step = 0;               // 相邻记录的平均时间间隔 (秒)
+    QVector<int> expenseIds;       // 按冷热顺序排列
+    QVector<int> incomeIds;
+    QVector<double> expenseWeights; // 累计权重，末项为 1
+    QVector<double> incomeWeights;
+    QHash<int, QByteArray> names;  // CSV 用：分类名
+};
+
+struct ChunkOutput {
+    QStringList statements;
+    QByteArray csv;
+};
+
+QVector<double> cumulativeWeights(int count, double skew)
+{
+    QVector<double> weights(count);
+    double total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += 1.0 / std::pow(i + 1, skew);
+        weights[i] = total;
+    }
+    for (double &weight : weights) weight /= total;
+    return weights;
+}
+
+int pick(const QVector<double> &cumulative, double u)
+{
+    int index = int(std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+    return qMin(index, int(cumulative.size()) - 1);
+}
+
+ChunkOutput makeChunk(const Plan &plan, qint64 chunk)
+{
+    const SyntheticLedger::Options &options = plan.options;
+
+    // 每块独立播种：与哪个线程、以什么顺序生成无关
+    const quint32 seeds[4] = {options.seed, quint32(chunk), quint32(quint64(chunk) >> 32), kGeneratorVersion};
+    QRandomGenerator rng(seeds, 4);
+
+    qint64 first = chunk * kChunkRows;
+    qint64 count = qMin(kChunkRows, options.rows - first);
+
+    ChunkOutput output;
+    QString sql;
+    CsvFormat::TimeFormatter formatter;
+
+    for (qint64 r = 0; r < count; ++r) {
+        qint64 i = first + r;
+        // 按时间顺序均匀铺开，每条在自己的时间片内随机偏移
+        qint64 timestamp = plan.firstTimestamp + qint64((double(i) + rng.generateDouble()) * plan.step);
+        QDate day = QDate::fromJulianDay(kUnixEpochJulianDay + timestamp / 86400); // UTC 日期，与时区无关
+
+        bool income = int(rng.bounded(100)) < options.incomePercent;
+        int rank = pick(income ? plan.incomeWeights : plan.expenseWeights, rng.generateDouble());
+        int cid = income ? plan.incomeIds[rank] : plan.expenseIds[rank];
+
+        qint64 cents;
+        if (income) {
+            // 排第一的收入分类 (工资) 金额大且稳定，其余较小
+            cents = rank == 0 ? 500000 + rng.bounded(1500000) : 10000 + rng.bounded(490000);
+            if (options.seasonal && day.month() == 1) cents *= 2; // 年终奖
+        } else {
+            // 小额居多，偶有大额
+            double amount = 100 + std::pow(rng.generateDouble(), 3) * 500000;
+            if (options.seasonal) {
+                amount *= kExpenseSeason[day.month() - 1];
+                if (day.dayOfWeek() >= 6) amount *= 1.25; // 周末
+            }
+            cents = qint64(amount);
+        }
+
+        // 备注统一存空串而不是 NULL (与 v3 迁移一致)
+        QString note("");
+        if (int(rng.bounded(100)) < options.notePercent) {
+            note = income ? QString::fromUtf8(kIncomeNotes[rng.bounded(int(std::size(kIncomeNotes)))])
+                          : QString::fromUtf8(kExpenseNotes[rng.bounded(int(std::size(kExpenseNotes)))]);
+            if (rng.bounded(10) < 3) {
+                note = QString::fromUtf8(kNoteModifiers[rng.bounded(int(std::size(kNoteModifiers)))]) + " " + note;
+            }
+        }
+
+        if (r % kStatementRows == 0) {
+            if (!sql.isEmpty()) output.statements << sql;
+            sql = "INSERT INTO record (amount_cents, timestamp, note, cid) VALUES ";
+        } else {
+            sql += ", ";
+        }
+        sql += QString("(%1, %2, %3, %4)").arg(cents).arg(timestamp).arg(RecordFilter::quoted(note)).arg(cid);
+
+        if (!options.csvPath.isEmpty()) {
+            // 新表的自增 ID 从 1 开始按插入顺序分配
+            output.csv += QByteArray::number(i + 1);
+            output.csv += ',';
+            Money::append(output.csv, cents);
+            output.csv += ',';
+            formatter.append(output.csv, timestamp);
+            output.csv += ',';
+            CsvFormat::appendField(output.csv, note);
+            output.csv += ',';
+            CsvFormat::appendField(output.csv, plan.names.value(cid));
+            output.csv += income ? "收入\r\n" : "支出\r\n";
+        }
+    }
+    if (!sql.isEmpty()) output.statements << sql;
+    return output;
+}
+
+bool execAll(QSqlQuery &query, const QStringList &statements, QString *error)
+{
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            *error = sql.left(200) + ": " + query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// 补充分类并读出全部分类，按 ID 顺序即冷热顺序
+QString loadCategories(QSqlQuery &query, Plan &plan)
+{
+    query.prepare("INSERT INTO category (name, type) VALUES (?, ?)");
+    for (const char *name : kExtraExpenses) {
+        query.addBindValue(QString::fromUtf8(name));
+        query.addBindValue(0);
+        if (!query.exec()) return query.lastError().text();
+    }
+    for (const char *name : kExtraIncomes) {
+        query.addBindValue(QString::fromUtf8(name));
+        query.addBindValue(1);
+        if (!query.exec()) return query.lastError().text();
+    }
+
+    if (!query.exec("SELECT id, name, type FROM category ORDER BY id")) return query.lastError().text();
+    while (query.next()) {
+        int id = query.value(0).toInt();
+        (query.value(2).toInt() == 1 ? plan.incomeIds : plan.expenseIds).append(id);
+        plan.names.insert(id, query.value(1).toString().toUtf8());
+    }
+    if (plan.expenseIds.isEmpty() || plan.incomeIds.isEmpty()) return "missing categories";
+
+    plan.expenseWeights = cumulativeWeights(plan.expenseIds.size(), plan.options.categorySkew);
+    plan.incomeWeights = cumulativeWeights(plan.incomeIds.size(), plan.options.categorySkew);
+    return QString();
+}
+
+// 向已建好表结构的空库写入分类与记录，失败时返回错误描述
+QString fill(QSqlDatabase &db, const SyntheticLedger::Options &options, SyntheticLedger::Stats *stats)
+{
+    QString error;
+    QSqlQuery query(db);
+    QElapsedTimer timer;
+    timer.start();
+
+    // 一次性生成的文件，不需要崩溃保护
+    if (!execAll(query, {"PRAGMA journal_mode = OFF", "PRAGMA synchronous = OFF",
+                         "PRAGMA cache_size = -262144"}, &error)) {
+        return error;
+    }
+
+    Plan plan;
+    plan.options = options;
+    plan.firstTimestamp = SyntheticLedger::firstTimestamp(options);
+    plan.step = double(SyntheticLedger::lastTimestamp(options) - plan.firstTimestamp + 1) / qMax<qint64>(options.rows, 1);
+    error = loadCategories(query, plan);
+    if (!error.isEmpty()) return error;
+
+    // 先拆掉 record 上的二级索引与触发器，写完再按原定义重建 (排序建索引比逐行维护快得多)
+    QStringList drops;
+    QStringList recreates;
+    if (!query.exec("SELECT type, name, sql FROM sqlite_master "
+                    "WHERE tbl_name = 'record' AND type IN ('index', 'trigger') AND sql IS NOT NULL")) {
+        return query.lastError().text();
+    }
+    while (query.next()) {
+        drops << QString("DROP %1 %2").arg(query.value(0).toString().toUpper(), query.value(1).toString());
+        recreates << query.value(2).toString();
+    }
+    if (!execAll(query, drops, &error)) return error;
+
+    QSaveFile csv(options.csvPath);
+    if (!options.csvPath.isEmpty()) {
+        if (!csv.open(QIODevice::WriteOnly)) return "无法创建文件：" + csv.errorString();
+        csv.write(CsvFormat::exportHeader());
+    }
+
+    // 各线程并行生成一批块 (SQL 文本与 CSV)，本线程按块顺序写入上一批，内存占用只有两批
+    const qint64 chunkCount = (options.rows + kChunkRows - 1) / kChunkRows;
+    const qint64 waveChunks = qMax(2, QThread::idealThreadCount());
+    auto startWave = [&plan, chunkCount, waveChunks](qint64 firstChunk) {
+        QList<qint64> chunks;
+        for (qint64 c = firstChunk; c < qMin(chunkCount, firstChunk + waveChunks); ++c) chunks << c;
+        const Plan *shared = &plan;
+        return QtConcurrent::mapped(chunks, [shared](qint64 chunk) { return makeChunk(*shared, chunk); });
+    };
+
+    db.transaction();
+    qint64 nextChunk = 0;
+    QFuture<ChunkOutput> pending = startWave(nextChunk);
+    nextChunk += waveChunks;
+    bool more = chunkCount > 0;
+    while (more) {
+        const QList<ChunkOutput> outputs = pending.results();
+        more = nextChunk < chunkCount;
+        if (more) {
+            pending = startWave(nextChunk);
+            nextChunk += waveChunks;
+        }
+
+        for (const ChunkOutput &output : outputs) {
+            if (!execAll(query, output.statements, &error)) break;
+            if (!options.csvPath.isEmpty() && csv.write(output.csv) != output.csv.size()) {
+                error = "写入失败：" + csv.errorString();
+                break;
+            }
+        }
+        if (!error.isEmpty()) break;
+    }
+    pending.waitForFinished();
+
+    if (!error.isEmpty()) {
+        db.rollback();
+        return error;
+    }
+    if (!db.commit()) return db.lastError().text();
+    if (!options.csvPath.isEmpty() && !csv.commit()) return "写入失败：" + csv.errorString();
+    if (stats) stats->insertMs = timer.restart();
+
+    // 重建索引与触发器，再为全文索引补上全部备注
+    if (!execAll(query, recreates, &error)) return error;
+    if (query.exec("SELECT 1 FROM sqlite_master WHERE name = 'record_fts'") && query.next()) {
+        if (!execAll(query, {"INSERT INTO record_fts(record_fts) VALUES ('rebuild')"}, &error)) return error;
+    }
+    if (!execAll(query, {"ANALYZE"}, &error)) return error;
+    if (stats) stats->indexMs = timer.elapsed();
+    return QString();
+}
+
+} // namespace
+
+qint64 SyntheticLedger::firstTimestamp(const Options &options)
+{
+    return (options.firstDay.toJulianDay() - kUnixEpochJulianDay) * 86400;
+}
+
+qint64 SyntheticLedger::lastTimestamp(const Options &options)
+{
+    return (options.lastDay.toJulianDay() - kUnixEpochJulianDay) * 86400 + 86399;
+}
+
+bool SyntheticLedger::generate(const QString &path, const Options &options, QString *error, Stats *stats)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QFile::remove(path);
+
+    // 空库先走一遍正常的打开流程：建表、默认分类、索引、全文索引都与真实账本一致
+    DatabaseManager &manager = DatabaseManager::instance();
+    bool created = manager.openDatabase(path);
+    manager.closeDatabase();
+    if (!created) {
+        if (error) *error = "cannot create schema";
+        return false;
+    }
+
+    QString message;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", kConnection);
+        db.setDatabaseName(path);
+        if (db.open()) {
+            message = fill(db, options, stats);
+        } else {
+            message = db.lastError().text();
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(kConnection);
+
+    if (stats) stats->totalMs = timer.elapsed();
+    if (!message.isEmpty()) {
+        if (error) *error = message;
+        return false;
+    }
+    return true;
+}
+
+QString SyntheticLedger::ensure(const QString &dir, qint64 rows, quint32 seed)
+{
+    QDir().mkpath(dir);
+
+    // 文件名带上生成规则与表结构的版本，任何一个变化都会重新生成
+    QString name = QString("ledger-g%1-s%2-%3-%4.db")
+                       .arg(kGeneratorVersion)
+                       .arg(DatabaseManager::latestSchemaVersion())
+                       .arg(sizeLabel(rows))
+                       .arg(seed);
+    QString path = QDir(dir).filePath(name);
+    if (QFileInfo::exists(path)) return path;
+
+    Options options;
+    options.rows = rows;
+    options.seed = seed;
+
+    QString partial = path + ".part";
+    QString error;
+    qInfo().noquote() << "Generating synthetic ledger" << path;
+    if (!generate(partial, options, &error) || !QFile::rename(partial, path)) {
+        qWarning().noquote() << "Synthetic ledger generation failed:" << error;
+        QFile::remove(partial);
+        return QString();
+    }
+    return path;
+}
+
+QString SyntheticLedger::ensureCsv(const QString &dir, qint64 rows, quint32 seed)
+{
+    QDir().mkpath(dir);
+
+    // CSV 与表结构无关，文件名只带生成规则的版本
+    QString name = QString("ledger-g%1-%2-%3.csv").arg(kGeneratorVersion).arg(sizeLabel(rows)).arg(seed);
+    QString path = QDir(dir).filePath(name);
+    if (QFileInfo::exists(path)) return path;
+
+    Options options;
+    options.rows = rows;
+    options.seed = seed;
+    options.csvPath = path; // QSaveFile 写出，生成完成才出现
+
+    // 顺带生成的账本用不到，写到临时文件后删掉
+    QString scratch = path + ".db.part";
+    QString error;
+    qInfo().noquote() << "Generating synthetic csv" << path;
+    bool ok = generate(scratch, options, &error);
+    for (const QString &suffix : {QString(), QString("-wal"), QString("-shm"), QString("-edits")}) {
+        QFile::remove(scratch + suffix);
+    }
+    if (!ok) {
+        qWarning().noquote() << "Synthetic csv generation failed:" << error;
+        QFile::remove(path);
+        return QString();
+    }
+    return path;
+}
+
+qint64 SyntheticLedger::parseSize(const QString &text)
+{
+    QString value = text.trimmed().toLower();
+    qint64 unit = 1;
+    if (value.endsWith('k')) {
+        unit = 1000;
+        value.chop(1);
+    } else if (value.endsWith('m')) {
+        unit = 1000000;
+        value.chop(1);
+    }
+
+    bool ok = false;
+    qint64 count = value.toLongLong(&ok);
+    return ok && count > 0 ? count * unit : -1;
+}
+
+QString SyntheticLedger::sizeLabel(qint64 rows)
+{
+    if (rows >= 1000000 && rows % 1000000 == 0) return QString("%1M").arg(rows / 1000000);
+    if (rows >= 1000 && rows % 1000 == 0) return QString("%1k").arg(rows / 1000);
+    return QString::number(rows);
+}
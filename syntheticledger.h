@@ -0,0 +1,52 @@
+#ifndef SYNTHETICLEDGER_H
+#define SYNTHETICLEDGER_H
+
+#include <QDate>
+#include <QString>
+
+// 可复现的合成账本 (基准测试与压测数据生成工具共用)
+// 相同的参数在任何机器、任何时区、任何线程数下生成的内容完全相同：
+// 记录按时间均匀分布 (日期按 UTC 计)，分类冷热不均，金额随季节变化，备注取自常见的中文消费描述
+namespace SyntheticLedger
+{
+    const quint32 DefaultSeed = 20240601;
+
+    struct Options {
+        qint64 rows = 10000;
+        quint32 seed = DefaultSeed;
+        QDate firstDay = QDate(2016, 1, 1);  // 时间范围 (UTC 日期，含首尾两天)
+        QDate lastDay = QDate(2025, 12, 31);
+        int incomePercent = 20;              // 收入记录占比
+        double categorySkew = 1.0;           // 分类冷热：0 为均匀，越大越集中在靠前的分类 (Zipf 指数)
+        int notePercent = 70;                // 带备注的记录占比
+        bool seasonal = true;                // 金额随季节变化：春节、暑期、双十一消费更多，一月发年终奖
+        QString csvPath;                     // 非空时同时写出同样内容的 CSV (导出格式，可直接导入)
+    };
+
+    // 各阶段耗时
+    struct Stats {
+        qint64 insertMs = 0;  // 生成并写入记录
+        qint64 indexMs = 0;   // 重建索引、全文索引与统计信息
+        qint64 totalMs = 0;
+    };
+
+    // 数据的时间范围 (Unix 时间戳，秒)
+    qint64 firstTimestamp(const Options &options = Options());
+    qint64 lastTimestamp(const Options &options = Options());
+
+    // 在 path 生成账本 (覆盖已有文件)
+    // 表结构由 DatabaseManager 的迁移创建，生成期间会占用 DatabaseManager (调用前须关闭已打开的数据库)
+    bool generate(const QString &path, const Options &options, QString *error = nullptr, Stats *stats = nullptr);
+
+    // 缓存目录下对应的账本文件 (其余参数取默认值)，不存在时先生成；失败时返回空字符串
+    // 生成先写入临时文件，完成后才改名，中途中断不会留下不完整的缓存
+    QString ensure(const QString &dir, qint64 rows, quint32 seed = DefaultSeed);
+    // 同上，内容相同的 CSV (导出格式，用于导入基准)
+    QString ensureCsv(const QString &dir, qint64 rows, quint32 seed = DefaultSeed);
+
+    // 行数的书写形式："10k"、"1M"、"10000" 互相转换，无法解析时返回 -1
+    qint64 parseSize(const QString &text);
+    QString sizeLabel(qint64 rows);
+}
+
+#endif // SYNTHETICLEDGER_H
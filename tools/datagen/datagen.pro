@@ -0,0 +1,16 @@
+# 压测数据生成工具 (命令行)
+# 例：datagen -n 10M -o finance.db --csv finance.csv；全部参数见 datagen --help
+QT += sql concurrent
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = datagen
+
+# 表结构来自账本核心的迁移，生成规则与基准测试相同
+include(../../core.pri)
+include(../../synthetic.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,20 @@
+// 命令行报表/导出工具：只链接账本核心，参数与 FinanceManager --report / --export 相同
+// 不带 --report / --export 时默认输出报表
+
+#include <QCoreApplication>
+#include "headlessreport.h"
+#include "startupprofiler.h"
+
+int main(int argc, char *argv[])
+{
+    StartupProfiler::start();
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("fmreport");
+
+    QStringList arguments = app.arguments();
+    if (!HeadlessReport::isRequested(argc, argv) && !arguments.contains("--help") && !arguments.contains("-h")) {
+        arguments.insert(1, "--report");
+    }
+    return HeadlessReport::run(arguments);
+}
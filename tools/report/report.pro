@@ -0,0 +1,15 @@
+# 命令行报表/导出 (与 FinanceManager --report / --export 相同)，不依赖界面模块
+# 供没有图形环境的服务器上的定时任务使用，例：fmreport --report --monthly --db finance.db
+QT += sql concurrent
+QT -= gui widgets
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = fmreport
+
+# 报表与导出都在账本核心里 (headlessreport.cpp)
+include(../../core.pri)
+
+SOURCES += \
+    main.cpp
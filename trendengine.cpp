@@ -0,0 +1,260 @@
+#include "trendengine.h"
+#include "ledgerqueries.h"
+#include "rollupcache.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+// 自动粒度的分界 (天数)：按日约两个月内，按周一年内，按月十年内，再长按年
+const int kMaxDailySpan = 62;
+const int kMaxWeeklySpan = 366;
+const int kMaxMonthlySpan = 3653;
+
+QDate bucketStart(const QDate &date, TrendGranularity granularity)
+{
+    switch (granularity) {
+    case TrendGranularity::Week:
+        return date.addDays(1 - date.dayOfWeek());
+    case TrendGranularity::Month:
+        return QDate(date.year(), date.month(), 1);
+    case TrendGranularity::Year:
+        return QDate(date.year(), 1, 1);
+    default:
+        return date;
+    }
+}
+
+QDate nextBucket(const QDate &start, TrendGranularity granularity)
+{
+    switch (granularity) {
+    case TrendGranularity::Week:
+        return start.addDays(7);
+    case TrendGranularity::Month:
+        return start.addMonths(1);
+    case TrendGranularity::Year:
+        return start.addYears(1);
+    default:
+        return start.addDays(1);
+    }
+}
+
+// 把逐天的合计折进所属时间段
+// 时间段在构造时一次排好，之后每天只是一次下标换算，不需要查找
+class BucketFolder
+{
+public:
+    BucketFolder(const QDate &from, const QDate &to, TrendGranularity granularity)
+        : m_granularity(granularity == TrendGranularity::Auto
+                            ? TrendEngine::chooseGranularity(from, to) : granularity)
+    {
+        if (!from.isValid() || !to.isValid() || from > to) return;
+
+        m_first = bucketStart(from, m_granularity);
+        m_firstDay = m_first.toJulianDay();
+        for (QDate start = m_first; start <= to; start = nextBucket(start, m_granularity)) {
+            TrendBucket bucket;
+            bucket.start = start;
+            m_buckets.append(bucket);
+        }
+    }
+
+    void addDay(qint64 day, qint64 incomeCents, qint64 expenseCents)
+    {
+        int index = indexOf(day);
+        if (index < 0 || index >= m_buckets.size()) return;
+        m_buckets[index].incomeCents += incomeCents;
+        m_buckets[index].expenseCents += expenseCents;
+    }
+
+    TrendSeriesPtr finish()
+    {
+        return TrendSeriesPtr(new TrendSeries(m_granularity, std::move(m_buckets)));
+    }
+
+private:
+    int indexOf(qint64 day) const
+    {
+        if (m_buckets.isEmpty() || day < m_firstDay) return -1;
+
+        switch (m_granularity) {
+        case TrendGranularity::Week:
+            return int((day - m_firstDay) / 7);
+        case TrendGranularity::Month: {
+            QDate date = QDate::fromJulianDay(day);
+            return (date.year() - m_first.year()) * 12 + date.month() - m_first.month();
+        }
+        case TrendGranularity::Year:
+            return QDate::fromJulianDay(day).year() - m_first.year();
+        default:
+            return int(day - m_firstDay);
+        }
+    }
+
+    TrendGranularity m_granularity;
+    QDate m_first;
+    qint64 m_firstDay = 0;
+    QVector<TrendBucket> m_buckets;
+};
+
+} // namespace
+
+TrendSeries::TrendSeries(TrendGranularity granularity, QVector<TrendBucket> buckets)
+    : m_granularity(granularity)
+    , m_buckets(std::move(buckets))
+{
+    for (const TrendBucket &bucket : m_buckets) {
+        m_maxCents = qMax(m_maxCents, qMax(bucket.incomeCents, bucket.expenseCents));
+    }
+}
+
+QString TrendSeries::label(int index) const
+{
+    const QDate &start = m_buckets.at(index).start;
+    switch (m_granularity) {
+    case TrendGranularity::Month:
+        return start.toString("yyyy-MM");
+    case TrendGranularity::Year:
+        return start.toString("yyyy");
+    default:
+        return start.toString("M/d"); // 按日、按周 (周一的日期)
+    }
+}
+
+TrendGranularity TrendEngine::chooseGranularity(const QDate &from, const QDate &to)
+{
+    if (!from.isValid() || !to.isValid()) return TrendGranularity::Month;
+
+    qint64 span = from.daysTo(to) + 1;
+    if (span <= kMaxDailySpan) return TrendGranularity::Day;
+    if (span <= kMaxWeeklySpan) return TrendGranularity::Week;
+    if (span <= kMaxMonthlySpan) return TrendGranularity::Month;
+    return TrendGranularity::Year;
+}
+
+TrendSeriesPtr TrendEngine::computeRollup(const RollupCache &rollup, const RecordFilter &filter,
+                                          TrendGranularity granularity)
+{
+    // 不限日期的一端取数据实际覆盖的范围
+    int firstDay = 0;
+    int lastDay = 0;
+    bool hasData = rollup.dayRange(&firstDay, &lastDay);
+    QDate from = filter.startDate.isValid() ? filter.startDate
+                                            : (hasData ? QDate::fromJulianDay(firstDay) : QDate());
+    QDate to = filter.endDate.isValid() ? filter.endDate
+                                        : (hasData ? QDate::fromJulianDay(lastDay) : QDate());
+
+    BucketFolder folder(from, to, granularity);
+    if (!from.isValid() || !to.isValid() || from > to) return folder.finish();
+
+    int fromDay = int(from.toJulianDay());
+    QVector<qint64> income;
+    QVector<qint64> expense;
+    rollup.dailyTotals(filter, fromDay, int(to.toJulianDay()), &income, &expense);
+
+    for (int i = 0; i < income.size(); ++i) {
+        if (income[i] != 0 || expense[i] != 0) {
+            folder.addDay(fromDay + i, income[i], expense[i]);
+        }
+    }
+    return folder.finish();
+}
+
+TrendSeriesPtr TrendEngine::computeSql(const RecordFilter &filter, TrendGranularity granularity,
+                                       const QSqlDatabase &db)
+{
+    struct DayTotal {
+        qint64 day;
+        int type;
+        qint64 cents;
+    };
+    QVector<DayTotal> days;
+    qint64 minDay = LLONG_MAX;
+    qint64 maxDay = LLONG_MIN;
+
+    // 一条按 (天, 收支类型) 分组的查询，时间段在内存里再折叠 (按周分组用 SQL 表达不便)
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (query.exec(LedgerQueries::dailyTotals(filter))) {
+        while (query.next()) {
+            DayTotal total;
+            total.day = query.value(0).toLongLong();
+            total.type = query.value(1).toInt();
+            total.cents = query.value(2).toLongLong();
+            days.append(total);
+            minDay = qMin(minDay, total.day);
+            maxDay = qMax(maxDay, total.day);
+        }
+    } else {
+        qDebug() << "Trend query error:" << query.lastError().text();
+    }
+
+    bool hasData = !days.isEmpty();
+    QDate from = filter.startDate.isValid() ? filter.startDate
+                                            : (hasData ? QDate::fromJulianDay(minDay) : QDate());
+    QDate to = filter.endDate.isValid() ? filter.endDate
+                                        : (hasData ? QDate::fromJulianDay(maxDay) : QDate());
+
+    BucketFolder folder(from, to, granularity);
+    for (const DayTotal &total : days) {
+        if (total.type == 1) {
+            folder.addDay(total.day, total.cents, 0);
+        } else {
+            folder.addDay(total.day, 0, total.cents);
+        }
+    }
+    return folder.finish();
+}
+
+QVector<QPointF> TrendEngine::downsampleLttb(const QVector<QPointF> &points, int threshold)
+{
+    int n = points.size();
+    if (threshold < 3 || n <= threshold) return points;
+
+    QVector<QPointF> sampled;
+    sampled.reserve(threshold);
+    sampled.append(points.first());
+
+    // 首尾之外的点均分成 threshold - 2 段，每段选出一个点
+    double every = double(n - 2) / (threshold - 2);
+    int selected = 0;
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        // 下一段的平均点作为三角形的第三个顶点
+        int avgStart = int(std::floor((i + 1) * every)) + 1;
+        int avgEnd = qMin(int(std::floor((i + 2) * every)) + 1, n);
+        double avgX = 0;
+        double avgY = 0;
+        for (int j = avgStart; j < avgEnd; ++j) {
+            avgX += points[j].x();
+            avgY += points[j].y();
+        }
+        int avgCount = qMax(1, avgEnd - avgStart);
+        avgX /= avgCount;
+        avgY /= avgCount;
+
+        // 当前段里与上一个选中点、下一段平均点围成面积最大的点
+        int rangeStart = int(std::floor(i * every)) + 1;
+        int rangeEnd = int(std::floor((i + 1) * every)) + 1;
+        const QPointF &a = points[selected];
+        double maxArea = -1;
+        int next = rangeStart;
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            double area = std::abs((a.x() - avgX) * (points[j].y() - a.y())
+                                   - (a.x() - points[j].x()) * (avgY - a.y()));
+            if (area > maxArea) {
+                maxArea = area;
+                next = j;
+            }
+        }
+
+        sampled.append(points[next]);
+        selected = next;
+    }
+
+    sampled.append(points.last());
+    return sampled;
+}
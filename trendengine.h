@@ -0,0 +1,74 @@
+#ifndef TRENDENGINE_H
+#define TRENDENGINE_H
+
+#include <QDate>
+#include <QPointF>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include "recordfilter.h"
+
+class RollupCache;
+
+// 趋势图的时间粒度
+enum class TrendGranularity {
+    Auto,   // 按筛选范围的长度自动选择
+    Day,
+    Week,   // 周一开始
+    Month,
+    Year
+};
+
+// 一个时间段的收支合计 (分)
+struct TrendBucket
+{
+    QDate start;              // 时间段第一天
+    qint64 incomeCents = 0;
+    qint64 expenseCents = 0;
+};
+
+// 一次筛选的收支趋势，构造后只读
+class TrendSeries
+{
+public:
+    TrendSeries() = default;
+    TrendSeries(TrendGranularity granularity, QVector<TrendBucket> buckets);
+
+    TrendGranularity granularity() const { return m_granularity; }
+    const QVector<TrendBucket> &buckets() const { return m_buckets; }
+    qint64 maxCents() const { return m_maxCents; } // 单个时间段收入或支出的最大值
+
+    // 时间段的坐标轴标签，例如 "3/14"、"2024-03"、"2024"
+    QString label(int index) const;
+
+private:
+    TrendGranularity m_granularity = TrendGranularity::Day;
+    QVector<TrendBucket> m_buckets;
+    qint64 m_maxCents = 0;
+};
+
+using TrendSeriesPtr = QSharedPointer<const TrendSeries>;
+
+// 收支趋势引擎：把筛选范围内的记录按天汇总一遍，再折进各时间段
+// 没有备注搜索时直接读按天汇总缓存；否则用一条按天分组的 SQL 在数据库线程上算
+class TrendEngine
+{
+public:
+    // 范围越长粒度越粗，保证自动模式下时间段数量适中
+    static TrendGranularity chooseGranularity(const QDate &from, const QDate &to);
+
+    // 只能在界面线程调用 (缓存不是线程安全的)，调用前确认 RollupCache::canAnswer(filter)
+    static TrendSeriesPtr computeRollup(const RollupCache &rollup, const RecordFilter &filter,
+                                        TrendGranularity granularity);
+
+    // 只用 SQL，可在任意线程上用该线程自己的连接调用
+    static TrendSeriesPtr computeSql(const RecordFilter &filter, TrendGranularity granularity,
+                                     const QSqlDatabase &db);
+
+    // 最大三角形三桶降采样 (LTTB)：保留首尾点，在每个分段里选与相邻点围成三角形面积最大的点
+    // 点数不超过 threshold 时原样返回；points 须按 x 升序
+    static QVector<QPointF> downsampleLttb(const QVector<QPointF> &points, int threshold);
+};
+
+#endif // TRENDENGINE_H
@@ -0,0 +1,56 @@
+#include "uistallmonitor.h"
+#include <QDebug>
+
+UiStallMonitor::UiStallMonitor(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(TickMs);
+    connect(&m_timer, &QTimer::timeout, this, &UiStallMonitor::onTick);
+
+    reset();
+    m_timer.start();
+}
+
+UiStallMonitor::~UiStallMonitor()
+{
+    qDebug().noquote() << report();
+}
+
+bool UiStallMonitor::isEnabled()
+{
+#ifdef QT_DEBUG
+    return true;
+#else
+    return qEnvironmentVariableIntValue("FM_STALL_MONITOR") != 0;
+#endif
+}
+
+void UiStallMonitor::reset()
+{
+    m_totalStallMs = 0;
+    m_maxStallMs = 0;
+    m_stallCount = 0;
+    m_clock.start();
+    m_uptime.start();
+}
+
+QString UiStallMonitor::report() const
+{
+    return QString("UI stalls: %1 ms total over %2 s, %3 stalls > %4 ms, longest %5 ms")
+        .arg(m_totalStallMs)
+        .arg(m_uptime.elapsed() / 1000.0, 0, 'f', 1)
+        .arg(m_stallCount)
+        .arg(StallThresholdMs)
+        .arg(m_maxStallMs);
+}
+
+void UiStallMonitor::onTick()
+{
+    qint64 late = m_clock.restart() - TickMs;
+    if (late <= StallThresholdMs) return;
+
+    m_totalStallMs += late;
+    m_maxStallMs = qMax(m_maxStallMs, late);
+    ++m_stallCount;
+}
@@ -0,0 +1,44 @@
+#ifndef UISTALLMONITOR_H
+#define UISTALLMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+
+// 界面卡顿统计
+// 在界面线程上跑一个 16ms 的定时器：事件循环被阻塞时定时器会迟到，
+// 迟到超过阈值的部分就是用户感受到的卡顿时间
+// 调试构建默认开启，发布构建设置环境变量 FM_STALL_MONITOR=1 开启；退出时输出汇总
+class UiStallMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int TickMs = 16;          // 一帧
+    static const int StallThresholdMs = 50; // 迟到超过此值才算卡顿
+
+    explicit UiStallMonitor(QObject *parent = nullptr);
+    ~UiStallMonitor() override;
+
+    static bool isEnabled();
+
+    void reset();
+    QString report() const;
+
+    qint64 totalStallMs() const { return m_totalStallMs; }
+    qint64 maxStallMs() const { return m_maxStallMs; }
+    int stallCount() const { return m_stallCount; }
+
+private:
+    void onTick();
+
+    QTimer m_timer;
+    QElapsedTimer m_clock;      // 上一次定时器触发以来
+    QElapsedTimer m_uptime;     // 统计开始以来
+    qint64 m_totalStallMs = 0;
+    qint64 m_maxStallMs = 0;
+    int m_stallCount = 0;
+};
+
+#endif // UISTALLMONITOR_H